@@ -0,0 +1,62 @@
+;;;; Measure FILL, REPLACE and SUBSEQ on specialized vectors of each element
+;;;; width from 1 to 64 bits, for sizes from a few words to beyond the last
+;;;; level cache, against the word-at-a-time loops they used to be.
+
+#|
+* (load (compile-file "benchmarks/replace-fill"))
+* (replace-fill-bench:run)
+
+For each element width and vector size in bytes this prints gigabytes per
+second for a word loop and for FILL, then for a word loop and for REPLACE
+between two vectors, and for SUBSEQ of the whole vector. The word loops
+are what filling and copying whole words did before.
+|#
+
+(defpackage "REPLACE-FILL-BENCH"
+  (:use "CL")
+  (:export "RUN"))
+
+(in-package "REPLACE-FILL-BENCH")
+
+(defun word-loop-fill (vector value nwords)
+  (declare (optimize speed (safety 0)) (sb-ext:word value) (sb-int:index nwords))
+  (dotimes (i nwords vector)
+    (setf (sb-kernel:%vector-raw-bits vector i) value)))
+
+(defun word-loop-copy (source destination nwords)
+  (declare (optimize speed (safety 0)) (sb-int:index nwords))
+  (dotimes (i nwords destination)
+    (setf (sb-kernel:%vector-raw-bits destination i)
+          (sb-kernel:%vector-raw-bits source i))))
+
+;;; Return gigabytes per second for calling FUN on vectors of BYTES,
+;;; repeated enough to take at least about 0.2 seconds.
+(defun gb/s (fun bytes)
+  (declare (function fun))
+  (let ((repeat (max 1 (floor (* 400 1024 1024) bytes))))
+    (funcall fun)
+    (let ((start (get-internal-real-time)))
+      (dotimes (i repeat)
+        (funcall fun))
+      (let ((seconds (/ (max 1 (- (get-internal-real-time) start))
+                        internal-time-units-per-second)))
+        (/ (* bytes repeat) seconds 1d9)))))
+
+(defun run (&key (bits '(1 2 4 8 16 32 64))
+                 (sizes '(64 256 1024 4096 32768 262144 4194304 67108864)))
+  (format t "~&~4A ~10@A ~8@A ~8@A ~8@A ~8@A ~8@A~%"
+          "bits" "bytes" "loop" "fill" "loop" "replace" "subseq")
+  (dolist (n-bits bits)
+    (dolist (bytes sizes)
+      (let* ((length (/ (* bytes 8) n-bits))
+             (nwords (/ bytes sb-vm:n-word-bytes))
+             (type `(unsigned-byte ,n-bits))
+             (a (make-array length :element-type type :initial-element 1))
+             (b (make-array length :element-type type))
+             (value (1- (ash 1 n-bits))))
+        (format t "~4D ~10D~{ ~8,2F~}~%" n-bits bytes
+                (list (gb/s (lambda () (word-loop-fill a value nwords)) bytes)
+                      (gb/s (lambda () (fill a value)) bytes)
+                      (gb/s (lambda () (word-loop-copy a b nwords)) bytes)
+                      (gb/s (lambda () (replace b a)) bytes)
+                      (gb/s (lambda () (subseq a 0)) bytes)))))))
@@ -0,0 +1,117 @@
+;;;; Compare the word-at-a-time string hash used by SXHASH and EQUAL hash
+;;;; tables with the one-at-a-time hash it replaced, on keys resembling
+;;;; URLs, JSON object keys and symbol names.
+
+#|
+* (load (compile-file "benchmarks/string-hash"))
+* (string-hash-bench:run)
+
+The columns are: nanoseconds per key for the old and the new hash,
+nanoseconds per GETHASH in an EQUAL table of all the keys, and the number
+of distinct values of the low 20 bits of the old and new hashes.
+|#
+
+(defpackage "STRING-HASH-BENCH"
+  (:use "CL")
+  (:export "RUN"))
+
+(in-package "STRING-HASH-BENCH")
+
+;;; The previous definition of SB-IMPL::%SXHASH-SIMPLE-SUBSTRING.
+(defun one-at-a-time-hash (string)
+  (declare (simple-string string) (optimize speed (safety 0)))
+  (macrolet ((set-result (form)
+               `(setf result (ldb (byte sb-vm:n-word-bits 0) ,form)))
+             (guts ()
+               `(loop for i of-type sb-int:index below (length string) do
+                  (set-result (+ result (char-code (aref string i))))
+                  (set-result (+ result (ash result 10)))
+                  (set-result (logxor result (ash result -6))))))
+    (let ((result 238625159))
+      (declare (type sb-ext:word result))
+      (typecase string
+        (simple-base-string (guts))
+        ((simple-array character (*)) (guts)))
+      (set-result (+ result (ash result 3)))
+      (set-result (logxor result (ash result -11)))
+      (set-result (logxor result (ash result 15)))
+      (logand result most-positive-fixnum))))
+
+(defun new-hash (string)
+  (declare (simple-string string))
+  (sb-impl::%sxhash-simple-string string))
+
+(defun random-word (state min max)
+  (let ((word (make-string (+ min (random (- max min -1) state)))))
+    (dotimes (i (length word) word)
+      (setf (char word i) (code-char (+ 97 (random 26 state)))))))
+
+(defun make-urls (n state)
+  (loop repeat n
+        collect (format nil "https://~A.example.com/~{~A~^/~}?id=~D"
+                        (random-word state 3 10)
+                        (loop repeat (1+ (random 4 state))
+                              collect (random-word state 2 12))
+                        (random 1000000 state))))
+
+(defun make-json-keys (n state)
+  (loop repeat n
+        collect (format nil "~A~:[~;_~A~]"
+                        (random-word state 2 8)
+                        (zerop (random 2 state))
+                        (random-word state 2 8))))
+
+(defun make-symbol-names (n)
+  (let ((names '()))
+    (do-all-symbols (symbol)
+      (when (and (< (length names) n)
+                 (every (lambda (c) (typep c 'base-char)) (symbol-name symbol)))
+        (push (copy-seq (symbol-name symbol)) names)))
+    names))
+
+(defun coerce-keys (keys element-type)
+  (map 'vector (lambda (key) (coerce key `(simple-array ,element-type (*))))
+       keys))
+
+(defun ns-per-key (fun keys repeat)
+  (declare (function fun) (simple-vector keys))
+  (let ((start (get-internal-real-time))
+        (sink 0))
+    (declare (fixnum sink))
+    (dotimes (i repeat)
+      (loop for key across keys
+            do (setq sink (logxor sink (funcall fun key)))))
+    (values (/ (* (- (get-internal-real-time) start)
+                  (/ 1d9 internal-time-units-per-second))
+               (* repeat (length keys)))
+            sink)))
+
+(defun distinct-low-bits (fun keys)
+  (let ((seen (make-hash-table)))
+    (loop for key across keys
+          do (setf (gethash (ldb (byte 20 0) (funcall fun key)) seen) t))
+    (hash-table-count seen)))
+
+(defun gethash-ns (keys repeat)
+  (let ((table (make-hash-table :test 'equal))
+        (probes (map 'vector #'copy-seq keys)))
+    (loop for key across keys for i from 0 do (setf (gethash key table) i))
+    (ns-per-key (lambda (key) (the fixnum (gethash key table))) probes repeat)))
+
+(defun run (&key (n 100000) (repeat 20))
+  (let ((state (sb-ext:seed-random-state 42)))
+    (format t "~&~20A ~10@A ~10@A ~10@A ~8@A ~8@A~%"
+            "keys" "old ns" "new ns" "gethash" "old" "new")
+    (dolist (case (list (list "urls" (make-urls n state))
+                        (list "json keys" (make-json-keys n state))
+                        (list "symbol names" (make-symbol-names n))))
+      (destructuring-bind (name keys) case
+        (dolist (element-type '(base-char character))
+          (let ((keys (coerce-keys keys element-type)))
+            (format t "~20A ~10,1F ~10,1F ~10,1F ~8D ~8D~%"
+                    (format nil "~A (~(~A~))" name element-type)
+                    (ns-per-key #'one-at-a-time-hash keys repeat)
+                    (ns-per-key #'new-hash keys repeat)
+                    (gethash-ns keys repeat)
+                    (distinct-low-bits #'one-at-a-time-hash keys)
+                    (distinct-low-bits #'new-hash keys))))))))
@@ -0,0 +1,134 @@
+;;;; Bounded mailbox implementation using BOUNDED-QUEUE.
+;;;;
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was written at
+;;;; Carnegie Mellon University and released into the public domain. The
+;;;; software is in the public domain and is provided with absolutely no
+;;;; warranty. See the COPYING and CREDITS files for more information.
+
+(in-package :sb-concurrency)
+
+;;; Unlike MAILBOX, there is no semaphore counting the messages: the
+;;; BOUNDED-QUEUE blocks receivers while it is empty and senders while
+;;; it is full by itself, so sending and receiving don't cons.
+
+(defstruct (bounded-mailbox (:constructor %make-bounded-mailbox (queue name))
+                            (:copier nil)
+                            (:predicate bounded-mailbox-p))
+  "Mailbox which holds at most a fixed number of messages.
+
+SEND-BOUNDED-MESSAGE adds a message to the mailbox, waiting while it is
+full, and RECEIVE-BOUNDED-MESSAGE waits till a message becomes available.
+The -NO-HANG variants return immediately instead, and
+RECEIVE-PENDING-BOUNDED-MESSAGES empties the entire mailbox in one go.
+
+Messages can be arbitrary objects"
+  (queue (missing-arg) :type bounded-queue :read-only t)
+  (name nil))
+(declaim (sb-ext:freeze-type bounded-mailbox))
+
+(setf (documentation 'bounded-mailbox-p 'function)
+      "Returns true if argument is a BOUNDED-MAILBOX, NIL otherwise."
+      (documentation 'bounded-mailbox-name 'function)
+      "Name of a BOUNDED-MAILBOX. SETFable.")
+
+(declaim (ftype (sfunction ((integer 1) &key (:name t)) bounded-mailbox)
+                make-bounded-mailbox))
+(defun make-bounded-mailbox (capacity &key name)
+  "Returns a new empty BOUNDED-MAILBOX which holds at least CAPACITY
+messages. The actual capacity is CAPACITY rounded up to a power of two."
+  (%make-bounded-mailbox
+   (make-bounded-queue capacity
+                       :name (format nil "~:[Bounded mailbox~;Queue for ~
+                                          bounded mailbox ~:*~S~]"
+                                     name))
+   name))
+
+(defmethod print-object ((mailbox bounded-mailbox) stream)
+  (print-unreadable-object (mailbox stream :type t :identity t)
+    (format stream "~@[~S ~](~D/~D msgs pending)"
+            (bounded-mailbox-name mailbox)
+            (bounded-mailbox-count mailbox)
+            (bounded-mailbox-capacity mailbox)))
+  mailbox)
+
+(declaim (ftype (sfunction (bounded-mailbox) index)
+                bounded-mailbox-capacity bounded-mailbox-count))
+(defun bounded-mailbox-capacity (mailbox)
+  "Returns the number of messages MAILBOX can hold."
+  (bounded-queue-capacity (bounded-mailbox-queue mailbox)))
+
+(defun bounded-mailbox-count (mailbox)
+  "Returns the number of messages currently in the mailbox."
+  (bounded-queue-count (bounded-mailbox-queue mailbox)))
+
+(declaim (ftype (sfunction (bounded-mailbox) boolean) bounded-mailbox-empty-p))
+(defun bounded-mailbox-empty-p (mailbox)
+  "Returns true if MAILBOX is currently empty, NIL otherwise."
+  (bounded-queue-empty-p (bounded-mailbox-queue mailbox)))
+
+(declaim (ftype (sfunction (bounded-mailbox t &key (:timeout t)) boolean)
+                send-bounded-message))
+(defun send-bounded-message (mailbox message &key timeout)
+  "Adds a MESSAGE to MAILBOX, waiting until there is room for it if
+MAILBOX is full. Message can be any object. Returns T, or NIL if TIMEOUT
+is provided and no room became available within the specified interval."
+  (bounded-enqueue message (bounded-mailbox-queue mailbox) :timeout timeout))
+
+(declaim (ftype (sfunction (bounded-mailbox t) boolean)
+                send-bounded-message-no-hang))
+(defun send-bounded-message-no-hang (mailbox message)
+  "The non-blocking variant of SEND-BOUNDED-MESSAGE. Returns T if MESSAGE
+was added to MAILBOX, and NIL if MAILBOX was full."
+  (bounded-enqueue-no-hang message (bounded-mailbox-queue mailbox)))
+
+(declaim (ftype (sfunction (bounded-mailbox &key (:timeout t)) (values t boolean))
+                receive-bounded-message))
+(defun receive-bounded-message (mailbox &key timeout)
+  "Removes the oldest message from MAILBOX and returns it as the primary
+value, and a secondary value of T. If MAILBOX is empty waits until a message
+arrives.
+
+If TIMEOUT is provided, and no message arrives within the specified interval,
+returns primary and secondary value of NIL."
+  (bounded-dequeue (bounded-mailbox-queue mailbox) :timeout timeout))
+
+(declaim (ftype (sfunction (bounded-mailbox) (values t boolean))
+                receive-bounded-message-no-hang))
+(defun receive-bounded-message-no-hang (mailbox)
+  "The non-blocking variant of RECEIVE-BOUNDED-MESSAGE. Returns two values,
+the message removed from MAILBOX, and a flag specifying whether a
+message could be received."
+  (bounded-dequeue-no-hang (bounded-mailbox-queue mailbox)))
+
+(declaim (ftype (sfunction (bounded-mailbox &optional (or null unsigned-byte))
+                           list)
+                receive-pending-bounded-messages))
+(defun receive-pending-bounded-messages (mailbox &optional n)
+  "Removes and returns all (or at most N) currently pending messages
+from MAILBOX, or returns NIL if no messages are pending.
+
+Note: Concurrent threads may be snarfing messages during the run of
+this function, so even though X,Y appear right next to each other in
+the result, does not necessarily mean that Y was the message sent
+right after X."
+  (let* ((queue (bounded-mailbox-queue mailbox))
+         ;; Messages are taken this many at a time.
+         (buffer (make-array (min 256 (bounded-queue-capacity queue))))
+         (msgs '()))
+    (declare (dynamic-extent buffer))
+    (loop
+      (let* ((want (if n (min n (length buffer)) (length buffer)))
+             (count (if (plusp want)
+                        (bounded-dequeue-batch queue buffer :end want)
+                        0)))
+        (dotimes (i count)
+          (push (svref buffer i) msgs))
+        (when n
+          (decf n count))
+        ;; Stop at the first batch which came up short: the rest arrived
+        ;; after this function was called.
+        (when (< count (length buffer))
+          (return (nreverse msgs)))))))
@@ -0,0 +1,320 @@
+;;;; -*-  Lisp -*-
+;;;;
+;;;; Bounded multi-producer multi-consumer queue.
+;;;;
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was
+;;;; written at Carnegie Mellon University and released into the
+;;;; public domain. The software is in the public domain and is
+;;;; provided with absolutely no warranty. See the COPYING and CREDITS
+;;;; files for more information.
+
+(in-package :sb-concurrency)
+
+;;; This is Dmitry Vyukov's array-based queue. Every cell of the ring
+;;; carries a sequence number which says what the cell is ready for, so
+;;; that producers and consumers contend only on a single CAS of their
+;;; respective position counters, and nothing is allocated per element.
+;;;
+;;; For the cell used at position P (at index P mod capacity):
+;;;
+;;;   sequence = P       the cell is empty and may be filled at P
+;;;   sequence = P + 1   the cell holds the value enqueued at P
+;;;
+;;; and the consumer dequeuing at P hands the cell over to the next lap
+;;; of the ring by storing P + capacity. Positions grow without bound,
+;;; so they are kept modulo 2^+POSITION-BITS+ to stay fixnums; since the
+;;; capacity divides that modulus, the cell index is unaffected.
+;;;
+;;; A claimed cell must not be abandoned before its sequence number is
+;;; updated, or the queue would wedge at that position: claiming and
+;;; filling (or emptying) happen without interrupts.
+;;;
+;;; Threads block only when the queue is full or empty. Waiters announce
+;;; themselves in the WAITERS count while holding the mutex, and the fast
+;;; paths touch the mutex and waitqueue only when that count is nonzero.
+
+(defconstant +position-bits+ (1- sb-vm:n-positive-fixnum-bits))
+(defconstant +position-mask+ (1- (ash 1 +position-bits+)))
+
+(declaim (inline pos+ pos-difference))
+(defun pos+ (pos n)
+  (logand (+ pos n) +position-mask+))
+
+;;; A - B as a signed quantity.
+(defun pos-difference (a b)
+  (let ((d (logand (- a b) +position-mask+)))
+    (if (logbitp (1- +position-bits+) d)
+        (- d (ash 1 +position-bits+))
+        d)))
+
+(defstruct (bounded-queue (:constructor %make-bounded-queue (cells mask name))
+                          (:copier nil)
+                          (:predicate bounded-queue-p))
+  "Bounded, array-based, thread safe FIFO queue. Enqueueing and dequeueing
+are lock-free and do not cons.
+
+Use BOUNDED-ENQUEUE and BOUNDED-DEQUEUE to add and remove objects, waiting
+while the queue is full or empty respectively, or their -NO-HANG variants
+to return immediately instead. BOUNDED-ENQUEUE-BATCH and
+BOUNDED-DEQUEUE-BATCH transfer several objects at once."
+  ;; The sequence number and the value of each cell, interleaved.
+  (cells (missing-arg) :type simple-vector :read-only t)
+  ;; Capacity - 1.
+  (mask (missing-arg) :type index :read-only t)
+  (enqueue-pos 0 :type index)
+  (dequeue-pos 0 :type index)
+  ;; Number of threads blocked, or about to block, on WAITQUEUE.
+  (waiters 0 :type sb-ext:word)
+  (mutex (make-mutex :name "bounded queue lock") :type mutex :read-only t)
+  (waitqueue (make-waitqueue :name "bounded queue") :type waitqueue :read-only t)
+  (name nil))
+(declaim (sb-ext:freeze-type bounded-queue))
+
+(setf (documentation 'bounded-queue-p 'function)
+      "Returns true if argument is a BOUNDED-QUEUE, NIL otherwise."
+      (documentation 'bounded-queue-name 'function)
+      "Name of a BOUNDED-QUEUE. SETFable.")
+
+(defmethod print-object ((queue bounded-queue) stream)
+  (print-unreadable-object (queue stream :type t :identity t)
+    (format stream "~@[~S ~](~D/~D)"
+            (bounded-queue-name queue)
+            (bounded-queue-count queue)
+            (bounded-queue-capacity queue))))
+
+(declaim (ftype (sfunction ((integer 1) &key (:name t)) bounded-queue)
+                make-bounded-queue))
+(defun make-bounded-queue (capacity &key name)
+  "Returns a new empty BOUNDED-QUEUE which holds at least CAPACITY objects.
+The actual capacity is CAPACITY rounded up to a power of two."
+  (let ((capacity (ash 1 (integer-length (1- capacity)))))
+    (unless (< capacity (ash 1 (- +position-bits+ 2)))
+      (error "Bounded queue capacity ~D is too large." capacity))
+    (let ((cells (make-array (* 2 capacity) :initial-element 0)))
+      (dotimes (i capacity)
+        (setf (svref cells (* 2 i)) i))
+      (%make-bounded-queue cells (1- capacity) name))))
+
+(declaim (ftype (sfunction (bounded-queue) index) bounded-queue-capacity))
+(defun bounded-queue-capacity (queue)
+  "Returns the number of objects QUEUE can hold."
+  (1+ (bounded-queue-mask queue)))
+
+(declaim (ftype (sfunction (bounded-queue) index) bounded-queue-count))
+(defun bounded-queue-count (queue)
+  "Returns the number of objects in QUEUE. Mainly useful for manual
+examination of the queue state, as the value may be out of date by the
+time it is returned."
+  (let ((n (pos-difference (bounded-queue-enqueue-pos queue)
+                           (bounded-queue-dequeue-pos queue))))
+    (max 0 (min n (bounded-queue-capacity queue)))))
+
+(declaim (ftype (sfunction (bounded-queue) boolean) bounded-queue-empty-p))
+(defun bounded-queue-empty-p (queue)
+  "Returns T if QUEUE is empty, NIL otherwise."
+  (zerop (bounded-queue-count queue)))
+
+;;; Claim up to N consecutive cells which are ready to be filled (or
+;;; emptied, if DEQUEUEP) and return the position of the first one and
+;;; the number claimed, which is zero if the queue is full (or empty).
+(declaim (inline %claim-cells))
+(defun %claim-cells (queue n dequeuep)
+  (declare (index n))
+  (let ((cells (bounded-queue-cells queue))
+        (mask (bounded-queue-mask queue))
+        (offset (if dequeuep 1 0)))
+    (loop
+      (let ((pos (if dequeuep
+                     (bounded-queue-dequeue-pos queue)
+                     (bounded-queue-enqueue-pos queue)))
+            (ready 0)
+            (stalep nil))
+        (declare (index ready))
+        (loop while (< ready n)
+              do (let* ((p (pos+ pos ready))
+                        (dif (pos-difference (svref cells (* 2 (logand p mask)))
+                                             (pos+ p offset))))
+                   (cond ((zerop dif)
+                          (incf ready))
+                         (t
+                          ;; A cell already used at or beyond P means that
+                          ;; someone else moved the position under us.
+                          (setf stalep (and (zerop ready) (plusp dif)))
+                          (return)))))
+        (barrier (:read))
+        (cond (stalep)
+              ((zerop ready)
+               (return (values pos 0)))
+              ((eq pos (if dequeuep
+                           (compare-and-swap (bounded-queue-dequeue-pos queue)
+                                             pos (pos+ pos ready))
+                           (compare-and-swap (bounded-queue-enqueue-pos queue)
+                                             pos (pos+ pos ready))))
+               (return (values pos ready))))))))
+
+;;; Enqueue up to END - START elements of VECTOR, or just VALUE if VECTOR
+;;; is NIL, without waiting or waking up waiters. Return the number of
+;;; elements enqueued.
+(defun %enqueue-cells (queue value vector start end)
+  (declare (optimize speed)
+           (type (or null vector) vector)
+           (index start end))
+  (let ((cells (bounded-queue-cells queue))
+        (mask (bounded-queue-mask queue)))
+    (without-interrupts
+      (multiple-value-bind (pos count)
+          (%claim-cells queue (if vector (- end start) 1) nil)
+        (declare (index pos count))
+        (dotimes (i count count)
+          (let* ((p (pos+ pos i))
+                 (index (* 2 (logand p mask))))
+            (setf (svref cells (1+ index))
+                  (if vector (aref vector (+ start i)) value))
+            (barrier (:write))
+            (setf (svref cells index) (pos+ p 1))))))))
+
+;;; Dequeue up to END - START elements into VECTOR, or a single value if
+;;; VECTOR is NIL, without waiting or waking up waiters. Return the
+;;; number of elements dequeued, and the value if VECTOR is NIL.
+(defun %dequeue-cells (queue vector start end)
+  (declare (optimize speed)
+           (type (or null vector) vector)
+           (index start end))
+  (let ((cells (bounded-queue-cells queue))
+        (mask (bounded-queue-mask queue))
+        (value nil))
+    (without-interrupts
+      (multiple-value-bind (pos count)
+          (%claim-cells queue (if vector (- end start) 1) t)
+        (declare (index pos count))
+        (dotimes (i count)
+          (let* ((p (pos+ pos i))
+                 (index (* 2 (logand p mask))))
+            (if vector
+                (setf (aref vector (+ start i)) (svref cells (1+ index)))
+                (setf value (svref cells (1+ index))))
+            ;; Don't keep the value alive.
+            (setf (svref cells (1+ index)) 0)
+            (barrier (:write))
+            (setf (svref cells index) (pos+ p (1+ mask)))))
+        (values count value)))))
+
+;;; Wake up any threads waiting for QUEUE to change state.
+(declaim (inline %notify-bounded-queue-waiters))
+(defun %notify-bounded-queue-waiters (queue)
+  (barrier (:memory))
+  (unless (zerop (bounded-queue-waiters queue))
+    (with-mutex ((bounded-queue-mutex queue))
+      (condition-broadcast (bounded-queue-waitqueue queue)))))
+
+;;; Call ATTEMPT until it returns true, waiting for QUEUE to change state
+;;; in between, or TIMEOUT seconds to pass. Return the value of the last
+;;; call to ATTEMPT.
+(defun %wait-on-bounded-queue (queue timeout attempt)
+  (declare (function attempt))
+  (let ((mutex (bounded-queue-mutex queue))
+        (deadline (when timeout
+                    (+ (get-internal-real-time)
+                       (round (* timeout internal-time-units-per-second))))))
+    (with-mutex (mutex)
+      ;; The count must be visible before the final attempt, so that
+      ;; whoever changes the state after it also sees us waiting.
+      (atomic-incf (bounded-queue-waiters queue))
+      (unwind-protect
+           (loop
+             (when (funcall attempt)
+               (return t))
+             (let ((remaining (when deadline
+                                (/ (- deadline (get-internal-real-time))
+                                   internal-time-units-per-second))))
+               (unless (and (or (null remaining) (plusp remaining))
+                            (condition-wait (bounded-queue-waitqueue queue) mutex
+                                            :timeout remaining))
+                 ;; Timed out, and no longer holding MUTEX.
+                 (return (funcall attempt)))))
+        (atomic-decf (bounded-queue-waiters queue))))))
+
+(declaim (ftype (sfunction (t bounded-queue) boolean) bounded-enqueue-no-hang))
+(defun bounded-enqueue-no-hang (value queue)
+  "Adds VALUE to the end of QUEUE if there is room for it. Returns T if
+VALUE was enqueued, and NIL if QUEUE was full."
+  (when (plusp (%enqueue-cells queue value nil 0 0))
+    (%notify-bounded-queue-waiters queue)
+    t))
+
+(declaim (ftype (sfunction (t bounded-queue &key (:timeout t)) boolean)
+                bounded-enqueue))
+(defun bounded-enqueue (value queue &key timeout)
+  "Adds VALUE to the end of QUEUE, waiting for room if QUEUE is full.
+Returns T, or NIL if TIMEOUT was given and no room became available in
+TIMEOUT seconds."
+  (or (bounded-enqueue-no-hang value queue)
+      (when (flet ((attempt ()
+                     (plusp (%enqueue-cells queue value nil 0 0))))
+              (declare (dynamic-extent #'attempt))
+              (%wait-on-bounded-queue queue timeout #'attempt))
+        (%notify-bounded-queue-waiters queue)
+        t)))
+
+(declaim (ftype (sfunction (bounded-queue) (values t boolean))
+                bounded-dequeue-no-hang))
+(defun bounded-dequeue-no-hang (queue)
+  "Removes the oldest value from QUEUE. Returns it as the primary value
+and T as the secondary value, or NIL and NIL if QUEUE was empty."
+  (multiple-value-bind (count value) (%dequeue-cells queue nil 0 0)
+    (cond ((plusp count)
+           (%notify-bounded-queue-waiters queue)
+           (values value t))
+          (t
+           (values nil nil)))))
+
+(declaim (ftype (sfunction (bounded-queue &key (:timeout t)) (values t boolean))
+                bounded-dequeue))
+(defun bounded-dequeue (queue &key timeout)
+  "Removes the oldest value from QUEUE, waiting for one to arrive if QUEUE
+is empty. Returns the value as the primary value and T as the secondary
+value, or NIL and NIL if TIMEOUT was given and no value arrived in TIMEOUT
+seconds."
+  (multiple-value-bind (value ok) (bounded-dequeue-no-hang queue)
+    (if ok
+        (values value t)
+        (let (result)
+          (if (flet ((attempt ()
+                       (multiple-value-bind (count value)
+                           (%dequeue-cells queue nil 0 0)
+                         (when (plusp count)
+                           (setf result value)
+                           t))))
+                (declare (dynamic-extent #'attempt))
+                (%wait-on-bounded-queue queue timeout #'attempt))
+              (progn
+                (%notify-bounded-queue-waiters queue)
+                (values result t))
+              (values nil nil))))))
+
+(declaim (ftype (sfunction (bounded-queue vector &key (:start index)
+                                          (:end (or null index)))
+                           index)
+                bounded-enqueue-batch bounded-dequeue-batch))
+(defun bounded-enqueue-batch (queue vector &key (start 0) end)
+  "Adds as many of the elements of VECTOR between START and END to the
+end of QUEUE as there is room for, in order, without waiting. Returns the
+number of elements enqueued."
+  (let* ((end (or end (length vector)))
+         (count (%enqueue-cells queue nil vector start end)))
+    (when (plusp count)
+      (%notify-bounded-queue-waiters queue))
+    count))
+
+(defun bounded-dequeue-batch (queue vector &key (start 0) end)
+  "Removes up to END - START of the oldest values from QUEUE, without
+waiting, and stores them in order into VECTOR beginning at START. Returns
+the number of values dequeued."
+  (let* ((end (or end (length vector)))
+         (count (%dequeue-cells queue vector start end)))
+    (when (plusp count)
+      (%notify-bounded-queue-waiters queue))
+    count))
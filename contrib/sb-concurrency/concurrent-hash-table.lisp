@@ -0,0 +1,419 @@
+;;;; -*-  Lisp -*-
+;;;;
+;;;; Concurrent hash tables with lock-free lookup.
+;;;;
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was
+;;;; written at Carnegie Mellon University and released into the
+;;;; public domain. The software is in the public domain and is
+;;;; provided with absolutely no warranty. See the COPYING and CREDITS
+;;;; files for more information.
+
+(in-package :sb-concurrency)
+
+;;; The table is a power-of-two vector of buckets, each holding a chain
+;;; of nodes. Readers never lock: a node is fully initialized before it
+;;; is linked in, a removed node keeps pointing to its successor, and
+;;; nodes are never moved from one chain to another, so a reader walking
+;;; a chain sees a consistent list whatever writers do meanwhile.
+;;;
+;;; Writers lock one of a fixed number of stripes, chosen by bucket
+;;; index. Since the number of stripes divides the number of buckets, a
+;;; bucket and the two buckets it splits into when the table doubles
+;;; share a stripe.
+;;;
+;;; Resizing is incremental. The thread that pushes the count over the
+;;; threshold only allocates the new vector; every writer then copies
+;;; one chunk of buckets before doing its own work. A copied bucket is
+;;; replaced by a forwarding marker, which sends readers and writers
+;;; to the new vector.
+;;;
+;;; Lookup needs hashes which don't change when GC moves the key. The
+;;; few kinds of keys which can only be hashed by address under the
+;;; table's test (e.g. conses in an EQ table) are kept in an ordinary
+;;; synchronized hash table on the side.
+
+(defconstant +min-buckets+ 16)
+(defconstant +max-stripes+ 64)
+;;; Number of buckets copied per operation while resizing.
+(defconstant +transfer-chunk+ 64)
+
+(defstruct (chash-node (:constructor make-chash-node (hash key value next))
+                       (:copier nil)
+                       (:predicate nil))
+  (hash 0 :type fixnum :read-only t)
+  (key nil :read-only t)
+  (value nil)
+  (next nil :type (or null chash-node)))
+
+(defstruct (chash-forward (:constructor make-chash-forward (buckets))
+                          (:copier nil))
+  (buckets #() :type simple-vector :read-only t))
+
+(defstruct (chash-resize (:constructor make-chash-resize
+                             (from to &aux (forward (make-chash-forward to))
+                                           (next (length from))))
+                         (:copier nil)
+                         (:predicate nil))
+  (from #() :type simple-vector :read-only t)
+  (to #() :type simple-vector :read-only t)
+  (forward nil :type chash-forward :read-only t)
+  ;; Buckets below NEXT have not been claimed for copying yet.
+  (next 0 :type index)
+  ;; Number of buckets copied.
+  (done 0 :type sb-ext:word))
+
+(declaim (sb-ext:freeze-type chash-node chash-forward chash-resize))
+
+(defstruct (concurrent-hash-table
+            (:constructor %make-concurrent-hash-table
+                (name test test-fun hash-fun buckets stripes))
+            (:conc-name cht-)
+            (:copier nil)
+            (:predicate concurrent-hash-table-p))
+  "A hash table which can be read and written by any number of threads
+without external locking. Lookups do not lock at all."
+  (name nil)
+  (test nil :type symbol :read-only t)
+  (test-fun nil :type function :read-only t)
+  ;; Returns a hash and whether that hash is independent of the address
+  ;; of the key.
+  (hash-fun nil :type function :read-only t)
+  (buckets #() :type simple-vector)
+  ;; Non-NIL while the buckets are being copied to a larger vector.
+  (resize nil :type (or null chash-resize))
+  (count 0 :type sb-ext:word)
+  (stripes #() :type simple-vector :read-only t)
+  ;; Keys without an address-independent hash.
+  (fallback nil :type (or null hash-table)))
+(declaim (sb-ext:freeze-type concurrent-hash-table))
+
+(setf (documentation 'concurrent-hash-table-p 'function)
+      "Returns true if argument is a CONCURRENT-HASH-TABLE, NIL otherwise."
+      (documentation 'concurrent-hash-table-name 'function)
+      "Name of a CONCURRENT-HASH-TABLE. SETFable."
+      (documentation 'concurrent-hash-table-test 'function)
+      "The test a CONCURRENT-HASH-TABLE was created with.")
+
+(declaim (inline concurrent-hash-table-name (setf concurrent-hash-table-name)
+                 concurrent-hash-table-test))
+(defun concurrent-hash-table-name (table)
+  (cht-name table))
+(defun (setf concurrent-hash-table-name) (name table)
+  (setf (cht-name table) name))
+(defun concurrent-hash-table-test (table)
+  (cht-test table))
+
+(defmethod print-object ((table concurrent-hash-table) stream)
+  (print-unreadable-object (table stream :type t :identity t)
+    (format stream "~@[~S ~]~S ~D"
+            (cht-name table) :count (concurrent-hash-table-count table))))
+
+;;;; Hashing
+
+;;; Symbols, numbers and characters hash by value under EQ and EQL, and
+;;; instances have a stable hash; anything else only has its address.
+(defun %eql-stable-hash (key)
+  (typecase key
+    ((or symbol number character)
+     (values (sxhash key) t))
+    (sb-kernel:instance
+     (values (sb-impl::instance-sxhash key) t))
+    (t
+     (values 0 nil))))
+
+(defun %equal-stable-hash (key)
+  (multiple-value-bind (hash address-based) (sb-impl::equal-hash key)
+    (values hash (not address-based))))
+
+(defun %equalp-stable-hash (key)
+  (multiple-value-bind (hash address-based) (sb-impl::equalp-hash key)
+    (values hash (not address-based))))
+
+(defun make-concurrent-hash-table (&key (test 'eql) (size 14) name)
+  "Returns a new CONCURRENT-HASH-TABLE. TEST must designate one of EQ,
+EQL, EQUAL or EQUALP. SIZE is a hint for the number of entries."
+  (declare (type unsigned-byte size))
+  (multiple-value-bind (test test-fun hash-fun)
+      (cond ((or (eq test 'eq) (eq test #'eq))
+             (values 'eq #'eq #'%eql-stable-hash))
+            ((or (eq test 'eql) (eq test #'eql))
+             (values 'eql #'eql #'%eql-stable-hash))
+            ((or (eq test 'equal) (eq test #'equal))
+             (values 'equal #'equal #'%equal-stable-hash))
+            ((or (eq test 'equalp) (eq test #'equalp))
+             (values 'equalp #'equalp #'%equalp-stable-hash))
+            (t
+             (error "Unsupported :TEST for ~S: ~S"
+                    'make-concurrent-hash-table test)))
+    (let* ((n-buckets (power-of-two-ceiling
+                       (max +min-buckets+ (ceiling (* 4 (min size (ash 1 26))) 3))))
+           (stripes (make-array (min +max-stripes+ n-buckets))))
+      (dotimes (i (length stripes))
+        (setf (svref stripes i) (make-mutex :name "concurrent hash table stripe")))
+      (%make-concurrent-hash-table name test test-fun hash-fun
+                                   (make-array n-buckets :initial-element nil)
+                                   stripes))))
+
+(defmacro with-stripe-lock ((table index) &body body)
+  `(let ((stripes (cht-stripes ,table)))
+     (with-mutex ((svref stripes (logand ,index (1- (length stripes)))))
+       ,@body)))
+
+(defun %ensure-fallback (table)
+  (or (cht-fallback table)
+      (let ((new (make-hash-table :test (cht-test table) :synchronized t)))
+        (or (compare-and-swap (cht-fallback table) nil new)
+            new))))
+
+;;;; Resizing
+
+(defun %transfer-bucket (table resize index)
+  (let* ((from (chash-resize-from resize))
+         (to (chash-resize-to resize))
+         (bit (length from)))
+    (with-stripe-lock (table index)
+      ;; A resize which started from a vector that an earlier resize had
+      ;; already copied finds nothing left to copy.
+      (unless (chash-forward-p (svref from index))
+        (let ((lo nil)
+              (hi nil))
+          ;; Copy rather than relink the nodes, so that readers still
+          ;; walking the old chain are not diverted.
+          (do ((node (svref from index) (chash-node-next node)))
+              ((null node))
+            (let ((hash (chash-node-hash node)))
+              (if (logtest hash bit)
+                  (setf hi (make-chash-node hash (chash-node-key node)
+                                            (chash-node-value node) hi))
+                  (setf lo (make-chash-node hash (chash-node-key node)
+                                            (chash-node-value node) lo)))))
+          (setf (svref to index) lo
+                (svref to (+ index bit)) hi)
+          (barrier (:write))
+          (setf (svref from index) (chash-resize-forward resize)))))))
+
+;;; Copy one chunk of buckets if TABLE is being resized.
+(defun %help-resize (table)
+  (let ((resize (cht-resize table)))
+    (when resize
+      (loop
+        (let ((end (chash-resize-next resize)))
+          (when (zerop end)
+            (return))
+          (let ((start (max 0 (- end +transfer-chunk+))))
+            (when (eql end (compare-and-swap (chash-resize-next resize) end start))
+              (loop for index from start below end
+                    do (%transfer-bucket table resize index))
+              (let ((n (- end start))
+                    (length (length (chash-resize-from resize))))
+                (when (= length (+ n (atomic-incf (chash-resize-done resize) n)))
+                  ;; Everything has been copied. Install the new vector
+                  ;; only if RESIZE started from the current one.
+                  (let ((from (chash-resize-from resize)))
+                    (compare-and-swap (cht-buckets table)
+                                      from (chash-resize-to resize)))
+                  (barrier (:write))
+                  (compare-and-swap (cht-resize table) resize nil)))
+              (return))))))))
+
+(defun %maybe-start-resize (table count)
+  (let ((buckets (cht-buckets table)))
+    (when (and (> (* 4 count) (* 3 (length buckets)))
+               (null (cht-resize table)))
+      (let ((resize (make-chash-resize
+                     buckets
+                     (make-array (* 2 (length buckets)) :initial-element nil))))
+        (when (null (compare-and-swap (cht-resize table) nil resize))
+          ;; Another resize may have finished since BUCKETS was read, in
+          ;; which case this one would start from a stale vector.
+          (if (eq buckets (cht-buckets table))
+              (%help-resize table)
+              (compare-and-swap (cht-resize table) resize nil)))))))
+
+;;;; Access
+
+(defmacro do-chain ((node head) &body body)
+  `(do ((,node ,head (chash-node-next ,node)))
+       ((null ,node))
+     ,@body))
+
+(defun concurrent-gethash (key table &optional default)
+  "Finds the entry in TABLE whose key is KEY and returns the associated
+value and T as multiple values, or returns DEFAULT and NIL if there is no
+such entry. Never blocks. Entries can be added using SETF."
+  (declare (type concurrent-hash-table table))
+  (multiple-value-bind (hash stablep) (funcall (cht-hash-fun table) key)
+    (if (not stablep)
+        (let ((fallback (cht-fallback table)))
+          (if fallback
+              (gethash key fallback default)
+              (values default nil)))
+        (let ((hash (sb-impl::prefuzz-hash hash))
+              (test (cht-test-fun table))
+              (buckets (cht-buckets table)))
+          (declare (fixnum hash))
+          (loop
+            (let ((head (svref buckets (logand hash (1- (length buckets))))))
+              (barrier (:data-dependency))
+              (if (chash-forward-p head)
+                  (setf buckets (chash-forward-buckets head))
+                  (return
+                    (do-chain (node head)
+                      (when (and (= hash (chash-node-hash node))
+                                 (let ((node-key (chash-node-key node)))
+                                   (or (eq key node-key)
+                                       (funcall test key node-key))))
+                        (return-from concurrent-gethash
+                          (values (chash-node-value node) t))))))))
+          (values default nil)))))
+
+;;; Call FUNCTION on the locked bucket for HASH, that is the bucket
+;;; vector, the index and the chain, and return its value, which must
+;;; be T or NIL.
+(defun %call-with-locked-bucket (function table hash)
+  (declare (function function) (fixnum hash))
+  (%help-resize table)
+  (let ((buckets (cht-buckets table)))
+    (loop
+      (let* ((index (logand hash (1- (length buckets))))
+             (result (with-stripe-lock (table index)
+                       (let ((head (svref buckets index)))
+                         (if (chash-forward-p head)
+                             head
+                             (funcall function buckets index head))))))
+        (if (chash-forward-p result)
+            (setf buckets (chash-forward-buckets result))
+            (return result))))))
+
+(defun (setf concurrent-gethash) (value key table &optional default)
+  (declare (type concurrent-hash-table table)
+           (ignore default))
+  (multiple-value-bind (hash stablep) (funcall (cht-hash-fun table) key)
+    (if (not stablep)
+        (setf (gethash key (%ensure-fallback table)) value)
+        (let ((hash (sb-impl::prefuzz-hash hash))
+              (test (cht-test-fun table)))
+          (declare (fixnum hash))
+          (when (%call-with-locked-bucket
+                 (lambda (buckets index head)
+                   (block update
+                     (do-chain (node head)
+                       (when (and (= hash (chash-node-hash node))
+                                  (let ((node-key (chash-node-key node)))
+                                    (or (eq key node-key)
+                                        (funcall test key node-key))))
+                         (setf (chash-node-value node) value)
+                         (return-from update nil)))
+                     (let ((node (make-chash-node hash key value head)))
+                       (barrier (:write))
+                       (setf (svref buckets index) node))
+                     t))
+                 table hash)
+            (%maybe-start-resize table (1+ (atomic-incf (cht-count table)))))
+          value))))
+
+(defun concurrent-remhash (key table)
+  "Removes the entry for KEY from TABLE. Returns true if there was one."
+  (declare (type concurrent-hash-table table))
+  (multiple-value-bind (hash stablep) (funcall (cht-hash-fun table) key)
+    (if (not stablep)
+        (let ((fallback (cht-fallback table)))
+          (and fallback (remhash key fallback)))
+        (let ((hash (sb-impl::prefuzz-hash hash))
+              (test (cht-test-fun table)))
+          (declare (fixnum hash))
+          (when (%call-with-locked-bucket
+                 (lambda (buckets index head)
+                   (do ((previous nil node)
+                        (node head (chash-node-next node)))
+                       ((null node) nil)
+                     (when (and (= hash (chash-node-hash node))
+                                (let ((node-key (chash-node-key node)))
+                                  (or (eq key node-key)
+                                      (funcall test key node-key))))
+                       ;; NODE keeps its successor for readers standing on it.
+                       (if previous
+                           (setf (chash-node-next previous) (chash-node-next node))
+                           (setf (svref buckets index) (chash-node-next node)))
+                       (return t))))
+                 table hash)
+            (atomic-decf (cht-count table))
+            t)))))
+
+(defun concurrent-hash-table-count (table)
+  "Returns the number of entries in TABLE. The count may be stale by the
+time it is returned if other threads are modifying the table."
+  (declare (type concurrent-hash-table table))
+  (+ (cht-count table)
+     (let ((fallback (cht-fallback table)))
+       (if fallback (hash-table-count fallback) 0))))
+
+;;; Call FUNCTION on each chain reachable from BUCKETS, following
+;;; forwarding markers to the buckets a copied bucket was split into.
+(defun %map-chains (function buckets)
+  (declare (function function))
+  (labels ((visit (buckets index)
+             (let ((head (svref buckets index)))
+               (barrier (:data-dependency))
+               (if (chash-forward-p head)
+                   (let ((to (chash-forward-buckets head)))
+                     (visit to index)
+                     (visit to (+ index (length buckets))))
+                   (funcall function buckets index head)))))
+    (dotimes (index (length buckets))
+      (visit buckets index))))
+
+(defun concurrent-maphash (function table)
+  "Calls FUNCTION with the key and value of each entry of TABLE. Entries
+added or removed by other threads during the traversal may or may not be
+seen, but each entry present throughout is seen exactly once. FUNCTION
+may itself modify TABLE. Returns NIL."
+  (declare (type concurrent-hash-table table))
+  (let ((function (coerce function 'function)))
+    (%map-chains (lambda (buckets index head)
+                   (declare (ignore buckets index))
+                   (do-chain (node head)
+                     (funcall function (chash-node-key node) (chash-node-value node))))
+                 (cht-buckets table))
+    (let ((fallback (cht-fallback table)))
+      (when fallback
+        (loop for (key . value)
+                in (with-locked-hash-table (fallback)
+                     (loop for key being each hash-key of fallback
+                             using (hash-value value)
+                           collect (cons key value)))
+              do (funcall function key value))))
+    nil))
+
+(defun concurrent-clrhash (table)
+  "Removes all entries from TABLE, and returns it. Entries added by other
+threads while CONCURRENT-CLRHASH runs may survive."
+  (declare (type concurrent-hash-table table))
+  (labels ((clear (buckets index)
+             (let ((forward
+                     (with-stripe-lock (table index)
+                       (let ((head (svref buckets index)))
+                         (if (chash-forward-p head)
+                             head
+                             (let ((n 0))
+                               (declare (fixnum n))
+                               (do-chain (node head)
+                                 (incf n))
+                               (setf (svref buckets index) nil)
+                               (atomic-decf (cht-count table) n)
+                               nil))))))
+               ;; The bucket has been split: clear both halves.
+               (when forward
+                 (let ((to (chash-forward-buckets forward)))
+                   (clear to index)
+                   (clear to (+ index (length buckets))))))))
+    (let ((buckets (cht-buckets table)))
+      (dotimes (index (length buckets))
+        (clear buckets index))))
+  (let ((fallback (cht-fallback table)))
+    (when fallback
+      (clrhash fallback)))
+  table)
@@ -36,6 +36,68 @@
    "QUEUE-NAME"
    "QUEUEP"
 
+   ;; BOUNDED-QUEUE
+   "BOUNDED-DEQUEUE"
+   "BOUNDED-DEQUEUE-BATCH"
+   "BOUNDED-DEQUEUE-NO-HANG"
+   "BOUNDED-ENQUEUE"
+   "BOUNDED-ENQUEUE-BATCH"
+   "BOUNDED-ENQUEUE-NO-HANG"
+   "BOUNDED-QUEUE"
+   "BOUNDED-QUEUE-CAPACITY"
+   "BOUNDED-QUEUE-COUNT"
+   "BOUNDED-QUEUE-EMPTY-P"
+   "BOUNDED-QUEUE-NAME"
+   "BOUNDED-QUEUE-P"
+   "MAKE-BOUNDED-QUEUE"
+
+   ;; BOUNDED-MAILBOX
+   "BOUNDED-MAILBOX"
+   "BOUNDED-MAILBOX-CAPACITY"
+   "BOUNDED-MAILBOX-COUNT"
+   "BOUNDED-MAILBOX-EMPTY-P"
+   "BOUNDED-MAILBOX-NAME"
+   "BOUNDED-MAILBOX-P"
+   "MAKE-BOUNDED-MAILBOX"
+   "RECEIVE-BOUNDED-MESSAGE"
+   "RECEIVE-BOUNDED-MESSAGE-NO-HANG"
+   "RECEIVE-PENDING-BOUNDED-MESSAGES"
+   "SEND-BOUNDED-MESSAGE"
+   "SEND-BOUNDED-MESSAGE-NO-HANG"
+
+   ;; TASK-POOL
+   "*TASK-POOL*"
+   "CANCEL-FUTURE"
+   "FULFILL-PROMISE"
+   "FUTURE"
+   "FUTURE-DONE-P"
+   "FUTURE-VALUE"
+   "FUTUREP"
+   "MAKE-PROMISE"
+   "MAKE-TASK-POOL"
+   "PARALLEL-MAP"
+   "PARALLEL-REDUCE"
+   "SHUTDOWN-TASK-POOL"
+   "SUBMIT-TASK"
+   "TASK-CANCELLED"
+   "TASK-CANCELLED-FUTURE"
+   "TASK-POOL"
+   "TASK-POOL-NAME"
+   "TASK-POOL-P"
+   "TASK-POOL-SIZE"
+
+   ;; CONCURRENT-HASH-TABLE
+   "CONCURRENT-CLRHASH"
+   "CONCURRENT-GETHASH"
+   "CONCURRENT-HASH-TABLE"
+   "CONCURRENT-HASH-TABLE-COUNT"
+   "CONCURRENT-HASH-TABLE-NAME"
+   "CONCURRENT-HASH-TABLE-P"
+   "CONCURRENT-HASH-TABLE-TEST"
+   "CONCURRENT-MAPHASH"
+   "CONCURRENT-REMHASH"
+   "MAKE-CONCURRENT-HASH-TABLE"
+
    ;; GATE
    "CLOSE-GATE"
    "GATE"
@@ -0,0 +1,470 @@
+;;;; -*-  Lisp -*-
+;;;;
+;;;; Work-stealing task pool and futures.
+;;;;
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was
+;;;; written at Carnegie Mellon University and released into the
+;;;; public domain. The software is in the public domain and is
+;;;; provided with absolutely no warranty. See the COPYING and CREDITS
+;;;; files for more information.
+
+(in-package :sb-concurrency)
+
+;;; Each worker thread owns a deque of futures. A worker pushes the
+;;; tasks it submits itself onto the bottom of its own deque and pops
+;;; them from there, most recent first, while idle workers steal the
+;;; oldest tasks from the top of other deques. Tasks submitted by
+;;; threads outside the pool go through a shared lock-free QUEUE.
+;;;
+;;; A future which has not been started yet can be claimed by whoever
+;;; asks for its value first, so waiting on a future never deadlocks
+;;; the pool: if nobody has picked the task up, the waiting thread runs
+;;; it itself. Pool threads waiting on a future that is already running
+;;; elsewhere run other tasks in the meantime.
+;;;
+;;; Tasks run with the deadline that was in effect in the submitting
+;;; thread, and are run without any deadline otherwise.
+
+;;;; Futures
+
+(defstruct (future (:constructor %make-future
+                       (function deadline-time deadline-seconds))
+                   (:copier nil)
+                   (:predicate futurep))
+  "The eventual result of a task submitted with SUBMIT-TASK, or of a
+promise made with MAKE-PROMISE. Use FUTURE-VALUE to wait for the result."
+  ;; NIL for promises.
+  (function nil :type (or null function) :read-only t)
+  ;; :PENDING, :RUNNING, :DONE, :FAILED or :CANCELLED.
+  (state :pending :type (member :pending :running :done :failed :cancelled))
+  (values nil :type list)
+  (condition nil)
+  ;; The thread running the task, while it does.
+  (thread nil)
+  ;; The deadline of the submitting thread.
+  (deadline-time nil :read-only t)
+  (deadline-seconds nil :read-only t)
+  (gate (make-gate) :type gate :read-only t))
+(declaim (sb-ext:freeze-type future))
+
+(setf (documentation 'futurep 'function)
+      "Returns true if argument is a FUTURE, NIL otherwise.")
+
+(defmethod print-object ((future future) stream)
+  (print-unreadable-object (future stream :type t :identity t)
+    (format stream "~(~A~)" (future-state future))))
+
+(define-condition task-cancelled (error)
+  ((future :initarg :future :reader task-cancelled-future))
+  (:report (lambda (condition stream)
+             (format stream "The task of ~S was cancelled."
+                     (task-cancelled-future condition))))
+  (:documentation "Signalled by FUTURE-VALUE for a future whose task was
+cancelled with CANCEL-FUTURE."))
+
+(defun make-promise ()
+  "Returns a new FUTURE which is not computed by any task, but receives
+its values from FULFILL-PROMISE."
+  (%make-future nil nil nil))
+
+(defun %finish-future (future state values condition)
+  (setf (future-values future) values
+        (future-condition future) condition)
+  (barrier (:write))
+  (setf (future-state future) state)
+  (open-gate (future-gate future))
+  future)
+
+(defun fulfill-promise (future &rest values)
+  "Makes VALUES the values of FUTURE, a promise made with MAKE-PROMISE.
+Returns T if FUTURE was still unfulfilled, NIL otherwise."
+  (aver (null (future-function future)))
+  (when (eq :pending (compare-and-swap (future-state future) :pending :running))
+    (%finish-future future :done values nil)
+    t))
+
+;;; Run the task of FUTURE, which has been claimed by this thread.
+(defun %run-future (future)
+  (let ((time (future-deadline-time future))
+        (outcome :cancelled)
+        (values nil)
+        (condition nil))
+    ;; CANCEL-FUTURE throws to FUTURE for as long as FUTURE-THREAD says
+    ;; this thread is running the task.
+    (catch future
+      (setf (future-thread future) *current-thread*)
+      (handler-case
+          (let ((sb-impl::*deadline*
+                  (when time
+                    (sb-impl::make-deadline time (future-deadline-seconds future)))))
+            (setf values (multiple-value-list (funcall (future-function future)))
+                  outcome :done))
+        (serious-condition (c)
+          (setf condition c
+                outcome :failed)))
+      (setf (future-thread future) nil))
+    (setf (future-thread future) nil)
+    (%finish-future future outcome values condition)))
+
+;;; Run FUTURE in this thread unless someone else already has claimed it.
+(defun %run-if-pending (future)
+  (when (and (future-function future)
+             (eq :pending (compare-and-swap (future-state future)
+                                            :pending :running)))
+    (%run-future future)
+    t))
+
+(declaim (inline %future-finished-p))
+(defun %future-finished-p (future)
+  (member (future-state future) '(:done :failed :cancelled)))
+
+(defun future-done-p (future)
+  "Returns true if FUTURE has a value, failed, or was cancelled."
+  (declare (future future))
+  (and (%future-finished-p future) t))
+
+(defun cancel-future (future &key interrupt)
+  "Cancels the task of FUTURE if it has not started yet. If it is already
+running and INTERRUPT is true, the thread running it is interrupted to
+abandon the task. Returns true if the task was or will be cancelled.
+FUTURE-VALUE signals TASK-CANCELLED for a cancelled future."
+  (declare (future future))
+  (cond ((eq :pending (compare-and-swap (future-state future)
+                                        :pending :cancelled))
+         (open-gate (future-gate future))
+         t)
+        ((and interrupt (eq :running (future-state future)))
+         (let ((thread (future-thread future)))
+           (when thread
+             (interrupt-thread thread
+                               (lambda ()
+                                 (when (eq (future-thread future)
+                                           *current-thread*)
+                                   (throw future nil))))
+             t)))))
+
+;;;; Task pools
+
+(defstruct (worker (:constructor %make-worker (pool index))
+                   (:copier nil))
+  (pool (missing-arg) :read-only t)
+  (index 0 :type index :read-only t)
+  (thread nil)
+  ;; A ring buffer deque: the owner pushes and pops at the bottom,
+  ;; thieves take from the top.
+  (mutex (make-mutex :name "task pool worker lock") :type mutex :read-only t)
+  (tasks (make-array 64) :type simple-vector)
+  (top 0 :type index)
+  (count 0 :type index))
+(declaim (sb-ext:freeze-type worker))
+
+(defstruct (task-pool (:constructor %make-task-pool (name))
+                      (:copier nil)
+                      (:predicate task-pool-p))
+  "A set of worker threads running tasks submitted with SUBMIT-TASK.
+Idle workers steal tasks from busy ones. See also PARALLEL-MAP and
+PARALLEL-REDUCE."
+  (name nil)
+  (workers #() :type simple-vector)
+  ;; Tasks submitted by threads which are not workers of this pool.
+  (injection (make-queue :name "task pool injection queue")
+   :type queue :read-only t)
+  ;; Number of workers parked, or about to park, on WAITQUEUE.
+  (idle 0 :type sb-ext:word)
+  (mutex (make-mutex :name "task pool lock") :type mutex :read-only t)
+  (waitqueue (make-waitqueue :name "task pool") :type waitqueue :read-only t)
+  (shutdown nil))
+(declaim (sb-ext:freeze-type task-pool))
+
+(setf (documentation 'task-pool-p 'function)
+      "Returns true if argument is a TASK-POOL, NIL otherwise."
+      (documentation 'task-pool-name 'function)
+      "Name of a TASK-POOL. SETFable.")
+
+(defmethod print-object ((pool task-pool) stream)
+  (print-unreadable-object (pool stream :type t :identity t)
+    (format stream "~@[~S ~](~D worker~:P~:[~;, shut down~])"
+            (task-pool-name pool)
+            (task-pool-size pool)
+            (task-pool-shutdown pool))))
+
+(defvar *task-pool* nil
+  "The TASK-POOL used by SUBMIT-TASK, PARALLEL-MAP and PARALLEL-REDUCE
+when none is given explicitly. If NIL, a pool with one worker per
+processor is created on first use.")
+
+;;; The worker running in this thread, if any.
+(defvar *worker* nil)
+
+(sb-ext:defglobal **default-task-pool** nil)
+
+(defun task-pool-size (pool)
+  "Returns the number of worker threads of POOL."
+  (length (task-pool-workers pool)))
+
+(defun n-processors ()
+  (max 1
+       #-win32 (sb-alien:alien-funcall
+                (sb-alien:extern-alien "sysconf"
+                                       (function sb-alien:long sb-alien:int))
+                sb-unix:sc-nprocessors-onln)
+       #+win32 (sb-alien:extern-alien "os_number_of_processors" sb-alien:int)))
+
+;;; Deque operations
+
+(defun %push-task (worker future)
+  (with-mutex ((worker-mutex worker))
+    (let* ((tasks (worker-tasks worker))
+           (length (length tasks))
+           (count (worker-count worker)))
+      (when (= count length)
+        (let ((new (make-array (* 2 length)))
+              (top (worker-top worker)))
+          (dotimes (i count)
+            (setf (svref new i) (svref tasks (mod (+ top i) length))))
+          (setf tasks new
+                length (* 2 length)
+                (worker-tasks worker) new
+                (worker-top worker) 0)))
+      (setf (svref tasks (mod (+ (worker-top worker) count) length)) future
+            (worker-count worker) (1+ count)))))
+
+(defun %pop-task (worker)
+  (with-mutex ((worker-mutex worker))
+    (let ((count (worker-count worker)))
+      (when (plusp count)
+        (let* ((tasks (worker-tasks worker))
+               (index (mod (+ (worker-top worker) count -1) (length tasks))))
+          (setf (worker-count worker) (1- count))
+          (shiftf (svref tasks index) 0))))))
+
+(defun %steal-task (worker)
+  ;; Don't queue up behind the owner or other thieves.
+  (with-mutex ((worker-mutex worker) :wait-p nil)
+    (let ((count (worker-count worker)))
+      (when (plusp count)
+        (let* ((tasks (worker-tasks worker))
+               (top (worker-top worker)))
+          (setf (worker-top worker) (mod (1+ top) (length tasks))
+                (worker-count worker) (1- count))
+          (shiftf (svref tasks top) 0))))))
+
+(defun %find-task (pool worker)
+  (or (and worker (%pop-task worker))
+      (values (dequeue (task-pool-injection pool)))
+      (let* ((workers (task-pool-workers pool))
+             (n (length workers))
+             (start (if worker (1+ (worker-index worker)) 0)))
+        (dotimes (i n)
+          (let ((victim (svref workers (mod (+ start i) n))))
+            (unless (eq victim worker)
+              (let ((task (%steal-task victim)))
+                (when task
+                  (return task)))))))))
+
+(defun %work-available-p (pool)
+  (or (not (queue-empty-p (task-pool-injection pool)))
+      (some (lambda (worker) (plusp (worker-count worker)))
+            (task-pool-workers pool))))
+
+(defun %notify-task-pool (pool)
+  (barrier (:memory))
+  (unless (zerop (task-pool-idle pool))
+    (with-mutex ((task-pool-mutex pool))
+      (condition-notify (task-pool-waitqueue pool)))))
+
+(defun %park-worker (pool)
+  (let ((mutex (task-pool-mutex pool)))
+    (with-mutex (mutex)
+      ;; Announce ourselves before looking for work one last time, so
+      ;; that a concurrent SUBMIT-TASK either sees us or we see its task.
+      (atomic-incf (task-pool-idle pool))
+      (unwind-protect
+           (unless (or (task-pool-shutdown pool) (%work-available-p pool))
+             (condition-wait (task-pool-waitqueue pool) mutex))
+        (atomic-decf (task-pool-idle pool))))))
+
+(defun %worker-loop (worker)
+  (let ((pool (worker-pool worker))
+        (*worker* worker))
+    (loop
+      (let ((task (%find-task pool worker)))
+        (cond (task
+               (%run-if-pending task))
+              ((task-pool-shutdown pool)
+               (return))
+              (t
+               (%park-worker pool)))))))
+
+(defun make-task-pool (&key name (size #+sb-thread (n-processors) #-sb-thread 0))
+  "Returns a new TASK-POOL with SIZE worker threads, by default one per
+processor. A pool with no workers runs each task when its value is first
+asked for."
+  (declare (type index size))
+  #-sb-thread
+  (unless (zerop size)
+    (error "Task pool workers require thread support."))
+  (let* ((pool (%make-task-pool name))
+         (workers (make-array size)))
+    (dotimes (i size)
+      (setf (svref workers i) (%make-worker pool i)))
+    (setf (task-pool-workers pool) workers)
+    #+sb-thread
+    (loop for worker across workers
+          do (setf (worker-thread worker)
+                   (make-thread #'%worker-loop
+                                :name (format nil "~@[~A ~]worker ~D"
+                                              name (worker-index worker))
+                                :arguments (list worker))))
+    pool))
+
+(defun shutdown-task-pool (pool &key (wait t))
+  "Stops POOL from accepting new tasks. Its workers exit once the tasks
+already submitted are done. If WAIT is true, waits for that to happen."
+  (declare (task-pool pool))
+  (setf (task-pool-shutdown pool) t)
+  (with-mutex ((task-pool-mutex pool))
+    (condition-broadcast (task-pool-waitqueue pool)))
+  (when wait
+    (loop for worker across (task-pool-workers pool)
+          for thread = (worker-thread worker)
+          when thread
+          do (join-thread thread :default nil)))
+  pool)
+
+(defun default-task-pool ()
+  (or *task-pool*
+      **default-task-pool**
+      (let ((new (make-task-pool :name "default task pool")))
+        (or (compare-and-swap (symbol-value '**default-task-pool**) nil new)
+            new))))
+
+(defun shutdown-default-task-pool ()
+  (let ((pool **default-task-pool**))
+    (when pool
+      (setf **default-task-pool** nil)
+      (shutdown-task-pool pool))))
+
+;;; Worker threads would prevent the core from being saved.
+(pushnew 'shutdown-default-task-pool sb-ext:*save-hooks*)
+
+(defun submit-task (function &key pool)
+  "Arranges for FUNCTION to be called with no arguments by a worker of
+POOL, which defaults to *TASK-POOL*. Returns a FUTURE for its values.
+
+FUNCTION is called with the deadline of the calling thread in effect, if
+any."
+  (let* ((pool (or pool (default-task-pool)))
+         (deadline sb-impl::*deadline*)
+         (future (%make-future (coerce function 'function)
+                               (when deadline
+                                 (sb-impl::deadline-internal-time deadline))
+                               (when deadline
+                                 (sb-impl::deadline-seconds deadline))))
+         (worker *worker*))
+    (when (task-pool-shutdown pool)
+      (error "~S has been shut down." pool))
+    (if (and worker (eq (worker-pool worker) pool))
+        (%push-task worker future)
+        (enqueue future (task-pool-injection pool)))
+    (%notify-task-pool pool)
+    future))
+
+(defun future-value (future &key timeout)
+  "Returns the values of FUTURE, waiting for them to be computed if
+necessary. If the task of FUTURE has not been started yet, the calling
+thread runs it itself.
+
+If the task signalled a SERIOUS-CONDITION, that condition is signalled
+again. If the task was cancelled, signals TASK-CANCELLED. If TIMEOUT is
+given and the values are not available in TIMEOUT seconds, signals
+SB-EXT:TIMEOUT. Waiting respects deadlines."
+  (declare (future future))
+  (%run-if-pending future)
+  (unless (%future-finished-p future)
+    (let ((worker *worker*)
+          (gate (future-gate future)))
+      (if worker
+          ;; Don't leave a pool thread idle: help out until FUTURE is done.
+          (let ((deadline (when timeout
+                            (+ (get-internal-real-time)
+                               (round (* timeout internal-time-units-per-second))))))
+            (loop until (%future-finished-p future)
+                  do (let ((task (%find-task (worker-pool worker) worker)))
+                       (cond (task
+                              (%run-if-pending task))
+                             ((and deadline (> (get-internal-real-time) deadline))
+                              (error 'timeout :seconds timeout))
+                             (t
+                              (wait-on-gate gate :timeout 0.001))))))
+          (unless (wait-on-gate gate :timeout timeout)
+            (error 'timeout :seconds timeout)))))
+  (barrier (:read))
+  (ecase (future-state future)
+    (:done (values-list (future-values future)))
+    (:failed (error (future-condition future)))
+    (:cancelled (error 'task-cancelled :future future))))
+
+;;;; Data parallelism
+
+;;; Call FUNCTION on consecutive subranges of [0, LENGTH), in parallel
+;;; on POOL, and return the list of their values in order.
+(defun %map-chunks (function length pool grain-size)
+  (declare (function function)
+           (index length))
+  (let* ((pool (or pool (default-task-pool)))
+         (grain-size (or grain-size
+                         (max 1 (ceiling length
+                                         (* 4 (max 1 (task-pool-size pool)))))))
+         (futures '()))
+    (declare (type (integer 1) grain-size))
+    (when (plusp length)
+      ;; Hand out all but the first chunk, then do that one here.
+      (loop for start from grain-size below length by grain-size
+            do (let ((start start)
+                     (end (min length (+ start grain-size))))
+                 (push (submit-task (lambda () (funcall function start end))
+                                    :pool pool)
+                       futures)))
+      (let ((first (funcall function 0 (min length grain-size))))
+        (cons first (mapcar #'future-value (nreverse futures)))))))
+
+(defun parallel-map (function vector &key pool grain-size)
+  "Returns a fresh SIMPLE-VECTOR holding the results of calling FUNCTION
+on each element of VECTOR. The calls are made in parallel by the workers
+of POOL, which defaults to *TASK-POOL*, in chunks of GRAIN-SIZE elements."
+  (let* ((function (coerce function 'function))
+         (length (length vector))
+         (result (make-array length)))
+    (%map-chunks (lambda (start end)
+                   (loop for i from start below end
+                         do (setf (svref result i)
+                                  (funcall function (aref vector i)))))
+                 length pool grain-size)
+    result))
+
+(defun parallel-reduce (function vector &key key (initial-value nil initial-value-p)
+                                             pool grain-size)
+  "Combines the elements of VECTOR using FUNCTION, like REDUCE, in parallel
+on the workers of POOL, which defaults to *TASK-POOL*. FUNCTION must be
+associative, since elements are combined in chunks of GRAIN-SIZE which
+are then combined in order."
+  (let* ((function (coerce function 'function))
+         (key (if key (coerce key 'function) #'identity))
+         (partials
+           (%map-chunks (lambda (start end)
+                          (let ((acc (funcall key (aref vector start))))
+                            (loop for i from (1+ start) below end
+                                  do (setf acc (funcall function acc
+                                                        (funcall key (aref vector i)))))
+                            acc))
+                        (length vector) pool grain-size)))
+    (cond (initial-value-p
+           (reduce function partials :initial-value initial-value))
+          (partials
+           (reduce function partials))
+          (t
+           (funcall function)))))
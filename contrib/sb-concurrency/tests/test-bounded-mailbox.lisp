@@ -0,0 +1,77 @@
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was written at
+;;;; Carnegie Mellon University and released into the public domain. The
+;;;; software is in the public domain and is provided with absolutely no
+;;;; warranty. See the COPYING and CREDITS files for more information.
+
+(in-package :sb-concurrency-test)
+
+(deftest bounded-mailbox-trivia.1
+    (let ((mbox (make-bounded-mailbox 3 :name "foof")))
+      (values (bounded-mailbox-p mbox)
+              (bounded-mailbox-p (make-mailbox))
+              (bounded-mailbox-name mbox)
+              (bounded-mailbox-capacity mbox)
+              (bounded-mailbox-empty-p mbox)))
+  t
+  nil
+  "foof"
+  4
+  t)
+
+(deftest bounded-mailbox.1
+    (let ((mbox (make-bounded-mailbox 2)))
+      (values (send-bounded-message mbox :a)
+              (send-bounded-message-no-hang mbox :b)
+              (send-bounded-message-no-hang mbox :c)
+              (send-bounded-message mbox :c :timeout 0.01)
+              (bounded-mailbox-count mbox)
+              (multiple-value-list (receive-bounded-message mbox))
+              (multiple-value-list (receive-bounded-message-no-hang mbox))
+              (multiple-value-list (receive-bounded-message-no-hang mbox))
+              (multiple-value-list (receive-bounded-message mbox :timeout 0.01))))
+  t
+  t
+  nil
+  nil
+  2
+  (:a t)
+  (:b t)
+  (nil nil)
+  (nil nil))
+
+(deftest bounded-mailbox.receive-pending
+    (let ((mbox (make-bounded-mailbox 1000)))
+      (dotimes (i 600)
+        (send-bounded-message mbox i))
+      (values (receive-pending-bounded-messages mbox 3)
+              (length (receive-pending-bounded-messages mbox 300))
+              (let ((rest (receive-pending-bounded-messages mbox)))
+                (list (length rest) (first rest)))
+              (receive-pending-bounded-messages mbox)))
+  (0 1 2)
+  300
+  (297 303)
+  nil)
+
+#+sb-thread
+(deftest bounded-mailbox.senders-wait
+    (let* ((mbox (make-bounded-mailbox 4))
+           (senders (loop for i below 8
+                          collect (make-thread
+                                   (lambda (i)
+                                     (dotimes (j 500)
+                                       (send-bounded-message mbox (+ (* i 500) j))))
+                                   :arguments i)))
+           (receivers (loop repeat 4
+                            collect (make-thread
+                                     (lambda ()
+                                       (loop while (nth-value
+                                                    1 (receive-bounded-message
+                                                       mbox :timeout 1))
+                                             count t))))))
+      (mapc #'join-thread senders)
+      (apply #'+ (mapcar #'join-thread receivers)))
+  4000)
@@ -0,0 +1,99 @@
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was written at
+;;;; Carnegie Mellon University and released into the public domain. The
+;;;; software is in the public domain and is provided with absolutely no
+;;;; warranty. See the COPYING and CREDITS files for more information.
+
+(in-package :sb-concurrency-test)
+
+(deftest bounded-queue.1
+    (let ((queue (make-bounded-queue 3 :name "foo")))
+      (values (bounded-queue-p queue)
+              (bounded-queue-p 42)
+              (bounded-queue-name queue)
+              (bounded-queue-capacity queue)
+              (bounded-queue-empty-p queue)))
+  t
+  nil
+  "foo"
+  4
+  t)
+
+(deftest bounded-queue.2
+    (let ((queue (make-bounded-queue 4)))
+      (values (loop for i below 6 collect (bounded-enqueue-no-hang i queue))
+              (bounded-queue-count queue)
+              (loop repeat 5 collect (multiple-value-list
+                                      (bounded-dequeue-no-hang queue)))
+              (bounded-queue-empty-p queue)))
+  (t t t t nil nil)
+  4
+  ((0 t) (1 t) (2 t) (3 t) (nil nil))
+  t)
+
+;;; Wrapping around the ring many times, with batches straddling the end.
+(deftest bounded-queue.3
+    (let ((queue (make-bounded-queue 8))
+          (out (make-array 5))
+          (result '()))
+      (dotimes (i 20 (values (length result)
+                             (equal (reverse result)
+                                    (loop for i below 20
+                                          nconc (loop for j below 5
+                                                      collect (+ (* 10 i) j))))
+                             (bounded-queue-empty-p queue)))
+        (assert (= 5 (bounded-enqueue-batch
+                      queue (coerce (loop for j below 5 collect (+ (* 10 i) j))
+                                    'vector))))
+        (assert (= 5 (bounded-dequeue-batch queue out)))
+        (loop for x across out do (push x result))))
+  100
+  t
+  t)
+
+(deftest bounded-queue.4
+    (let ((queue (make-bounded-queue 2)))
+      (values (bounded-enqueue-batch queue #(a b c d e) :start 1)
+              (bounded-enqueue :x queue :timeout 0.01)
+              (multiple-value-list (bounded-dequeue queue :timeout 0.01))
+              (bounded-dequeue-batch queue (make-array 3) :end 2)
+              (multiple-value-list (bounded-dequeue queue :timeout 0.01))))
+  2
+  nil
+  (b t)
+  1
+  (nil nil))
+
+#+sb-thread
+(deftest bounded-queue.producers-consumers
+    (let* ((queue (make-bounded-queue 16))
+           (n 10000)
+           (producers (loop for p below 4
+                            collect (make-thread
+                                     (lambda (p)
+                                       (dotimes (i n)
+                                         (bounded-enqueue (+ (* p n) i) queue)))
+                                     :arguments p)))
+           (consumers (loop repeat 4
+                            collect (make-thread
+                                     (lambda ()
+                                       (loop for (x ok) = (multiple-value-list
+                                                           (bounded-dequeue
+                                                            queue :timeout 1))
+                                             while ok
+                                             collect x)))))
+           (seen (make-array (* 4 n) :initial-element nil)))
+      (mapc #'join-thread producers)
+      (dolist (list (mapcar #'join-thread consumers))
+        ;; Each producer's values are received in order by any one consumer.
+        (let ((last (make-array 4 :initial-element -1)))
+          (dolist (x list)
+            (multiple-value-bind (p i) (floor x n)
+              (assert (> i (aref last p)))
+              (setf (aref last p) i)
+              (assert (not (aref seen x)))
+              (setf (aref seen x) t)))))
+      (every #'identity seen))
+  t)
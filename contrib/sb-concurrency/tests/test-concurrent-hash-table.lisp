@@ -0,0 +1,159 @@
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was written at
+;;;; Carnegie Mellon University and released into the public domain. The
+;;;; software is in the public domain and is provided with absolutely no
+;;;; warranty. See the COPYING and CREDITS files for more information.
+
+(in-package :sb-concurrency-test)
+
+(deftest concurrent-hash-table.1
+    (let ((table (make-concurrent-hash-table :name "foo")))
+      (setf (concurrent-gethash 'a table) 1
+            (concurrent-gethash 1.5d0 table) 2
+            (concurrent-gethash 'a table) 3)
+      (values (concurrent-hash-table-p table)
+              (concurrent-hash-table-p 42)
+              (concurrent-hash-table-name table)
+              (concurrent-hash-table-test table)
+              (concurrent-hash-table-count table)
+              (multiple-value-list (concurrent-gethash 'a table))
+              (multiple-value-list (concurrent-gethash 1.5d0 table))
+              (multiple-value-list (concurrent-gethash 'b table :none))
+              (concurrent-remhash 'a table)
+              (concurrent-remhash 'a table)
+              (concurrent-hash-table-count table)))
+  t
+  nil
+  "foo"
+  eql
+  2
+  (3 t)
+  (2 t)
+  (:none nil)
+  t
+  nil
+  1)
+
+;;; Keys without a stable hash go to the locked side table.
+(deftest concurrent-hash-table.2
+    (let ((table (make-concurrent-hash-table :test 'eq))
+          (cons (list 1))
+          (instance (make-gate)))
+      (setf (concurrent-gethash cons table) :cons
+            (concurrent-gethash instance table) :instance
+            (concurrent-gethash #\x table) :char)
+      (sb-ext:gc :full t)
+      (values (concurrent-gethash cons table)
+              (concurrent-gethash (list 1) table)
+              (concurrent-gethash instance table)
+              (concurrent-gethash #\x table)
+              (concurrent-hash-table-count table)
+              (concurrent-remhash cons table)
+              (concurrent-hash-table-count table)))
+  :cons
+  nil
+  :instance
+  :char
+  3
+  t
+  2)
+
+(deftest concurrent-hash-table.3
+    (let ((equal (make-concurrent-hash-table :test 'equal))
+          (equalp (make-concurrent-hash-table :test #'equalp)))
+      (setf (concurrent-gethash (list "a" 1) equal) 1
+            (concurrent-gethash "Foo" equalp) 2)
+      (values (concurrent-gethash (list "a" 1) equal)
+              (concurrent-gethash (list "A" 1) equal)
+              (concurrent-gethash "FOO" equalp)))
+  1
+  nil
+  2)
+
+;;; Growing many times, then clearing.
+(deftest concurrent-hash-table.4
+    (let ((table (make-concurrent-hash-table :size 1))
+          (n 10000))
+      (dotimes (i n)
+        (setf (concurrent-gethash i table) (- i)))
+      (let ((sum 0)
+            (count 0))
+        (concurrent-maphash (lambda (k v)
+                              (assert (= k (- v)))
+                              (incf count)
+                              (incf sum k))
+                            table)
+        (values (concurrent-hash-table-count table)
+                count
+                sum
+                (loop for i below n always (eql (concurrent-gethash i table) (- i)))
+                (progn (dotimes (i n)
+                         (when (evenp i)
+                           (concurrent-remhash i table)))
+                       (concurrent-hash-table-count table))
+                (concurrent-gethash 2 table)
+                (concurrent-gethash 3 table)
+                (concurrent-hash-table-count (concurrent-clrhash table))
+                (concurrent-gethash 3 table))))
+  10000
+  10000
+  49995000
+  t
+  5000
+  nil
+  -3
+  0
+  nil)
+
+#+sb-thread
+(deftest concurrent-hash-table.readers-writers
+    (let* ((table (make-concurrent-hash-table :size 1))
+           (n 20000)
+           (writers (loop for w below 4
+                          collect (make-thread
+                                   (lambda (w)
+                                     (loop for i from w below n by 4
+                                           do (setf (concurrent-gethash i table) i)
+                                              (when (zerop (mod i 3))
+                                                (concurrent-remhash i table))))
+                                   :arguments w)))
+           (readers (loop repeat 4
+                          collect (make-thread
+                                   (lambda ()
+                                     ;; Any value seen must be the one written.
+                                     (loop repeat 5
+                                           always (loop for i below n
+                                                        for value = (concurrent-gethash i table)
+                                                        always (or (null value)
+                                                                   (eql value i)))))))))
+      (mapc #'join-thread writers)
+      (values (every #'join-thread readers)
+              (concurrent-hash-table-count table)
+              (loop for i below n
+                    always (eq (concurrent-gethash i table)
+                               (if (zerop (mod i 3)) nil i)))))
+  t
+  13333
+  t)
+
+;;; Many small tables growing through several resizes while all writers
+;;; insert at once: no entry may be lost to a resize started from a
+;;; vector which another resize had already copied.
+#+sb-thread
+(deftest concurrent-hash-table.resize-race
+    (loop repeat 50
+          always (let* ((table (make-concurrent-hash-table :size 1))
+                        (n 4000)
+                        (threads (loop for w below 8
+                                       collect (make-thread
+                                                (lambda (w)
+                                                  (loop for i from w below n by 8
+                                                        do (setf (concurrent-gethash i table) i)))
+                                                :arguments w))))
+                   (mapc #'join-thread threads)
+                   (and (= (concurrent-hash-table-count table) n)
+                        (loop for i below n
+                              always (eql (concurrent-gethash i table) i)))))
+  t)
@@ -0,0 +1,129 @@
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was written at
+;;;; Carnegie Mellon University and released into the public domain. The
+;;;; software is in the public domain and is provided with absolutely no
+;;;; warranty. See the COPYING and CREDITS files for more information.
+
+(in-package :sb-concurrency-test)
+
+;;; A pool without workers runs tasks when their values are asked for.
+(deftest task-pool.inline
+    (let* ((pool (make-task-pool :size 0))
+           (ran nil)
+           (future (submit-task (lambda () (setf ran t) (values 1 2))
+                                :pool pool)))
+      (values (task-pool-p pool)
+              (task-pool-size pool)
+              (futurep future)
+              ran
+              (multiple-value-list (future-value future))
+              (future-done-p future)))
+  t
+  0
+  t
+  nil
+  (1 2)
+  t)
+
+(deftest task-pool.error
+    (let* ((pool (make-task-pool :size 0))
+           (future (submit-task (lambda () (error "oops")) :pool pool)))
+      (values (handler-case (future-value future)
+                (simple-error (e) (simple-condition-format-control e)))
+              (cancel-future future)))
+  "oops"
+  nil)
+
+(deftest task-pool.cancel
+    (let* ((pool (make-task-pool :size 0))
+           (future (submit-task (lambda () :never) :pool pool)))
+      (values (cancel-future future)
+              (future-done-p future)
+              (handler-case (future-value future)
+                (task-cancelled (c) (eq future (task-cancelled-future c))))))
+  t
+  t
+  t)
+
+(deftest task-pool.promise
+    (let ((promise (make-promise)))
+      (values (future-done-p promise)
+              (fulfill-promise promise :a :b)
+              (fulfill-promise promise :c)
+              (multiple-value-list (future-value promise))))
+  nil
+  t
+  nil
+  (:a :b))
+
+(deftest task-pool.parallel-map/reduce
+    (let ((pool (make-task-pool :size #+sb-thread 4 #-sb-thread 0))
+          (vector (coerce (loop for i below 1000 collect i) 'vector)))
+      (unwind-protect
+           (values (equalp (parallel-map #'1+ vector :pool pool)
+                           (map 'vector #'1+ vector))
+                   (parallel-reduce #'+ vector :pool pool :grain-size 7)
+                   (parallel-reduce #'+ vector :pool pool :key #'1+
+                                               :initial-value 10)
+                   (parallel-reduce #'+ #() :pool pool)
+                   (parallel-reduce #'max #(3) :pool pool))
+        (shutdown-task-pool pool)))
+  t
+  499500
+  500510
+  0
+  3)
+
+#+sb-thread
+(progn
+
+;;; Tasks spawning and waiting for subtasks must not deadlock even on a
+;;; pool with a single worker.
+(deftest task-pool.nested
+    (let ((pool (make-task-pool :size 1)))
+      (unwind-protect
+           (labels ((fib (n)
+                      (if (< n 2)
+                          n
+                          (let ((a (submit-task (lambda () (fib (- n 1)))
+                                                :pool pool))
+                                (b (fib (- n 2))))
+                            (+ (future-value a) b)))))
+             (future-value (submit-task (lambda () (fib 15)) :pool pool)
+                           :timeout +timeout+))
+        (shutdown-task-pool pool)))
+  610)
+
+(deftest task-pool.deadline
+    (let ((pool (make-task-pool :size 2))
+          (gate (make-gate)))
+      (unwind-protect
+           (let ((future (sb-sys:with-deadline (:seconds 0.1)
+                           (submit-task (lambda () (wait-on-gate gate))
+                                        :pool pool))))
+             (handler-case (progn (future-value future :timeout +timeout+)
+                                  :no-timeout)
+               (sb-sys:deadline-timeout ()
+                 :deadline)))
+        (open-gate gate)
+        (shutdown-task-pool pool)))
+  :deadline)
+
+(deftest task-pool.interrupt
+    (let* ((pool (make-task-pool :size 1))
+           (started (make-gate))
+           (future (submit-task (lambda () (open-gate started) (loop (sleep 1)))
+                                :pool pool)))
+      (unwind-protect
+           (progn
+             (wait-on-gate started)
+             (values (cancel-future future :interrupt t)
+                     (handler-case (future-value future :timeout +timeout+)
+                       (task-cancelled () :cancelled))))
+        (shutdown-task-pool pool)))
+  t
+  :cancelled)
+
+) ; #+sb-thread
@@ -0,0 +1,157 @@
+;;;; An ASDF plan that compiles files in forked copies of this image,
+;;;; so that files which don't depend on each other are compiled at the
+;;;; same time.
+
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was
+;;;; written at Carnegie Mellon University and released into the
+;;;; public domain. The software is in the public domain and is
+;;;; provided with absolutely no warranty. See the COPYING and CREDITS
+;;;; files for more information.
+
+(defpackage "SB-PARALLEL-ASDF"
+  (:use "COMMON-LISP" "ASDF/ACTION" "ASDF/LISP-ACTION" "ASDF/PLAN")
+  (:export "PARALLEL-PLAN" "*WORKERS*"))
+
+(in-package "SB-PARALLEL-ASDF")
+
+(defvar *workers* nil
+  "The largest number of worker processes a PARALLEL-PLAN runs at once,
+unless the plan is given :WORKERS. If NIL, one per processor.")
+
+(defclass parallel-plan (sequential-plan)
+  ((workers :initform *workers* :initarg :workers :reader plan-workers))
+  (:documentation
+   "A plan which performs each action that only produces files, such as
+COMPILE-OP of a source file, in a child process forked from this image as
+soon as the actions it depends on are done, and performs everything else,
+such as LOAD-OP, in this image in the order of a SEQUENTIAL-PLAN.
+Without fork(), it is a SEQUENTIAL-PLAN."))
+
+#-win32
+(progn
+
+(defun n-processors ()
+  (max 1 (sb-alien:alien-funcall
+          (sb-alien:extern-alien "sysconf"
+                                 (function sb-alien:long sb-alien:int))
+          sb-unix:sc-nprocessors-onln)))
+
+;;; Actions with output files and no effect on the image they are
+;;; performed in are the ones ASDF says could as well have been done in
+;;; another image.
+(defun forkable-p (action)
+  (not (needed-in-image-p (action-operation action) (action-component action))))
+
+;;; Perform ACTION in a child process and return its pid. The child
+;;; exits with code 0 if the action succeeded.
+(defun fork-worker (action)
+  (finish-output *standard-output*)
+  (finish-output *error-output*)
+  (let ((pid (sb-posix:fork)))
+    (if (zerop pid)
+        (let ((code (handler-case
+                        ;; Report undefined functions and the like at the
+                        ;; end of this file, since the compilation unit
+                        ;; of the parent never ends in the child.
+                        (with-compilation-unit (:override t)
+                          (perform (action-operation action)
+                                   (action-component action))
+                          0)
+                      (serious-condition (condition)
+                        (format *error-output* "~&~@<~A failed in process ~D: ~A~:@>~%"
+                                (action-description (action-operation action)
+                                                    (action-component action))
+                                (sb-posix:getpid) condition)
+                        1))))
+          (finish-output *standard-output*)
+          (finish-output *error-output*)
+          ;; Don't unwind: the cleanup forms on the stack belong to the parent.
+          (sb-ext:exit :code code :abort t))
+        pid)))
+
+;;; Wait for any child process to exit, and return its pid and whether
+;;; it exited with code 0.
+(defun wait-for-worker ()
+  (loop
+    (multiple-value-bind (pid status)
+        (handler-case (sb-posix:waitpid -1 0)
+          (sb-posix:syscall-error (condition)
+            (unless (= (sb-posix:syscall-errno condition) sb-posix:eintr)
+              (error condition))))
+      (when pid
+        (return (values pid
+                        (and (sb-posix:wifexited status)
+                             (zerop (sb-posix:wexitstatus status)))))))))
+
+(defmethod perform-plan ((plan parallel-plan) &key)
+  (let ((actions (remove-if (lambda (action)
+                              (action-already-done-p plan
+                                                     (action-operation action)
+                                                     (action-component action)))
+                            (plan-actions plan)))
+        ;; Actions of this plan which have not finished yet
+        (pending (make-hash-table :test 'equal))
+        ;; Workers by pid, to the action they perform
+        (workers (make-hash-table))
+        (max-workers (or (plan-workers plan) (n-processors))))
+    (dolist (action actions)
+      (setf (gethash action pending) t))
+    (labels ((ready-p (action)
+               (loop for dependency in (direct-dependencies
+                                        (action-operation action)
+                                        (action-component action))
+                     never (gethash dependency pending)))
+             (perform-here (action)
+               (setf actions (delete action actions :test #'eq))
+               (perform-with-restarts (action-operation action)
+                                      (action-component action))
+               (finish action))
+             (finish (action)
+               (remhash action pending)
+               (mark-as-done plan (action-operation action)
+                             (action-component action)))
+             (next-in-image ()
+               ;; The first action affecting this image, or a PREPARE-OP,
+               ;; which only orders actions, if its dependencies are done.
+               (loop with first = t
+                     for action in actions
+                     unless (forkable-p action)
+                       do (when (and (or first
+                                         (typep (action-operation action) 'prepare-op))
+                                     (ready-p action))
+                            (return action))
+                          (setq first nil))))
+      (loop while (or actions (plusp (hash-table-count workers)))
+            do (dolist (action (remove-if-not (lambda (action)
+                                                (and (forkable-p action)
+                                                     (ready-p action)))
+                                              actions))
+                 (when (>= (hash-table-count workers) max-workers)
+                   (return))
+                 (setf (gethash (fork-worker action) workers) action
+                       actions (delete action actions :test #'eq)))
+               (let ((action (next-in-image)))
+                 (cond (action
+                        (perform-here action))
+                       ((plusp (hash-table-count workers))
+                        (multiple-value-bind (pid successp) (wait-for-worker)
+                          (let ((action (gethash pid workers)))
+                            ;; Children of this image started by others
+                            ;; are none of our business.
+                            (when action
+                              (remhash pid workers)
+                              (cond (successp
+                                     (mark-operation-done (action-operation action)
+                                                          (action-component action))
+                                     (finish action))
+                                    (t
+                                     ;; Do it again here, so that errors and
+                                     ;; restarts are those of a sequential build.
+                                     (perform-here action)))))))
+                       (t
+                        ;; Nothing is running, so everything before the
+                        ;; first action is done.
+                        (perform-here (first actions))))))))))
@@ -0,0 +1,102 @@
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was
+;;;; written at Carnegie Mellon University and released into the
+;;;; public domain. The software is in the public domain and is
+;;;; provided with absolutely no warranty. See the COPYING and CREDITS
+;;;; files for more information.
+
+(defpackage "SB-PARALLEL-ASDF-TEST"
+  (:use "COMMON-LISP" "SB-PARALLEL-ASDF" "SB-RT"))
+
+(in-package "SB-PARALLEL-ASDF-TEST")
+
+;;; Files of the test system push their names here when loaded.
+(defvar *loaded* nil)
+
+;;; The pid of the process compiling the file this appears in.
+(defmacro compiling-pid ()
+  (sb-posix:getpid))
+
+(defvar *directory*)
+
+;;; Run BODY with *DIRECTORY* naming a scratch directory, which is
+;;; removed afterwards.
+(defmacro with-test-directory (&body body)
+  `(let ((*directory* (format nil "~A/sb-parallel-asdf-test-~D/"
+                              (or (sb-ext:posix-getenv "TMPDIR") "/tmp")
+                              (sb-posix:getpid))))
+     (unwind-protect (progn ,@body)
+       (when (probe-file *directory*)
+         (sb-ext:delete-directory *directory* :recursive t)))))
+
+;;; Write the files of a system named NAME with FILES, a list of
+;;; (NAME DEPENDS-ON . FORMS), and return the system. Each file also
+;;; records the pid of the process compiling it.
+(defun write-system (name files)
+  (ensure-directories-exist *directory*)
+  (dolist (file files)
+    (destructuring-bind (file-name depends-on &rest forms) file
+      (declare (ignore depends-on))
+      (with-open-file (stream (format nil "~A~A.lisp" *directory* file-name)
+                              :direction :output :if-exists :supersede)
+        (with-standard-io-syntax
+          (let ((*package* (find-package "SB-PARALLEL-ASDF-TEST")))
+            (format stream "(in-package \"SB-PARALLEL-ASDF-TEST\")~%")
+            (dolist (form forms)
+              (print form stream))
+            (print `(push (cons ,file-name (compiling-pid)) *loaded*)
+                   stream))))))
+  (eval `(asdf:defsystem ,name
+           :pathname ,*directory*
+           :components ,(loop for (file-name depends-on) in files
+                              collect `(:file ,file-name :depends-on ,depends-on))))
+  (asdf:find-system name))
+
+(defun load-in-parallel (system workers)
+  (setq *loaded* nil)
+  (asdf:load-system system :force t
+                           :plan-class 'parallel-plan
+                           :plan-options (list :workers workers))
+  (reverse *loaded*))
+
+#-win32
+(deftest parallel-plan.1
+    (with-test-directory
+      (let* ((system (write-system "sb-parallel-asdf-test-1"
+                                   '(("a" ())
+                                     ("b" ())
+                                     ("c" ("a" "b")
+                                      (defun c-answer () 42))
+                                     ("d" ())
+                                     ("e" ("c" "d")))))
+             (loaded (load-in-parallel system 3)))
+        (values (mapcar #'car loaded)
+                ;; No file was compiled in this image.
+                (notany (lambda (file) (= (cdr file) (sb-posix:getpid))) loaded)
+                (funcall 'c-answer))))
+  ("a" "b" "c" "d" "e")
+  t
+  42)
+
+;;; A file whose compilation fails in a worker is compiled again in this
+;;; image.
+#-win32
+(deftest parallel-plan.2
+    (with-test-directory
+      (let* ((pid (sb-posix:getpid))
+             (system (write-system
+                      "sb-parallel-asdf-test-2"
+                      `(("f" ()
+                         (eval-when (:compile-toplevel)
+                           (unless (= (sb-posix:getpid) ,pid)
+                             (error "not in the parent"))))
+                        ("g" ("f")))))
+             (loaded (load-in-parallel system 2)))
+        (values (mapcar #'car loaded)
+                (= (cdr (first loaded)) pid)
+                (/= (cdr (second loaded)) pid))))
+  ("f" "g")
+  t
+  t)
@@ -0,0 +1,102 @@
+;;;; Saving profiles for the compiler and for SAVE-LISP-AND-DIE to
+;;;; optimize for
+
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was
+;;;; written at Carnegie Mellon University and released into the
+;;;; public domain. The software is in the public domain and is
+;;;; provided with absolutely no warranty. See the COPYING and CREDITS
+;;;; files for more information.
+
+(in-package #:sb-sprof)
+
+;;; A profile feedback file has one form per line: first (:SAMPLES N),
+;;; then (:FUNCTION NAME COUNT) for the samples in each function, and
+;;; (:CALL CALLER CALLEE COUNT) for the samples in which CALLER was
+;;; calling CALLEE. Local functions and lambdas are counted as the
+;;; global function they are in, which is what the compiler knows
+;;; about when it compiles a call.
+
+;;; The name of the global function to count the samples of a node
+;;; named NAME towards, or NIL if there is none.
+(defun feedback-name (name)
+  (let ((name (sb-c::profile-feedback-name name)))
+    (when (legal-fun-name-p name)
+      name)))
+
+(defun write-profile-feedback (pathname &key call-graph)
+  "Write the number of samples taken in each function, and of each call
+from one function to another, in CALL-GRAPH or the latest profiling
+results, to PATHNAME, for READ-PROFILE-FEEDBACK. Return PATHNAME, or NIL
+if there are no samples."
+  (let ((graph (or call-graph
+                   (and *samples*
+                        (make-call-graph *samples* most-positive-fixnum))))
+        (functions (make-hash-table :test 'equal))
+        (calls (make-hash-table :test 'equal)))
+    (when graph
+      (dolist (node (graph-vertices graph))
+        (let ((caller (feedback-name (node-name node))))
+          (when caller
+            (when (plusp (node-count node))
+              (incf (gethash caller functions 0) (node-count node)))
+            (do-edges (call callee node)
+              (let ((callee (feedback-name (node-name callee))))
+                (when (and callee (not (equal caller callee)))
+                  (incf (gethash (cons caller callee) calls 0)
+                        (call-count call))))))))
+      (flet ((sorted (table)
+               (sort (loop for key being each hash-key of table
+                             using (hash-value count)
+                           collect (cons key count))
+                     #'> :key #'cdr)))
+        (with-open-file (stream pathname :direction :output
+                                         :if-exists :supersede)
+          (with-standard-io-syntax
+            (let ((*package* (find-package "KEYWORD"))
+                  (*print-pretty* nil))
+              (format stream "~S~%" (list :samples (call-graph-nsamples graph)))
+              (loop for (name . count) in (sorted functions)
+                    do (format stream "~S~%" (list :function name count)))
+              (loop for ((caller . callee) . count) in (sorted calls)
+                    do (format stream "~S~%" (list :call caller callee count)))))))
+      pathname)))
+
+(defun read-profile-feedback (pathname &key (min-percent 1))
+  "Read a profile written by WRITE-PROFILE-FEEDBACK from PATHNAME, and
+return two values: an EQUAL hash table with a key (CALLER . CALLEE) for
+each call from one function to another found in at least MIN-PERCENT of
+the samples, to bind SB-EXT:*PROFILE-FEEDBACK* to while compiling, and a
+list of the names of the functions samples were taken in, most samples
+first, to pass as :ROOT-STRUCTURES to SAVE-LISP-AND-DIE. Functions
+whose names can't be read in this image are left out."
+  (let ((calls (make-hash-table :test 'equal))
+        (functions '()))
+    (with-open-file (stream pathname)
+      (with-standard-io-syntax
+        (let ((*package* (find-package "KEYWORD"))
+              (*read-eval* nil)
+              (nsamples nil))
+          (loop for line = (read-line stream nil)
+                while line
+                do (let ((entry (handler-case (read-from-string line)
+                                  ;; a package which doesn't exist here
+                                  (reader-error () nil))))
+                     (when (consp entry)
+                       (destructuring-bind (kind &rest args) entry
+                         (case kind
+                           (:samples
+                            (setq nsamples (first args)))
+                           (:function
+                            (push (first args) functions))
+                           (:call
+                            (destructuring-bind (caller callee count) args
+                              (unless nsamples
+                                (error "~S is not a profile feedback file."
+                                       pathname))
+                              (when (>= (* count 100) (* min-percent nsamples))
+                                (setf (gethash (cons caller callee) calls)
+                                      t))))))))))))
+    (values calls (nreverse functions))))
@@ -18,6 +18,9 @@
    #:*report-sort-by* #:*report-sort-order*
    #:report
 
+   ;; Profile feedback
+   #:write-profile-feedback #:read-profile-feedback
+
    ;; Interface
    #:*sample-interval* #:*max-samples*
    #:start-profiling #:stop-profiling #:with-profiling
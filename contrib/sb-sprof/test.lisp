@@ -74,6 +74,19 @@
   (delete-file *compiler-output*)
   (let ((*standard-output* (make-broadcast-stream)))
     (test)
+    (let* ((directory (format nil "~A/sb-sprof-test-~D/"
+                              (or (sb-ext:posix-getenv "TMPDIR") "/tmp")
+                              (sb-unix:unix-getpid)))
+           (feedback (merge-pathnames "feedback.txt" directory)))
+      (ensure-directories-exist directory)
+      (unwind-protect
+           (progn
+             (write-profile-feedback feedback)
+             (multiple-value-bind (calls functions)
+                 (read-profile-feedback feedback :min-percent 0)
+               (assert (hash-table-p calls))
+               (assert (member 'test-0 functions))))
+        (sb-ext:delete-directory directory :recursive t)))
     (consing-test)
     ;; This test shows that STOP-SAMPLING and START-SAMPLING on a thread do something.
     ;; Based on rev b6bf65d9 it would seem that the API got broken a little.
@@ -31,13 +31,23 @@
   (declare (fixnum count))
   (shift-towards-end most-positive-word (- count)))
 
+;;; FILL-WORDS and COPY-WORDS are word loops which use vector stores when
+;;; there are enough words, and non-temporal stores when filling very many.
+#+x86-64
+(progn
+  (defun fill-words (vector start count value)
+    (fill-words vector start count value))
+  (defun copy-words (src src-start dst dst-start count)
+    (copy-words src src-start dst dst-start count)))
+
 
 ;;; the actual bashers and common uses of same
 
 (eval-when (:compile-toplevel :load-toplevel :execute)
   (defconstant min-bytes-c-call-threshold
     ;; mostly just guessing here
-    #+(or x86 x86-64 ppc ppc64) 128
+    #+x86-64 1024 ; below which COPY-WORDS wins by not calling out
+    #+(or x86 ppc ppc64) 128
     #-(or x86 x86-64 ppc ppc64) 256))
 
 (defmacro verify-src/dst-bits-per-elt (source destination expect-bits-per-element)
@@ -90,6 +100,9 @@
               (%set-vector-raw-bits src dst-index
                (%vector-raw-bits src (the index src-index)))))
          (up ()
+           #+x86-64
+           '(copy-words src src-start dst dst-start (- dst-end dst-start))
+           #-x86-64
            '(do ((dst-index dst-start (the index (1+ dst-index)))
                  (src-index src-start (the index (1+ src-index))))
                 ((>= dst-index dst-end))
@@ -272,6 +285,10 @@
                                                      (word-logical-andc2 (%vector-raw-bits dst dst-word-offset)
                                                                          mask))))
                          (incf dst-word-offset))))
+                  #+x86-64
+                  (progn (fill-words dst dst-word-offset interior value)
+                         (incf dst-word-offset interior))
+                  #-x86-64
                   (let ((end (+ dst-word-offset interior)))
                     (declare (type ,word-offset end))
                     (do ()
@@ -850,3 +867,244 @@
 (clear-info :function :inlinep '%bit-position/1)
 
 (run-bit-position-assertions)
+
+;;;; searching and comparing vectors of octets
+
+;;; SIMPLE-BASE-STRINGs and vectors of (UNSIGNED-BYTE 8) or (SIGNED-BYTE 8)
+;;; all store one octet per element, so the functions below accept any
+;;; SIMPLE-OCTET-VECTOR and read its elements as (UNSIGNED-BYTE 8). The
+;;; octet to look for is the CHAR-CODE of a BASE-CHAR or the low 8 bits of
+;;; a signed byte. On x86-64 they examine 32 octets at a time using
+;;; OCTET-MATCH-MASK and OCTET-COMPARE-MASK. Elsewhere they are simple loops,
+;;; no worse than the generic sequence functions they are used in place of.
+;;; Those which use the mask functions are compiled twice on x86-64, so that
+;;; a CPU with AVX2 runs a version that does not test for it on each block.
+
+#+x86-64
+(progn
+  (defun octet-match-mask (vector index octet)
+    (octet-match-mask vector index octet))
+  (defun octet-compare-mask (vector1 index1 vector2 index2)
+    (octet-compare-mask vector1 index1 vector2 index2)))
+
+(macrolet ((octet-ref (vector index)
+             `(aref (truly-the (simple-array (unsigned-byte 8) (*)) ,vector)
+                    ,index))
+           (lowest-bit (mask)
+             `(truly-the (mod 32)
+                         (%primitive unsigned-word-find-first-bit ,mask)))
+           (highest-bit (mask)
+             `(1- (integer-length (truly-the (unsigned-byte 32) ,mask))))
+           #-x86-64
+           (define-cpu-dispatched-function (name lambda-list &body body)
+             `(defun ,name ,lambda-list ,@body)))
+
+  ;; Return the index of the first (or last, if FROM-END) octet equal to
+  ;; OCTET between START and END, or NIL.
+  (define-cpu-dispatched-function %octet-position
+      (octet vector from-end start end)
+    (declare (type (unsigned-byte 8) octet)
+             (simple-octet-vector vector)
+             (index start end)
+             (optimize (speed 3) (safety 0)))
+    (if from-end
+        (let ((i end))
+          (declare (index i))
+          #+x86-64
+          (loop while (>= i (+ start 32))
+                do (decf i 32)
+                   (let ((mask (octet-match-mask vector i octet)))
+                     (unless (zerop mask)
+                       (return-from %octet-position (+ i (highest-bit mask))))))
+          (loop while (> i start)
+                do (decf i)
+                   (when (= (octet-ref vector i) octet)
+                     (return i))))
+        (let ((i start))
+          (declare (index i))
+          #+x86-64
+          (loop while (<= (+ i 32) end)
+                do (let ((mask (octet-match-mask vector i octet)))
+                     (unless (zerop mask)
+                       (return-from %octet-position (+ i (lowest-bit mask)))))
+                   (incf i 32))
+          (loop while (< i end)
+                do (when (= (octet-ref vector i) octet)
+                     (return i))
+                   (incf i)))))
+
+  ;; Return the number of octets equal to OCTET between START and END.
+  (define-cpu-dispatched-function %octet-count (octet vector start end)
+    (declare (type (unsigned-byte 8) octet)
+             (simple-octet-vector vector)
+             (index start end)
+             (optimize (speed 3) (safety 0)))
+    (let ((count 0)
+          (i start))
+      (declare (index count i))
+      #+x86-64
+      (loop while (<= (+ i 32) end)
+            do (incf count (logcount (octet-match-mask vector i octet)))
+               (incf i 32))
+      (loop while (< i end)
+            do (when (= (octet-ref vector i) octet)
+                 (incf count))
+               (incf i))
+      count))
+
+  ;; Return how many of the LENGTH octets from START1 in VECTOR1 and from
+  ;; START2 in VECTOR2 are equal before the first pair that is not.
+  (define-cpu-dispatched-function %octet-mismatch
+      (vector1 start1 vector2 start2 length)
+    (declare (simple-octet-vector vector1 vector2)
+             (index start1 start2 length)
+             (optimize (speed 3) (safety 0)))
+    (let ((i 0))
+      (declare (index i))
+      #+x86-64
+      (loop while (<= (+ i 32) length)
+            do (let ((mask (logxor (octet-compare-mask vector1 (+ start1 i)
+                                                       vector2 (+ start2 i))
+                                   #xffffffff)))
+                 (unless (zerop mask)
+                   (return-from %octet-mismatch (+ i (lowest-bit mask)))))
+               (incf i 32))
+      (loop while (and (< i length)
+                       (= (octet-ref vector1 (+ start1 i))
+                          (octet-ref vector2 (+ start2 i))))
+            do (incf i))
+      i))
+
+  ;; Like %OCTET-MISMATCH, but compare the LENGTH octets before END1 and END2
+  ;; from the end, returning how many at the end are equal.
+  (define-cpu-dispatched-function %octet-mismatch-from-end
+      (vector1 end1 vector2 end2 length)
+    (declare (simple-octet-vector vector1 vector2)
+             (index end1 end2 length)
+             (optimize (speed 3) (safety 0)))
+    (let ((i 0))
+      (declare (index i))
+      #+x86-64
+      (loop while (<= (+ i 32) length)
+            do (let ((mask (logxor (octet-compare-mask vector1 (- end1 i 32)
+                                                       vector2 (- end2 i 32))
+                                   #xffffffff)))
+                 (unless (zerop mask)
+                   (return-from %octet-mismatch-from-end
+                     (+ i (- 31 (highest-bit mask))))))
+               (incf i 32))
+      (loop while (and (< i length)
+                       (= (octet-ref vector1 (- end1 i 1))
+                          (octet-ref vector2 (- end2 i 1))))
+            do (incf i))
+      i))
+
+  ;; Return the index in VECTOR2 of the first (or last, if FROM-END)
+  ;; occurrence between START2 and END2 of the octets of VECTOR1 between
+  ;; START1 and END1, or NIL.
+  (defun %octet-search (vector1 start1 end1 vector2 start2 end2 from-end)
+    (declare (simple-octet-vector vector1 vector2)
+             (index start1 end1 start2 end2)
+             (optimize (speed 3) (safety 0)))
+    (let ((length (- end1 start1)))
+      (cond ((zerop length)
+             (if from-end end2 start2))
+            ((> length (- end2 start2))
+             nil)
+            (t
+             ;; Find the first octet of the pattern, then compare the rest.
+             (let ((first (octet-ref vector1 start1))
+                   (rest (1- length))
+                   (start start2)
+                   (limit (- end2 length -1)))
+               (declare (index rest start limit))
+               (loop
+                 (let ((i (%octet-position first vector2 from-end start limit)))
+                   (cond ((not i)
+                          (return nil))
+                         ((= (%octet-mismatch vector1 (1+ start1) vector2 (1+ i) rest)
+                             rest)
+                          (return i))
+                         (from-end
+                          (setq limit i))
+                         (t
+                          (setq start (1+ i)))))))))))
+
+  ;; %SP-STRING-COMPARE on two SIMPLE-BASE-STRINGs.
+  (defun %octet-string-compare (string1 start1 end1 string2 start2 end2)
+    (declare (simple-base-string string1 string2)
+             (index start1 end1 start2 end2)
+             (optimize (speed 3) (safety 0)))
+    (let* ((length1 (- end1 start1))
+           (length2 (- end2 start2))
+           (length (min length1 length2))
+           (same (%octet-mismatch string1 start1 string2 start2 length))
+           (index (+ start1 same)))
+      (declare (index length1 length2))
+      (if (< same length)
+          (values index (- (octet-ref string1 index)
+                           (octet-ref string2 (+ start2 same))))
+          (values index (signum (- length1 length2)))))))
+
+;;;; element-wise arithmetic and sums on vectors of numbers
+
+;;; MAP-INTO of a float arithmetic operator or a bitwise operator over
+;;; two vectors of the same specialized type, and REDUCE of + over a
+;;; vector of (UNSIGNED-BYTE 8) or (UNSIGNED-BYTE 32), are transformed in
+;;; seqtran.lisp into loops which on x86-64 do all but the last few
+;;; elements 32 bytes at a time using VECTOR-MAP-BLOCKS and SUM-BLOCKS.
+
+#+x86-64
+(progn
+  (defun vector-map-blocks (op result vector1 vector2 nbytes)
+    (macrolet ((dispatch (&rest ops)
+                 `(ecase op
+                    ,@(mapcar (lambda (op)
+                                `(,op (vector-map-blocks ,op result vector1
+                                                         vector2 nbytes)))
+                              ops))))
+      (dispatch :add-double :sub-double :mul-double :div-double
+                :add-single :sub-single :mul-single :div-single
+                :and :or :xor)))
+  (defun sum-blocks (width vector start nbytes)
+    (ecase width
+      (8 (sum-blocks 8 vector start nbytes))
+      (32 (sum-blocks 32 vector start nbytes)))))
+
+;;; Return the sum of the elements of VECTOR between START and END. The
+;;; elements are added up in a word as many at a time as can't overflow
+;;; it, so there is no generic arithmetic per element.
+(macrolet ((def (name width)
+             `(defun ,name (vector start end)
+                (declare (type (simple-array (unsigned-byte ,width) (*)) vector)
+                         (index start end)
+                         (optimize (speed 3) (safety 0)))
+                (let ((sum 0)
+                      (i start))
+                  (declare (unsigned-byte sum)
+                           (index i))
+                  (loop while (< i end)
+                        do (let ((chunk-end
+                                   (if (> (- end i) (ash 1 (- n-word-bits ,width)))
+                                       (+ i (ash 1 (- n-word-bits ,width)))
+                                       end))
+                                 (partial 0))
+                             (declare (index chunk-end)
+                                      (word partial))
+                             #+x86-64
+                             (let ((n (logandc2 (- chunk-end i)
+                                                ,(1- (/ 256 width)))))
+                               (when (plusp n)
+                                 (setq partial (sum-blocks ,width vector
+                                                           (* i ,(/ width 8))
+                                                           (* n ,(/ width 8))))
+                                 (incf i n)))
+                             (loop while (< i chunk-end)
+                                   do (setq partial
+                                            (truly-the word
+                                                       (+ partial (aref vector i))))
+                                      (incf i))
+                             (incf sum partial)))
+                  sum))))
+  (def %ub8-vector-sum 8)
+  (def %ub32-vector-sum 32))
@@ -1360,7 +1360,8 @@ between the ~A definition and the ~A definition"
           (classoid (wrapper-classoid wrapper)))
       (%modify-classoid classoid)
       (dovector (super inherits)
-        (remove-subclassoid classoid (wrapper-classoid super)))))
+        (remove-subclassoid classoid (wrapper-classoid super))))
+    (sb-impl::flush-call-site-caches))
   (values))
 
 ;;;; cold loading initializations
@@ -342,6 +342,8 @@ process to continue normally."
 (defun reinit (total)
   ;; WITHOUT-GCING implies WITHOUT-INTERRUPTS.
   (without-gcing
+    ;; Keys may have moved since the last GC without being logged.
+    (invalidate-moved-key-logs)
     ;; Until *CURRENT-THREAD* has been set, nothing the slightest bit complicated
     ;; can be called, as pretty much anything can assume that it is set.
     (when total ; newly started process, and not a failed save attempt
@@ -355,7 +357,8 @@ process to continue normally."
     #-(and win32 (not sb-thread))
     (signal-cold-init-or-reinit)
     (setf (extern-alien "internal_errors_enabled" int) 1)
-    (float-cold-init-or-reinit))
+    (float-cold-init-or-reinit)
+    #+x86-64 (sb-vm::select-cpu-variants))
   (gc-reinit)
   (foreign-reinit)
   #+win32 (reinit-internal-real-time)
@@ -124,4 +124,7 @@ only."
         (warn 'redefinition-with-defmacro :name name
               :new-function definition :new-location source-location))
       (setf (macro-function name) definition)))
+  #-sb-xc-host
+  (when *fasl-cache-record*
+    (note-fasl-cache-definition :macro name))
   name)
@@ -212,6 +212,13 @@
 (sb-xc:deftype consed-sequence ()
   '(or (simple-array * (*)) list extended-sequence))
 
+;;; a simple vector storing one octet per element, which the octet
+;;; searching functions in bit-bash.lisp can treat alike
+(sb-xc:deftype simple-octet-vector ()
+  '(or simple-base-string
+       (simple-array (unsigned-byte 8) (*))
+       (simple-array (signed-byte 8) (*))))
+
 ;;; the :END arg to a sequence
 (sb-xc:deftype sequence-end () '(or null index))
 
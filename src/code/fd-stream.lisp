@@ -207,6 +207,20 @@
   (form-start-byte-pos)
   (form-start-char-pos))
 
+;;;; MMAP-FD-STREAM
+;;;;
+;;;; An input-only FD-STREAM over a regular file whose contents are
+;;;; mapped into memory. The mapping itself serves as the IBUF: HEAD is
+;;;; the current octet position and TAIL the length of the file, so the
+;;;; ordinary input routines work unchanged but never need to refill,
+;;;; FILE-POSITION is a pointer move and READ-SEQUENCE is a memcpy.
+
+(defstruct (mmap-fd-stream
+            (:constructor %make-mmap-fd-stream)
+            (:include fd-stream
+                      (misc #'mmap-fd-stream-misc-routine))
+            (:copier nil)))
+
 (defun line/col-from-charpos
     (stream &optional (charpos (ansi-stream-input-char-pos stream)))
   (let* ((newlines (form-tracking-stream-newlines stream))
@@ -224,12 +238,59 @@
 
 ;;;; CORE OUTPUT FUNCTIONS
 
+;;; Write whatever is pending in the output buffer of STREAM followed by
+;;; the octets of THING between START and END with a single writev(2),
+;;; rather than copying THING through the buffer piecemeal. Return the
+;;; number of octets of THING written; the caller buffers the rest.
+#-win32
+(defun write-output-gathered (stream thing start end)
+  (declare (index start end))
+  (let* ((obuf (fd-stream-obuf stream))
+         (head (buffer-head obuf))
+         (pending (- (buffer-tail obuf) head))
+         ;; Keep the total representable as the int that writev returns.
+         (length (min (- end start) (ash 1 30))))
+    (declare (index head pending length))
+    (synchronize-stream-output stream)
+    (with-alien ((iov (array (struct sb-unix:iovec) 2)))
+      (with-pinned-objects (thing)
+        (setf (slot (deref iov 0) 'sb-unix:iov-base)
+              (sap+ (buffer-sap obuf) head)
+              (slot (deref iov 0) 'sb-unix:iov-len)
+              pending
+              (slot (deref iov 1) 'sb-unix:iov-base)
+              (sap+ (vector-sap thing) start)
+              (slot (deref iov 1) 'sb-unix:iov-len)
+              length)
+        (multiple-value-bind (count errno)
+            (sb-unix:unix-writev (fd-stream-fd stream)
+                                 (cast iov (* (struct sb-unix:iovec)))
+                                 2)
+          (cond ((null count)
+                 (if (eql errno sb-unix:ewouldblock)
+                     0
+                     (simple-stream-perror +write-failed+ stream errno)))
+                ((< count pending)
+                 ;; Not INCF, for sake of other threads.
+                 (setf (buffer-head obuf) (+ head count))
+                 0)
+                (t
+                 (reset-buffer obuf)
+                 (- count pending))))))))
+
 ;;; Buffer the section of THING delimited by START and END by copying
-;;; to output buffer(s) of stream.
+;;; to output buffer(s) of stream. Sections at least as large as the
+;;; buffer are written directly together with the buffered output when
+;;; nothing is queued yet.
 (defun buffer-output (stream thing start end)
   (declare (index start end))
   (when (< end start)
     (error ":END before :START!"))
+  #-win32
+  (when (and (not (system-area-pointer-p thing))
+             (>= (- end start) (buffer-length (fd-stream-obuf stream)))
+             (not (fd-stream-output-queue stream)))
+    (incf start (write-output-gathered stream thing start end)))
   (when (> end start)
     ;; Copy bytes from THING to buffers.
     (flet ((copy-to-buffer (buffer tail count)
@@ -351,8 +412,83 @@
                               (write-output-from-queue stream)))))
     new))
 
+;;; The most buffers handed to a single writev(2) or readv(2).
+(eval-when (:compile-toplevel :load-toplevel :execute)
+  (defconstant +max-iovecs+ 64))
+
 ;;; This is called by the FD-HANDLER for the stream when output is
-;;; possible.
+;;; possible. As many queued buffers as possible are written with a
+;;; single writev(2).
+#-win32
+(defun write-output-from-queue (stream)
+  (aver (fd-stream-serve-events stream))
+  (synchronize-stream-output stream)
+  (let (not-first-p)
+    (tagbody
+     :gather
+       (let ((queue (fd-stream-output-queue stream))
+             (n 0)
+             (length 0))
+         (declare (index n length))
+         (with-alien ((iov (array (struct sb-unix:iovec) #.+max-iovecs+)))
+           (dolist (buffer queue)
+             (let ((head (buffer-head buffer))
+                   (tail (buffer-tail buffer)))
+               (aver (<= head tail))
+               (when (= n +max-iovecs+)
+                 (return))
+               (setf (slot (deref iov n) 'sb-unix:iov-base)
+                     (sap+ (buffer-sap buffer) head)
+                     (slot (deref iov n) 'sb-unix:iov-len)
+                     (- tail head))
+               (incf n)
+               (incf length (- tail head))))
+           (multiple-value-bind (count errno)
+               (sb-unix:unix-writev (fd-stream-fd stream)
+                                    (cast iov (* (struct sb-unix:iovec)))
+                                    n)
+             (cond (count
+                    ;; Release completely written buffers and advance the
+                    ;; head of the first partially written one, if any.
+                    (let ((written count))
+                      (declare (index written))
+                      (loop
+                        (let* ((buffer (first (fd-stream-output-queue stream)))
+                               (head (buffer-head buffer))
+                               (available (- (buffer-tail buffer) head)))
+                          (when (< written available)
+                            ;; Do not use INCF! Another thread might have
+                            ;; moved head.
+                            (setf (buffer-head buffer) (+ head written))
+                            (return))
+                          (pop (fd-stream-output-queue stream))
+                          (release-buffer buffer)
+                          (decf written available)
+                          (unless (fd-stream-output-queue stream)
+                            (return)))))
+                    (cond ((null (fd-stream-output-queue stream))
+                           (let ((handler (fd-stream-handler stream)))
+                             (aver handler)
+                             (setf (fd-stream-handler stream) nil)
+                             (remove-fd-handler handler)))
+                          ((= count length)
+                           ;; Wrote everything we gathered but more is
+                           ;; queued: try again right away.
+                           (setf not-first-p t)
+                           (go :gather))))
+                   (not-first-p
+                    ;; We tried to do multiple writes, and finally our
+                    ;; luck ran out. Leave the queue as it is.
+                    )
+                   (t
+                    ;; Could not write on the first try at all!
+                    (if (= errno sb-unix:ewouldblock)
+                        (bug "Unexpected blocking in WRITE-OUTPUT-FROM-QUEUE.")
+                        (simple-stream-perror +write-failed+
+                                              stream errno)))))))))
+  nil)
+
+#+win32
 (defun write-output-from-queue (stream)
   (aver (fd-stream-serve-events stream))
   (synchronize-stream-output stream)
@@ -391,13 +527,7 @@
                   (push buffer (fd-stream-output-queue stream)))
                  (t
                   ;; Could not write on the first try at all!
-                  #+win32
-                  (simple-stream-perror +write-failed+ stream errno)
-                  #-win32
-                  (if (= errno sb-unix:ewouldblock)
-                      (bug "Unexpected blocking in WRITE-OUTPUT-FROM-QUEUE.")
-                      (simple-stream-perror +write-failed+
-                                            stream errno))))))))
+                  (simple-stream-perror +write-failed+ stream errno)))))))
   nil)
 
 ;;; Try to write THING directly to STREAM without buffering, if
@@ -978,6 +1108,12 @@
   (let ((fd (fd-stream-fd stream))
         (errno 0)
         (count 0))
+    (when (mmap-fd-stream-p stream)
+      ;; The whole file is already in the buffer.
+      (unless (fd-stream-ibuf stream)
+        (closed-flame stream))
+      (setf (fd-stream-listen stream) :eof)
+      (throw 'eof-input-catcher nil))
     (tagbody
        #+win32
        (go :main)
@@ -1329,6 +1465,168 @@
             ;; through into another pass of the loop.
             ))))
 
+;;; Put the octets of OCTETS from START back in front of the input in
+;;; the IBUF of STREAM, to be read next. The buffer is replaced by a
+;;; larger one if they don't fit.
+(defun unread-octets (stream octets start)
+  (declare (type fd-stream stream)
+           (type (simple-array (unsigned-byte 8) (*)) octets)
+           (type index start))
+  (let* ((ibuf (fd-stream-ibuf stream))
+         (n (- (length octets) start))
+         (head (buffer-head ibuf))
+         (count (- (buffer-tail ibuf) head)))
+    (declare (index n head count))
+    (when (< head n)
+      ;; Move the buffered input to the end to make room.
+      (let* ((new (if (<= (+ count n) (buffer-length ibuf))
+                      ibuf
+                      (alloc-buffer (+ count n))))
+             (new-head (- (buffer-length new) count)))
+        (system-area-ub8-copy (buffer-sap ibuf) head (buffer-sap new) new-head count)
+        (setf (buffer-head new) new-head
+              (buffer-tail new) (+ new-head count)
+              head new-head)
+        (unless (eq new ibuf)
+          (setf (fd-stream-ibuf stream) new)
+          (release-buffer ibuf)
+          (setq ibuf new))))
+    (decf head n)
+    (copy-ub8-to-system-area octets start (buffer-sap ibuf) head n)
+    (setf (buffer-head ibuf) head)))
+
+;;; Scatter input: fill each of VECTORS, which are octet vectors, in
+;;; turn from STREAM. Input that is already buffered is copied out
+;;; first and the remainder is read with readv(2) straight into the
+;;; vectors. Return the total number of octets read, which is less than
+;;; the combined length of VECTORS only at end of file.
+(defun fd-stream-read-vectors (stream vectors &optional (eof-error-p t))
+  (declare (type fd-stream stream)
+           (type list vectors))
+  (unless (case (fd-stream-element-mode stream)
+            (:bivalent t)
+            (unsigned-byte (= (fd-stream-element-size stream) 1)))
+    (error "~S requires an octet stream, not ~S." 'fd-stream-read-vectors stream))
+  (dolist (vector vectors)
+    (check-type vector (simple-array (unsigned-byte 8) (*))))
+  (let* ((ibuf (or (fd-stream-ibuf stream) (closed-flame stream)))
+         (in-buffer (ansi-stream-in-buffer stream))
+         (in-buffered (if in-buffer
+                          (- +ansi-stream-in-buffer-length+
+                             (ansi-stream-in-index stream))
+                          0))
+         (instead (fd-stream-instead stream))
+         ;; Characters given to the INPUT-REPLACEMENT restart come
+         ;; after the ANSI-STREAM buffer, which was filled before they
+         ;; were, and before the IBUF.
+         (replacement (if (plusp (length instead))
+                          (string-to-octets
+                           (reverse instead)
+                           :external-format (fd-stream-external-format stream))
+                          (make-array 0 :element-type '(unsigned-byte 8))))
+         (replaced 0)
+         (ibuffered (- (buffer-tail ibuf) (buffer-head ibuf)))
+         (total 0)
+         (pending '()))
+    (declare (index in-buffered replaced ibuffered total))
+    ;; Replacement octets which don't fit go back in front of the IBUF,
+    ;; which can't be written when it maps the file.
+    (when (and (mmap-fd-stream-p stream)
+               (plusp (length replacement))
+               (> (+ in-buffered (length replacement))
+                  (loop for vector in vectors sum (length vector))))
+      (error "~S can't keep the replacement input of ~S which doesn't fit ~
+              in the vectors."
+             'fd-stream-read-vectors stream))
+    (when (plusp (length instead))
+      (setf (fill-pointer instead) 0
+            (fd-stream-listen stream) nil))
+    ;; Buffered input never needs a refill, so this does not block.
+    (dolist (vector vectors)
+      (let ((end (length vector))
+            (start 0))
+        (declare (index start))
+        (let ((n (min end in-buffered)))
+          (ansi-stream-read-n-bytes stream vector 0 n nil)
+          (decf in-buffered n)
+          (setq start n))
+        (let ((n (min (- end start) (- (length replacement) replaced))))
+          (replace vector replacement :start1 start
+                                      :start2 replaced :end2 (+ replaced n))
+          (incf replaced n)
+          (incf start n))
+        ;; The ANSI-STREAM buffer is empty by now, so this reads the IBUF.
+        (let ((n (min (- end start) ibuffered)))
+          (ansi-stream-read-n-bytes stream vector start n nil)
+          (decf ibuffered n)
+          (incf start n))
+        (incf total start)
+        (when (< start end)
+          (push (cons vector start) pending))))
+    ;; Keep the rest of the replacement for the next read. The vectors
+    ;; are full, so none of the IBUF was read.
+    (when (< replaced (length replacement))
+      (unread-octets stream replacement replaced))
+    (setf pending (nreverse pending))
+    #+win32
+    (loop for (vector . start) = (car pending)
+          while pending
+          do (let* ((want (- (length vector) start))
+                    (n (fd-stream-read-n-bytes stream vector start want nil)))
+               (incf total n)
+               (if (< n want)
+                   (return)
+                   (pop pending))))
+    #-win32
+    (let ((fd (fd-stream-fd stream)))
+      (with-alien ((iov (array (struct sb-unix:iovec) #.+max-iovecs+)))
+        (labels ((pin-and-read (rest n)
+                   ;; Each vector stays pinned by its own frame.
+                   (if (and rest (< n +max-iovecs+))
+                       (destructuring-bind (vector . start) (car rest)
+                         (with-pinned-objects (vector)
+                           (setf (slot (deref iov n) 'sb-unix:iov-base)
+                                 (sap+ (vector-sap vector) start)
+                                 (slot (deref iov n) 'sb-unix:iov-len)
+                                 (- (length vector) start))
+                           (pin-and-read (cdr rest) (1+ n))))
+                       (sb-unix:unix-readv
+                        fd (cast iov (* (struct sb-unix:iovec))) n))))
+          (loop while pending
+                do (when (and (neq :regular (fd-stream-fd-type stream))
+                              (sysread-may-block-p stream))
+                     (unless (wait-until-fd-usable
+                              fd :input (fd-stream-timeout stream)
+                              (fd-stream-serve-events stream))
+                       (signal-timeout 'io-timeout
+                                       :stream stream
+                                       :direction :input
+                                       :seconds (fd-stream-timeout stream))))
+                   (multiple-value-bind (count errno)
+                       (pin-and-read pending 0)
+                     (cond ((null count)
+                            (unless (or (eql errno sb-unix:eintr)
+                                        (eql errno sb-unix:ewouldblock))
+                              (simple-stream-perror "couldn't read from ~S"
+                                                    stream errno)))
+                           ((zerop count)
+                            (setf (fd-stream-listen stream) :eof)
+                            (return))
+                           (t
+                            (incf total count)
+                            ;; Retire the vectors which are now full.
+                            (loop for (vector . start) = (car pending)
+                                  for room = (- (length vector) start)
+                                  while (>= count room)
+                                  do (decf count room)
+                                     (pop pending)
+                                  while pending
+                                  finally (when pending
+                                            (incf (cdar pending) count))))))))))
+    (when (and pending eof-error-p)
+      (error 'end-of-file :stream stream))
+    total))
+
 (defun fd-stream-resync (stream)
   (let ((entry (get-external-format (fd-stream-external-format stream))))
     (when entry
@@ -1766,7 +2064,9 @@
     (let ((ibuf (fd-stream-ibuf fd-stream)))
       (if input-p
           (if ibuf
-              (reset-buffer ibuf)
+              ;; A mapped buffer holds the file contents, not pending input.
+              (unless (mmap-fd-stream-p fd-stream)
+                (reset-buffer ibuf))
               (setf (fd-stream-ibuf fd-stream) (get-buffer)))
           (when ibuf
             (setf (fd-stream-ibuf fd-stream) nil)
@@ -2203,6 +2503,96 @@
              (return-from fd-stream-set-file-position
                (typep posn '(alien sb-unix:unix-offset))))))))
 
+
+;;;; MMAP-FD-STREAM support
+
+;;; Map the file underlying STREAM into memory and install the mapping
+;;; as its input buffer.
+(defun map-fd-stream-input (stream)
+  (declare (mmap-fd-stream stream))
+  #+win32
+  (error "~S is not supported on this platform." 'mmap-fd-stream)
+  #-win32
+  (let ((fd (fd-stream-fd stream)))
+    (unless (eq (fd-stream-fd-type stream) :regular)
+      (error "~S is not a regular file and can't be mapped." stream))
+    (multiple-value-bind (okay dev ino mode nlink uid gid rdev size)
+        (sb-unix:unix-fstat fd)
+      (declare (ignore ino mode nlink uid gid rdev))
+      (unless okay
+        (simple-stream-perror "failed Unix fstat(2) on ~S" stream dev))
+      (let ((buffer
+              (if (zerop size)
+                  ;; mmap() rejects a zero length
+                  (%make-buffer (int-sap 0) 0)
+                  ;; Don't want to unwind before the finalizer is in place.
+                  (without-interrupts
+                    (multiple-value-bind (sap errno)
+                        (sb-unix:unix-mmap fd size 0)
+                      (unless sap
+                        (simple-stream-perror "couldn't mmap ~S" stream errno))
+                      (let ((buffer (%make-buffer sap size)))
+                        (finalize buffer (lambda ()
+                                           (sb-unix:unix-munmap sap size))
+                                  :dont-save t)
+                        buffer))))))
+        (setf (buffer-tail buffer) size)
+        ;; Leave the descriptor at EOF, so that FD-STREAM-GET-FILE-POSITION
+        ;; computes the position from the amount of "unread input".
+        (sb-unix:unix-lseek fd 0 sb-unix:l_xtnd)
+        (setf (fd-stream-ibuf stream) buffer)))))
+
+(defun unmap-fd-stream-input (stream)
+  (let ((ibuf (fd-stream-ibuf stream)))
+    (when ibuf
+      (setf (fd-stream-ibuf stream) nil)
+      #-win32
+      (let ((length (buffer-length ibuf)))
+        (when (plusp length)
+          (without-interrupts
+            (cancel-finalization ibuf)
+            (sb-unix:unix-munmap (buffer-sap ibuf) length)))))))
+
+;;; Positioning within the mapping never touches the descriptor.
+(defun mmap-fd-stream-set-file-position (stream position-spec)
+  (declare (mmap-fd-stream stream))
+  (check-type position-spec
+              (or (alien sb-unix:unix-offset) (member nil :start :end))
+              "valid file position designator")
+  (let* ((ibuf (or (fd-stream-ibuf stream) (closed-flame stream)))
+         (length (buffer-length ibuf))
+         (posn (case position-spec
+                 (:start 0)
+                 (:end length)
+                 (t (* position-spec (fd-stream-element-size stream))))))
+    (when (<= 0 posn length)
+      (setf (%array-fill-pointer (fd-stream-instead stream)) 0
+            (fd-stream-listen stream) nil
+            (buffer-head ibuf) posn)
+      t)))
+
+(defun mmap-fd-stream-misc-routine (stream operation arg1)
+  (stream-misc-case (operation)
+    (:close
+     (unmap-fd-stream-input stream)
+     (fd-stream-misc-routine stream operation arg1))
+    (:clear-input
+     ;; There is no pending input to discard, only the file contents.
+     (setf (%array-fill-pointer (fd-stream-instead stream)) 0)
+     t)
+    (:set-file-position
+     (mmap-fd-stream-set-file-position stream arg1))
+    (t ; call next method
+     (fd-stream-misc-routine stream operation arg1))))
+
+(defun mmap-fd-stream-sap (stream)
+  "Return a SAP to the memory mapping of STREAM, which must have been
+opened with :MMAP T, and the length of the mapping in octets. The SAP is
+valid only until STREAM is closed."
+  (declare (mmap-fd-stream stream))
+  (let ((ibuf (or (fd-stream-ibuf stream) (closed-flame stream))))
+    (values (buffer-sap ibuf) (buffer-length ibuf))))
+
 
 ;;;; creation routines (MAKE-FD-STREAM and OPEN)
 
@@ -2254,7 +2644,8 @@
          (error "File descriptor must be opened either for input or output.")))
   (let* ((constructor (ecase class
                         (fd-stream '%make-fd-stream)
-                        (form-tracking-stream '%make-form-tracking-stream)))
+                        (form-tracking-stream '%make-form-tracking-stream)
+                        (mmap-fd-stream '%make-mmap-fd-stream)))
          (element-mode (stream-element-type-stream-element-mode element-type))
          (stream (funcall constructor
                           :fd fd
@@ -2277,6 +2668,20 @@
                           (if timeout
                               (coerce timeout 'single-float)
                               nil))))
+    (when (eq class 'mmap-fd-stream)
+      ;; The finalizer which would close FD isn't in place yet, so close
+      ;; it here if the stream can't be made.
+      (let ((mapped nil))
+        (unwind-protect
+             (progn
+               (when output
+                 (error "~S can't be opened for output." class))
+               (map-fd-stream-input stream)
+               (setq mapped t))
+          (unless mapped
+            (setf (fd-stream-ibuf stream) nil)
+            (when auto-close
+              (sb-unix:unix-close fd))))))
     (set-fd-stream-routines stream element-type external-format
                             input output input-buffer-p)
     (when auto-close
@@ -2366,8 +2771,9 @@
                (if-exists nil if-exists-given)
                (if-does-not-exist nil if-does-not-exist-given)
                (external-format :default)
+               mmap
                ;; private options - use at your own risk
-               (class 'fd-stream)
+               (class (if mmap 'mmap-fd-stream 'fd-stream))
                #+win32
                (overlapped t)
                &aux                     ; Squelch assignment warning.
@@ -2382,8 +2788,12 @@
    :IF-EXISTS - one of :ERROR, :NEW-VERSION, :RENAME, :RENAME-AND-DELETE,
                        :OVERWRITE, :APPEND, :SUPERSEDE or NIL
    :IF-DOES-NOT-EXIST - one of :ERROR, :CREATE or NIL
+   :MMAP - if true, map the file into memory rather than reading it
+           with read(2). Only valid for :DIRECTION :INPUT on regular files.
   See the manual for details."
 
+  (when (and mmap (member direction '(:output :io)))
+    (error "~S ~S is not supported for ~S ~S." :mmap mmap :direction direction))
   ;; Calculate useful stuff.
   (loop
     (multiple-value-bind (input output mask)
@@ -370,6 +370,63 @@
   "A list of functions that (SETF FDEFINITION) invokes before storing the
    new value. The functions take the function name and the new value.")
 
+;;;; call-site caches
+
+;;; Full calls to generic functions compiled for speed remember the
+;;; effective method for the class of their first argument in a cache
+;;; of their own (see SB-C::GF-CALL-SITE-CACHE-FORM and
+;;; SB-PCL::FILL-CALL-SITE-CACHE). The caches for each name are kept
+;;; here, weakly, to be emptied when the function called by that name
+;;; or a class changes.
+(defstruct (call-site-cache (:constructor %make-call-site-cache (name))
+                            (:copier nil)
+                            (:predicate nil))
+  ;; the function name called
+  (name nil :read-only t)
+  ;; #(WRAPPER FAST-FUNCTION PV NEXT-METHOD-CALL) of the fast method
+  ;; call for the class of the last first argument seen, or #(NIL)
+  (entry #(nil) :type simple-vector)
+  ;; the number of times the entry was replaced by one for another
+  ;; class: the cache isn't filled again once this reaches
+  ;; +CALL-SITE-CACHE-MAX-MISSES+
+  (misses 0 :type fixnum))
+
+(defconstant +call-site-cache-max-misses+ 8)
+
+(define-load-time-global *call-site-caches* nil)
+(define-load-time-global *call-site-caches-lock*
+  (sb-thread:make-mutex :name "call-site caches"))
+
+(defun make-call-site-cache (name)
+  (let ((cache (%make-call-site-cache name)))
+    (with-system-mutex (*call-site-caches-lock*)
+      (let ((table (or *call-site-caches*
+                       (setq *call-site-caches* (make-hash-table :test 'equal)))))
+        (setf (gethash name table)
+              (cons (make-weak-pointer cache)
+                    (delete-if-not #'weak-pointer-value (gethash name table))))))
+    cache))
+
+(defun empty-call-site-cache (cache)
+  (setf (call-site-cache-entry cache) #(nil)))
+
+;;; Empty the call-site caches of calls to NAME, or all of them. This
+;;; can be called before the caches are set up in cold init.
+(defun flush-call-site-caches (&optional (name nil namep))
+  (when (and (boundp '*call-site-caches*) *call-site-caches*)
+    (flet ((flush (weak-pointers)
+             (dolist (weak-pointer weak-pointers)
+               (let ((cache (weak-pointer-value weak-pointer)))
+                 (when cache
+                   (empty-call-site-cache cache))))))
+      (with-system-mutex (*call-site-caches-lock*)
+        (if namep
+            (flush (gethash name *call-site-caches*))
+            (maphash (lambda (key weak-pointers)
+                       (declare (ignore key))
+                       (flush weak-pointers))
+                     *call-site-caches*))))))
+
 ;; Reject any "object of implementation-dependent nature" that
 ;; so happens to be a function in SBCL, but which must not be
 ;; bound to a function-name by way of (SETF FEDFINITION).
@@ -410,6 +467,7 @@
         (dolist (f *setf-fdefinition-hook*)
           (declare (type function f))
           (funcall f name new-value)))
+      (flush-call-site-caches name)
 
       (let ((encap-info (encapsulation-info (fdefn-fun fdefn))))
         (cond (encap-info
@@ -443,6 +501,7 @@
         (when (sb-vm::fdefn-has-static-callers fdefn)
           (sb-vm::remove-static-links fdefn))
         (fdefn-makunbound fdefn)))
+    (flush-call-site-caches name)
     (undefine-fun-name name)
     name))
 
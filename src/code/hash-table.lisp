@@ -77,9 +77,10 @@
                                 next-vector
                                 hash-vector)))
 
-  (gethash-impl #'error :type function :read-only t)
-  (puthash-impl #'error :type function :read-only t)
-  (remhash-impl #'error :type function :read-only t)
+  ;; The first three are replaced while the table is resized incrementally.
+  (gethash-impl #'error :type function)
+  (puthash-impl #'error :type function)
+  (remhash-impl #'error :type function)
   (clrhash-impl #'error :type function :read-only t)
   ;; The Key-Value pair vector.
   ;; Note: this vector has a "high water mark" which resembles a fill
@@ -107,6 +108,12 @@
   ;; +MAGIC-HASH-VECTOR-VALUE+ represents address-based hashing on the
   ;; respective key.
   (hash-vector nil :type (or null (simple-array hash-table-index (*))))
+  ;; Only for tables made with :LAYOUT :FLAT, which find pairs by open
+  ;; addressing instead of through INDEX-VECTOR and NEXT-VECTOR.
+  ;; One byte per pair: +FLAT-EMPTY+, +FLAT-DELETED+, or the low 7 bits of
+  ;; the hash of the key. The first 16 bytes are repeated at the end so that
+  ;; a group of 16 can be read starting from any pair.
+  (control nil :type (or null (simple-array (unsigned-byte 8) (*))))
   ;; flags: WEAKNESS | KIND | WEAKP | FINALIZERSP | USERFUNP | SYNCHRONIZEDP
   ;; WEAKNESS is 2 bits, KIND is 2 bits, the rest are 1 bit each
   ;;   - WEAKNESS     : {K-and-V, K, V, K-or-V}, irrelevant unless WEAKP
@@ -157,6 +164,18 @@
   ;; This index is allowed to exceed the high-water-mark by 1 unless
   ;; the HWM is at its maximum in which case this must be 0.
   (next-free-kv 1 :type index)
+  ;; NIL if the table grows by rehashing all entries at once, T if it
+  ;; grows incrementally (see :INCREMENTAL-RESIZE in MAKE-HASH-TABLE) and
+  ;; is not growing now, or else (OLD . INDEX) where OLD is a table holding
+  ;; the entries not yet moved into this one, and INDEX is the highest
+  ;; pair index in OLD which may still hold one.
+  (%resize nil :type (or boolean cons))
+
+  ;; For large non-weak tables, a vector into which GC logs the pairs whose
+  ;; address-based keys it moved, so that only those need rehashing.
+  ;; See ATTACH-MOVED-KEY-LOG. The k/v vector then refers to the table,
+  ;; since GC finds the log through it.
+  (moved-key-log nil :type (or null (simple-array word (*))))
 
   ;; Statistics gathering for new gethash algorithm that doesn't
   ;; disable GC during rehash as a consequence of key movement.
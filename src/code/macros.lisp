@@ -679,6 +679,9 @@ invoked. In that case it will store into PLACE and start over."
     ;; FIXME: warn about incompatible lambda list with
     ;; respect to parent function?
     (setf (compiler-macro-function name) definition)
+    #-sb-xc-host
+    (when sb-c::*fasl-cache-record*
+      (sb-c::note-fasl-cache-definition :compiler-macro name))
     name))
 
 ;;;; CASE, TYPECASE, and friends
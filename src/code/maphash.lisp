@@ -31,6 +31,15 @@
 (defmacro kv-vector-high-water-mark (pairs)
   `(truly-the index/2 (data-vector-ref ,pairs 0)))
 
+;;; While a table is resized incrementally, its entries are split between
+;;; its own vectors and those of the table in the CAR of its %RESIZE slot.
+;;; Iteration visits the current vectors and then the old ones, as they are.
+;;; Entries only move from old to new, and not while the table is on this
+;;; list (see MIGRATE-SOME-PAIRS), so each is seen once even if the current
+;;; key is changed or removed.
+(defvar *iterated-resizing-tables* nil)
+(declaim (list *iterated-resizing-tables*))
+
 ;;; Hash table iteration does not need to perform bounds checks on access to the
 ;;; k/v pair vector.  We used to reload the local variable holding the k/v vector
 ;;; on each loop iteration because PUTHASH could assign a new vector at any time.
@@ -43,31 +52,40 @@
                                 &environment env)
   (when (sb-c:policy env (> space speed))
     (return-from maphash form))
-  (with-unique-names (fun limit i kv-vector key value)
+  (with-unique-names (fun table resize walk limit i kv-vector key value)
     `(let* ((,fun (%coerce-callable-to-fun ,function-designator))
-            (,kv-vector (hash-table-pairs ,hash-table))
-            ;; The high water mark needs to be loaded only once due to the
-            ;; prohibition against adding keys during traversal.
-            (,limit (1+ (* 2 (kv-vector-high-water-mark ,kv-vector)))))
-       ;; Regarding this TRULY-THE: in the theoretical edge case of the largest
-       ;; possible NEXT-VECTOR, it is not really true that the I+2 is an index.
-       ;; However, for all intents and purposes, it is an INDEX because if not,
-       ;; the table's vectors would consume literally all addressable memory.
-       ;; And it can't overflow a fixnum even in theory, since ARRAY-DIMENSION-LIMIT
-       ;; is smaller than most-positive-fixnum by enough to allow adding 2.
-       ;; And it doesn't matter anyway - the compiler uses unsigned word
-       ;; arithmetic here on account of (* 2 length) exceeding a fixnum.
-       (do ((,i 3 (truly-the index (+ ,i 2))))
-           ((> ,i ,limit))
-        ;; We are running without locking or WITHOUT-GCING. For a weak
-        ;; :VALUE hash table it's possible that the GC hit after KEY
-        ;; was read and now the entry is gone. So check if either the
-        ;; key or the value is empty.
-         (let ((,key (data-vector-ref ,kv-vector (1- ,i)))
-               (,value (data-vector-ref ,kv-vector ,i)))
-           (unless (or (empty-ht-slot-p ,key)
-                       (empty-ht-slot-p ,value))
-             (funcall ,fun ,key ,value)))))))
+            (,table ,hash-table)
+            (,resize (hash-table-%resize ,table)))
+       (flet ((,walk (,kv-vector)
+                ;; The high water mark needs to be loaded only once due to the
+                ;; prohibition against adding keys during traversal.
+                (let ((,limit (1+ (* 2 (kv-vector-high-water-mark ,kv-vector)))))
+                  ;; Regarding this TRULY-THE: in the theoretical edge case of the largest
+                  ;; possible NEXT-VECTOR, it is not really true that the I+2 is an index.
+                  ;; However, for all intents and purposes, it is an INDEX because if not,
+                  ;; the table's vectors would consume literally all addressable memory.
+                  ;; And it can't overflow a fixnum even in theory, since ARRAY-DIMENSION-LIMIT
+                  ;; is smaller than most-positive-fixnum by enough to allow adding 2.
+                  ;; And it doesn't matter anyway - the compiler uses unsigned word
+                  ;; arithmetic here on account of (* 2 length) exceeding a fixnum.
+                  (do ((,i 3 (truly-the index (+ ,i 2))))
+                      ((> ,i ,limit))
+                    ;; We are running without locking or WITHOUT-GCING. For a weak
+                    ;; :VALUE hash table it's possible that the GC hit after KEY
+                    ;; was read and now the entry is gone. So check if either the
+                    ;; key or the value is empty.
+                    (let ((,key (data-vector-ref ,kv-vector (1- ,i)))
+                          (,value (data-vector-ref ,kv-vector ,i)))
+                      (unless (or (empty-ht-slot-p ,key)
+                                  (empty-ht-slot-p ,value))
+                        (funcall ,fun ,key ,value)))))))
+         (cond ((consp ,resize)
+                (let ((*iterated-resizing-tables*
+                        (cons ,table *iterated-resizing-tables*)))
+                  (,walk (hash-table-pairs ,table))
+                  (,walk (hash-table-pairs (car ,resize)))))
+               (t
+                (,walk (hash-table-pairs ,table))))))))
 
 (defun maphash (function-designator hash-table)
   "For each entry in HASH-TABLE, call the designated two-argument function on
@@ -102,17 +120,33 @@ for."
   ;; one or more than one value (it would never need RETURN-MULTIPLE).
   ;; However if the iterator is not let-converted then it is best to return
   ;; a fixed number of values on success or failure.
-  (let ((kvv (make-symbol "KVV"))
+  (let ((table (make-symbol "TABLE"))
+        (resize (make-symbol "RESIZE"))
+        (kvv (make-symbol "KVV"))
+        (old (make-symbol "OLD"))
         (lim (make-symbol "LIMIT"))
         (ind (make-symbol "INDEX"))
         (step (make-symbol "THUNK")))
-    `(let* ((,kvv (hash-table-pairs ,hash-table))
+    `(let* ((,table ,hash-table)
+            (,resize (hash-table-%resize ,table))
+            (,kvv (hash-table-pairs ,table))
+            (,old (when (consp ,resize) (hash-table-pairs (car ,resize))))
             (,lim (1+ (* 2 (kv-vector-high-water-mark ,kvv))))
-            (,ind 3))
+            (,ind 3)
+            (*iterated-resizing-tables*
+              (if ,old
+                  (cons ,table *iterated-resizing-tables*)
+                  *iterated-resizing-tables*)))
        (declare (fixnum ,ind))
        (dx-flet ((,step ()
                    (loop
-                     (when (> ,ind ,lim) (return (values t nil nil)))
+                     (when (> ,ind ,lim)
+                       (unless ,old (return (values t nil nil)))
+                       ;; Go on to the entries not yet moved.
+                       (setq ,kvv ,old
+                             ,old nil
+                             ,lim (1+ (* 2 (kv-vector-high-water-mark ,kvv)))
+                             ,ind 3))
                      (let ((i ,ind))
                        (incf (truly-the index ,ind) 2)
                        (let ((k (data-vector-ref ,kvv (1- i)))
@@ -23,6 +23,10 @@
          (len2 (- end2 start2)))
     (declare (fixnum len1 len2
                      end1 end2))
+    (when (and (simple-base-string-p string1)
+               (simple-base-string-p string2))
+      (return-from %sp-string-compare
+        (%octet-string-compare string1 start1 end1 string2 start2 end2)))
     (cond
       ((= len1 len2)
        (do ((index1 start1 (1+ index1))
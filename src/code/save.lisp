@@ -155,8 +155,9 @@ The following &KEY arguments are defined:
      If :PURIFY is true - and only for cheneygc - the root structures
      are those which anchor the set of objects moved into static space.
      On gencgc - and only on platforms supporting immobile code - these are
-     the functions and/or function-names which commence a depth-first scan
-     of code when reordering based on the statically observable call chain.
+     the functions and/or function-names whose code is placed first, in the
+     order given, when reordering code, such as the hot functions returned
+     by SB-SPROF:READ-PROFILE-FEEDBACK.
      The complete set of reachable objects is not affected per se.
      This argument is meaningless if neither enabling precondition holds.
 
@@ -337,6 +338,7 @@ sufficiently motivated to do lengthy fixes."
     (setq sb-thread::*sprof-data* nil))
   (tune-image-for-dump)
   (float-deinit)
+  #+x86-64 (sb-vm::select-cpu-variants :baseline t)
   (profile-deinit)
   (foreign-deinit)
   ;; To have any hope of making pathname interning actually work,
@@ -731,11 +733,12 @@ sb-c::
 ;;; Passing your own toplevel functions as the root set
 ;;; will encourage the defrag procedure to place them early
 ;;; in the space, which should be better than leaving the
-;;; organization to random chance.
+;;; organization to random chance. They are placed in the order
+;;; given, so that the hottest functions of a profile, such as those
+;;; from SB-SPROF:READ-PROFILE-FEEDBACK, end up next to one another.
 ;;; Note that these aren't roots in the GC sense, just a locality sense.
 #+immobile-code
 (defun choose-code-component-order (&optional roots)
-  (declare (ignore roots))
   (let ((ordering (make-array 10000 :adjustable t :fill-pointer 0))
         (hashset (make-hash-table :test 'eq)))
 
@@ -743,15 +746,20 @@ sb-c::
                (unless (gethash code hashset)
                  (setf (gethash code hashset) t)
                  (vector-push-extend code ordering)))
-             (visit (thing)
+             (thing-code (thing)
                (typecase thing
-                 (code-component (visit-code thing))
-                 (simple-fun (visit-code (fun-code-header thing)))
-                 (closure (visit (%closure-fun thing)))
+                 (code-component thing)
+                 (simple-fun (fun-code-header thing))
+                 (closure (thing-code (%closure-fun thing)))
                  (symbol (when (and (fboundp thing)
                                     (not (special-operator-p thing))
                                     (not (macro-function thing)))
-                           (visit (symbol-function thing))))))
+                           (thing-code (symbol-function thing))))
+                 (cons (when (and (legal-fun-name-p thing) (fboundp thing))
+                         (thing-code (fdefinition thing))))))
+             (visit (thing)
+               (awhen (thing-code thing)
+                 (visit-code it)))
              (visit-code (code-component)
                (when (or (not (immobile-space-obj-p code-component))
                          (gethash code-component hashset))
@@ -771,6 +779,11 @@ sb-c::
       ;; Place functions called by assembler routines next.
       (dovector (f +static-fdefns+)
         (emplace (fun-code-header (symbol-function f))))
+      ;; Then the roots, in order.
+      (dolist (root roots)
+        (let ((code (thing-code root)))
+          (when (and code (immobile-space-obj-p code))
+            (emplace code))))
       #+nil
       (mapc #'visit
             (mapcan (lambda (x)
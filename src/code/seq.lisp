@@ -2480,6 +2480,25 @@ many elements are copied."
 (defun effective-find-position-key (key)
   (effective-find-position-key key))
 
+;;; Whether TEST and KEY, as passed to %FIND-POSITION or COUNT, compare
+;;; elements as if by EQL, so that the octet functions can be used.
+(declaim (inline eql-test-p item-octet))
+(defun eql-test-p (test key)
+  (and (or (not key) (eq key #'identity))
+       (or (eq test #'eq) (eq test #'eql) (eq test #'equal))))
+
+;;; The octet by which ITEM would be stored in the SIMPLE-OCTET-VECTOR
+;;; VECTOR, or NIL if it can not be EQL to any element.
+(defun item-octet (item vector)
+  (declare (simple-octet-vector vector))
+  (typecase vector
+    (simple-base-string
+     (and (typep item 'base-char) (char-code item)))
+    ((simple-array (unsigned-byte 8) (*))
+     (and (typep item '(unsigned-byte 8)) item))
+    (t
+     (and (typep item '(signed-byte 8)) (logand item #xff)))))
+
 ;;; shared guts of out-of-line FIND, POSITION, FIND-IF, and POSITION-IF
 (macrolet (;; shared logic for defining %FIND-POSITION and
            ;; %FIND-POSITION-IF in terms of various inlineable cases
@@ -2498,7 +2517,21 @@ many elements are copied."
                        (typecase sequence
                          #+sb-unicode
                          ((simple-array character (*)) (frob2))
-                         ((simple-array base-char (*)) (frob2))
+                         ,@(when bit-frob
+                             `((simple-octet-vector
+                                (if (eql-test-p test key)
+                                    (let* ((octet (item-octet item sequence))
+                                           (p (and octet
+                                                   (%octet-position octet sequence
+                                                                    from-end start end))))
+                                      (if p
+                                          (values item p)
+                                          (values nil nil)))
+                                    (if (simple-base-string-p sequence)
+                                        (frob2)
+                                        (vector*-frob sequence))))))
+                         ,@(unless bit-frob
+                             '(((simple-array base-char (*)) (frob2))))
                          ,@(when bit-frob
                              `((simple-bit-vector
                                 (if (and (typep item 'bit)
@@ -2745,9 +2778,17 @@ many elements are copied."
               (list-count-if test-not-p nil test sequence :two-arg-predicate item)))
         (let ((end (or end length)))
           (declare (type index end))
-          (if from-end
-              (vector-count-if test-not-p t test sequence :two-arg-predicate item)
-              (vector-count-if test-not-p nil test sequence :two-arg-predicate item)))
+          (cond ((and (typep sequence 'simple-octet-vector)
+                      (not test-not-p)
+                      (eql-test-p test key))
+                 (let ((octet (item-octet item sequence)))
+                   (if octet
+                       (%octet-count octet sequence start end)
+                       0)))
+                (from-end
+                 (vector-count-if test-not-p t test sequence :two-arg-predicate item))
+                (t
+                 (vector-count-if test-not-p nil test sequence :two-arg-predicate item))))
         (apply #'sb-sequence:count item sequence args))))
 
 ;;;; MISMATCH
@@ -375,6 +375,8 @@
        (t
         (error "unknown operator in feature expression: ~S." x))))
     (symbol
+     (when sb-c::*fasl-cache-record*
+       (sb-c::note-fasl-cache-dependency :feature x))
      (let ((present (memq x *features*)))
        (cond (present
               t)
@@ -35,7 +35,9 @@
                           (start)
                           (end)
                           :check-fill-pointer t)
-          (sort-vector vector start end predicate-fun key-fun-or-nil))
+          (unless (sort-vector-specially vector start end
+                                         predicate-fun key-fun-or-nil nil)
+            (sort-vector vector start end predicate-fun key-fun-or-nil)))
         sequence)
       (apply #'sb-sequence:sort sequence predicate args))))
 
@@ -325,19 +327,102 @@
            (type (or null function) key))
   (declare (explicit-check))
   (declare (dynamic-extent pred key))
-  (if (<= (length vector) 1) ; avoid consing
-      vector
-      (vector-merge-sort vector pred key svref)))
+  (cond ((<= (length vector) 1) ; avoid consing
+         vector)
+        ((sort-vector-specially vector 0 (length vector) pred key t)
+         vector)
+        (t
+         (vector-merge-sort vector pred key svref))))
 
 (defun stable-sort-vector (vector pred key)
   (declare (type function pred)
            (type (or null function) key))
   (declare (explicit-check))
   (declare (dynamic-extent pred key))
-  (if (<= (length vector) 1) ; avoid consing
-      vector
-      (vector-merge-sort vector pred key aref)))
+  (cond ((<= (length vector) 1) ; avoid consing
+         vector)
+        ((with-array-data ((data vector) (start) (end) :check-fill-pointer t)
+           (sort-vector-specially data start end pred key t))
+         vector)
+        (t
+         (vector-merge-sort vector pred key aref))))
 
+;;;; radix sorting
+
+;;; Vectors of fixnums, (UNSIGNED-BYTE 32) and DOUBLE-FLOAT sorted by #'<
+;;; or #'> with no key are sorted by the bits of the elements instead of
+;;; by calling the predicate. Each pass distributes the elements by 8 bits
+;;; of their key, starting from the least significant, and is stable, so
+;;; this serves for STABLE-SORT as well. A pass in which all the elements
+;;; have the same 8 bits is skipped.
+(defconstant +min-radix-sort-length+ 512)
+
+(eval-when (:compile-toplevel :execute)
+
+;;; KEY is a form computing from X, an element, a KEY-BITS wide unsigned
+;;; integer that orders elements like #'<.
+(sb-xc:defmacro define-radix-sort (name element-type key-bits key)
+  `(defun ,name (vector start end descending)
+     (declare (type (simple-array ,element-type (*)) vector)
+              (index start end)
+              (optimize speed (safety 0)))
+     (let* ((n (- end start))
+            (temp (make-array n :element-type ',element-type))
+            (counts (make-array 256 :element-type 'index))
+            (from vector)
+            (from-start start)
+            (to temp)
+            (to-start 0)
+            (flip (if descending (ldb (byte ,key-bits 0) -1) 0)))
+       (declare (type (simple-array ,element-type (*)) temp from to)
+                (index n from-start to-start)
+                (type (unsigned-byte ,key-bits) flip)
+                (dynamic-extent counts))
+       (flet ((digit (x shift)
+                (ldb (byte 8 shift) (logxor flip ,key))))
+         (declare (inline digit))
+         (loop for shift of-type (integer 0 ,key-bits) from 0 below ,key-bits by 8
+               do (fill counts 0)
+                  (loop for i of-type index from from-start below (+ from-start n)
+                        do (incf (aref counts (digit (aref from i) shift))))
+                  (unless (= (aref counts (digit (aref from from-start) shift)) n)
+                    ;; Turn the counts into the index of the next element
+                    ;; of each digit.
+                    (let ((sum to-start))
+                      (declare (index sum))
+                      (dotimes (digit 256)
+                        (let ((count (aref counts digit)))
+                          (setf (aref counts digit) sum)
+                          (incf sum count))))
+                    (loop for i of-type index from from-start below (+ from-start n)
+                          do (let* ((x (aref from i))
+                                    (digit (digit x shift)))
+                               (setf (aref to (aref counts digit)) x)
+                               (incf (aref counts digit))))
+                    (rotatef from to)
+                    (rotatef from-start to-start))))
+       (unless (eq from vector)
+         (replace vector from :start1 start :start2 from-start :end2 (+ from-start n)))
+       vector)))
+
+) ; EVAL-WHEN
+
+(define-radix-sort radix-sort-fixnums fixnum sb-vm:n-word-bits
+  ;; Flipping the sign bit of the two's complement orders it as unsigned.
+  (logxor (logand x most-positive-word) (ash 1 (1- sb-vm:n-word-bits))))
+
+(define-radix-sort radix-sort-ub32s (unsigned-byte 32) 32 x)
+
+#+64-bit
+(define-radix-sort radix-sort-double-floats double-float 64
+  ;; -0d0 and 0d0 are equal under #'<, so they must not be told apart here,
+  ;; else STABLE-SORT would not keep them in order. Negative numbers get
+  ;; all their bits flipped, which orders them from the most negative.
+  (let ((bits (logand (double-float-bits (if (= x 0d0) 0d0 x)) most-positive-word)))
+    (if (logbitp 63 bits)
+        (logxor bits most-positive-word)
+        (logxor bits (ash 1 63)))))
+
 ;;;; merging
 
 (eval-when (:compile-toplevel :execute)
@@ -382,6 +467,120 @@
 
 ) ; EVAL-WHEN
 
+;;;; parallel sorting
+
+(defvar *sort-threads* 1
+  "The number of threads SORT and STABLE-SORT may use for a vector of
+at least 50000 elements. The predicate and key are then called in other
+threads as well, which do not see the dynamic bindings of the calling
+thread, and must not transfer control out of the sort.")
+(declaim (type (integer 1 1024) *sort-threads*))
+
+(defconstant +min-parallel-sort-length+ 50000)
+
+;;; Call FUN on each integer below N, all but the last in new threads, and
+;;; signal again in this thread the first error any of them signaled.
+#+sb-thread
+(defun call-in-sort-threads (fun n)
+  (declare (function fun) (index n))
+  (let* ((errors (make-array n :initial-element nil))
+         (threads '()))
+    (unwind-protect
+         (progn
+           (dotimes (i (1- n))
+             (push (sb-thread:make-thread
+                    (lambda (i)
+                      (handler-case (funcall fun i)
+                        (error (condition) (setf (svref errors i) condition))))
+                    :name "sort worker" :arguments (list i))
+                   threads))
+           (funcall fun (1- n)))
+      (mapc #'sb-thread:join-thread threads))
+    (awhen (find-if #'identity errors)
+      (error it))))
+
+;;; Sort the N elements of VECTOR from START in pieces, one per thread, then
+;;; merge the pieces pairwise, in parallel while there are several pairs.
+;;; Merging takes an element of the right piece before one of the left only
+;;; if it is strictly less, which keeps the sort stable if the pieces were
+;;; sorted stably.
+#+sb-thread
+(defun parallel-sort-vector (vector start end pred key stable)
+  (declare (vector vector) (index start end) (function pred)
+           (type (or null function) key))
+  (let* ((n (- end start))
+         (n-runs (min *sort-threads* (ceiling n (ash +min-parallel-sort-length+ -3))))
+         (runs (make-array n-runs)))
+    (declare (index n n-runs))
+    (call-in-sort-threads
+     (lambda (i)
+       (let* ((run-start (+ start (floor (* i n) n-runs)))
+              (run-end (+ start (floor (* (1+ i) n) n-runs)))
+              (run (subseq vector run-start run-end)))
+         (setf (svref runs i)
+               (let ((run (coerce run 'simple-vector)))
+                 (if stable
+                     (vector-merge-sort run pred key svref)
+                     (sort-vector run 0 (length run) pred key))
+                 run))))
+     n-runs)
+    (flet ((merge-runs (run-1 run-2 result)
+             (declare (simple-vector run-1 run-2))
+             (let ((length-1 (length run-1))
+                   (length-2 (length run-2)))
+               (if (simple-vector-p result)
+                   (merge-vectors run-1 length-1 run-2 length-2 result pred key svref)
+                   (merge-vectors run-1 length-1 run-2 length-2 result pred key aref)))))
+      (loop while (> (length runs) 2)
+            do (let* ((n-pairs (floor (length runs) 2))
+                      (next (make-array (ceiling (length runs) 2))))
+                 (when (oddp (length runs))
+                   (setf (svref next n-pairs) (svref runs (1- (length runs)))))
+                 (call-in-sort-threads
+                  (lambda (i)
+                    (let ((run-1 (svref runs (* 2 i)))
+                          (run-2 (svref runs (1+ (* 2 i)))))
+                      (setf (svref next i)
+                            (merge-runs run-1 run-2
+                                        (make-array (+ (length run-1)
+                                                       (length run-2)))))))
+                  n-pairs)
+                 (setq runs next)))
+      ;; The last merge writes into VECTOR.
+      (if (= (length runs) 1)
+          (replace vector (svref runs 0) :start1 start)
+          (let ((result (if (and (= start 0) (= end (length vector)))
+                            vector
+                            (make-array n))))
+            (merge-runs (svref runs 0) (svref runs 1) result)
+            (unless (eq result vector)
+              (replace vector result :start1 start)))))
+    vector))
+
+;;; Sort the elements of the data vector VECTOR from START to END with a
+;;; radix sort or in several threads, if either applies, returning true.
+(defun sort-vector-specially (vector start end pred key stable)
+  (declare (vector vector) (index start end) (function pred)
+           (type (or null function) key))
+  (let ((n (- end start)))
+    (cond ((and (not key)
+                (>= n +min-radix-sort-length+)
+                (or (eq pred #'<) (eq pred #'>))
+                (let ((descending (eq pred #'>)))
+                  (typecase vector
+                    ((simple-array fixnum (*))
+                     (radix-sort-fixnums vector start end descending) t)
+                    ((simple-array (unsigned-byte 32) (*))
+                     (radix-sort-ub32s vector start end descending) t)
+                    #+64-bit
+                    ((simple-array double-float (*))
+                     (radix-sort-double-floats vector start end descending) t)))))
+          #+sb-thread
+          ((and (>= n +min-parallel-sort-length+)
+                (> *sort-threads* 1))
+           (parallel-sort-vector vector start end pred key stable)
+           t))))
+
 (defun merge (result-type sequence1 sequence2 predicate &key key)
   "Merge the sequences SEQUENCE1 and SEQUENCE2 destructively into a
    sequence of type RESULT-TYPE using PREDICATE to order the elements."
@@ -14,29 +14,59 @@
 ;;;; Note that this operation is used in compiler symbol table
 ;;;; lookups, so we'd like it to be fast.
 ;;;;
-;;;; As of 2004-03-10, we implement the one-at-a-time algorithm
-;;;; designed by Bob Jenkins (see
-;;;; <http://burtleburtle.net/bob/hash/doobs.html> for some more
-;;;; information).
+;;;; Characters are hashed a word's worth at a time (8 on 64-bit, 4 on
+;;;; 32-bit). Each block becomes the word in which the code of character J is
+;;;; shifted left by 8*J bits and XORed in, which for a base-string on a
+;;;; little-endian machine is simply the block as stored in memory. The words
+;;;; are mixed in with a multiply, and the length and a final avalanche at the
+;;;; end. Since the result depends only on the character codes, a base-string
+;;;; and a character string which are EQUAL hash alike, as do strings in
+;;;; different images on the same platform. The cross-compiler has to agree
+;;;; too, because genesis computes symbol hashes with it.
+;;;;
+;;;; This replaced the one-at-a-time algorithm designed by Bob
+;;;; Jenkins, which spends a few dependent operations on every character.
+;;;; benchmarks/string-hash.lisp compares the two.
 
 #-sb-xc-host (declaim (inline %sxhash-simple-substring))
 (defun %sxhash-simple-substring (string start end)
-  ;; FIXME: As in MIX above, we wouldn't need (SAFETY 0) here if the
-  ;; cross-compiler were smarter about ASH, but we need it for
-  ;; sbcl-0.5.0m.  (probably no longer true?  We might need SAFETY 0
-  ;; to elide some type checks, but then again if this is inlined in
-  ;; all the critical places, we might not -- CSR, 2004-03-10)
-
   ;; Never decrease safety in the cross-compiler. It's not worth the headache
   ;; of tracking down insidious host/target compatibility bugs.
   #-sb-xc-host (declare (optimize (speed 3) (safety 0)))
-  (macrolet ((guts ()
-               `(loop for i of-type index from start below end do
-                  (set-result (+ result (char-code (aref string i))))
-                  (set-result (+ result (ash result 10)))
-                  (set-result (logxor result (ash result -6)))))
-             (set-result (form)
-               `(setf result (ldb (byte #.sb-vm:n-word-bits 0) ,form))))
+  (macrolet ((set-result (form)
+               `(setf result (ldb (byte #.sb-vm:n-word-bits 0) ,form)))
+             (mix-word (form)
+               `(progn
+                  (set-result (* (logxor result ,form)
+                                 #+64-bit #x9E3779B97F4A7C15 #-64-bit #x9E3779B9))
+                  (set-result (logxor result (ash result #+64-bit -29 #-64-bit -15)))))
+             (pack (index count)
+               `(let ((word 0))
+                  (declare (type word word))
+                  (dotimes (j ,count word)
+                    (setq word
+                          (logxor word
+                                  (ldb (byte #.sb-vm:n-word-bits 0)
+                                       (ash (char-code (aref string (+ ,index j)))
+                                            (* 8 j))))))))
+             ;; Mix in the whole blocks from I, leaving I at the first
+             ;; character not mixed in.
+             (mix-blocks (word)
+               `(loop while (<= (+ i sb-vm:n-word-bytes) end)
+                      do (mix-word ,word)
+                         (incf i sb-vm:n-word-bytes)))
+             (guts (&optional base-string-p)
+               `(let ((i start))
+                  (declare (type index i))
+                  ,(if base-string-p
+                       ;; Read whole words if the blocks are aligned.
+                       `(if (zerop (logand start (1- sb-vm:n-word-bytes)))
+                            (mix-blocks (%vector-raw-bits
+                                         string (truncate i sb-vm:n-word-bytes)))
+                            (mix-blocks (pack i sb-vm:n-word-bytes)))
+                       `(mix-blocks (pack i sb-vm:n-word-bytes)))
+                  (when (< i end)
+                    (mix-word (pack i (- end i)))))))
     (let ((result 238625159)) ; (logandc2 most-positive-fixnum (sxhash #\S)) on 32 bits
       (declare (type word result))
       ;; Avoid accessing elements of a (simple-array nil (*)).
@@ -44,15 +74,16 @@
       ;; so we can't simply omit one case. Therefore that macro
       ;; is unusable here.
       #-sb-xc-host (typecase string
-                     (simple-base-string (guts))
+                     (simple-base-string (guts #+little-endian t))
                      ((simple-array character (*)) (guts)))
 
       ;; just do it, don't care about loop unswitching or simple-ness of the string.
       #+sb-xc-host (guts)
 
-      (set-result (+ result (ash result 3)))
-      (set-result (logxor result (ash result -11)))
-      (set-result (logxor result (ash result 15)))
+      (set-result (logxor result (- end start)))
+      (set-result (logxor result (ash result #+64-bit -33 #-64-bit -16)))
+      (set-result (* result #+64-bit #xff51afd7ed558ccd #-64-bit #x85ebca6b))
+      (set-result (logxor result (ash result #+64-bit -33 #-64-bit -13)))
       (logand result most-positive-fixnum))))
 ;;; test:
 ;;;   (let ((ht (make-hash-table :test 'equal)))
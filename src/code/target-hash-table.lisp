@@ -272,6 +272,11 @@ Examples:
 ;;; This constant is referenced via its name in cold load, so it needs to
 ;;; be evaluable in the host.
 (defconstant +min-hash-table-rehash-threshold+ #.(sb-xc:float 1/16 $1.0))
+;;; Tables created with :INCREMENTAL-RESIZE still grow all at once while
+;;; smaller than this, since that takes no longer than an incremental step.
+(defconstant +min-incremental-resize-count+ 4096)
+;;; Minimum number of old pairs visited per write during incremental growth.
+(defconstant +incremental-resize-quantum+ 16)
 
 ;; The GC will set this to 1 if it moves an address-sensitive key. This used
 ;; to be signaled by a bit in the header of the kv vector, but that
@@ -344,7 +349,9 @@ Examples:
                              (rehash-threshold 1)
                              (hash-function nil user-hashfun-p)
                              (weakness nil)
-                             (synchronized))
+                             (synchronized)
+                             (incremental-resize)
+                             (layout :chained))
   "Create and return a new hash table. The keywords are as follows:
 
   :TEST
@@ -405,8 +412,33 @@ Examples:
     are safe, but note that CLHS 3.6 (Traversal Rules and Side Effects)
     remains in force. See also: SB-EXT:WITH-LOCKED-HASH-TABLE. This keyword
     argument is experimental, and may change incompatibly or be removed in the
-    future."
+    future.
+
+  :INCREMENTAL-RESIZE
+    If true, a large table grows by moving a bounded number of entries on
+    each subsequent write, rather than all entries at once, so that no
+    single write takes time proportional to the size of the table. Lookups
+    check both the old and new storage until the move completes, and so
+    do MAPHASH and WITH-HASH-TABLE-ITERATOR, which move nothing themselves.
+    Can not be combined with :WEAKNESS.
+
+  :LAYOUT
+    :CHAINED (the default) or :FLAT. A :FLAT table stores each entry in
+    the first free slot of a probe sequence determined by the hash of its
+    key, and checks 16 slots at a time by comparing a byte of the hash,
+    so that most lookups read one group of such bytes and one entry.
+    It can not be combined with :WEAKNESS or :INCREMENTAL-RESIZE."
   (declare (type (or function symbol) test))
+  (when (and incremental-resize weakness)
+    (error "~S and ~S can not be combined in ~S"
+           :incremental-resize :weakness 'make-hash-table))
+  (ecase layout
+    (:chained)
+    (:flat
+     (when (or weakness incremental-resize)
+       (error "~S ~S can not be combined with ~S in ~S"
+              :layout :flat (if weakness :weakness :incremental-resize)
+              'make-hash-table))))
   (declare (type unsigned-byte size))
   (multiple-value-bind (kind test test-fun hash-fun)
       (cond ((or (eq test #'eq) (eq test 'eq))
@@ -455,22 +487,27 @@ Examples:
            ;; not 1, to make it easier for the compiler to avoid
            ;; boxing.
            (rehash-threshold (max +min-hash-table-rehash-threshold+
-                                  (float rehash-threshold $1.0)))) ; always single-float
-      (%make-hash-table
-       ;; compute flags. The stored KIND bits don't matter for a user-supplied hash
-       ;; and/or test fun, however we don't want to imply that it is an EQ table
-       ;; because EQ tables don't get a hash-vector allocated.
-       (logior (if weakness
-                   (or (loop for i below 4
-                             when (eq (decode-hash-table-weakness i) weakness)
-                             do (return (pack-ht-flags-weakness i)))
-                       (bug "Unreachable"))
-                   0)
-               (pack-ht-flags-kind (logand kind 3)) ; kind -1 becomes 3
-               (if (or weakness synchronized) hash-table-synchronized-flag 0)
-               (if (eql kind -1) hash-table-userfun-flag 0))
-       test test-fun hash-fun
-       size rehash-size rehash-threshold))))
+                                  (float rehash-threshold $1.0))) ; always single-float
+           (table
+            (funcall
+             (if (eq layout :flat) #'%make-flat-hash-table #'%make-hash-table)
+             ;; compute flags. The stored KIND bits don't matter for a user-supplied hash
+             ;; and/or test fun, however we don't want to imply that it is an EQ table
+             ;; because EQ tables don't get a hash-vector allocated.
+             (logior (if weakness
+                         (or (loop for i below 4
+                                   when (eq (decode-hash-table-weakness i) weakness)
+                                   do (return (pack-ht-flags-weakness i)))
+                             (bug "Unreachable"))
+                         0)
+                     (pack-ht-flags-kind (logand kind 3)) ; kind -1 becomes 3
+                     (if (or weakness synchronized) hash-table-synchronized-flag 0)
+                     (if (eql kind -1) hash-table-userfun-flag 0))
+             test test-fun hash-fun
+             size rehash-size rehash-threshold)))
+      (when incremental-resize
+        (setf (hash-table-%resize table) t))
+      table)))
 
 (defun %make-hash-table (flags test test-fun hash-fun size rehash-size rehash-threshold)
   (binding* (
@@ -574,7 +611,10 @@ Examples:
   "Return the number of entries in the given HASH-TABLE."
   (declare (type hash-table hash-table)
            (values index))
-  (hash-table-%count hash-table))
+  (let ((resize (hash-table-%resize hash-table)))
+    (if (consp resize)
+        (+ (hash-table-%count hash-table) (hash-table-%count (car resize)))
+        (hash-table-%count hash-table))))
 
 (setf (documentation 'hash-table-rehash-size 'function)
       "Return the rehash-size HASH-TABLE was created with.")
@@ -593,7 +633,9 @@ Examples:
    table that can hold however many entries HASH-TABLE can hold without
    having to be grown."
   (let ((n (hash-table-pairs-capacity (hash-table-pairs hash-table))))
-    (if (= n 0) +min-hash-table-size+ n)))
+    (cond ((= n 0) +min-hash-table-size+)
+          ((hash-table-control hash-table) (flat-max-count n))
+          (t n))))
 
 (setf (documentation 'hash-table-test 'function)
       "Return the test HASH-TABLE was created with.")
@@ -669,6 +711,62 @@ multiple threads accessing the same hash-table without locking."
              (make-array (1+ new-size) :element-type 'hash-table-index))))
     (values new-kv-vector new-next-vector new-hash-vector new-index-vector)))
 
+;;;; Moved-key logs
+
+;;; When GC moves a key which was hashed by its address, it marks the k/v
+;;; vector as needing rehash. Rehashing a table of millions of such keys
+;;; after every GC that moves a few of them is wasteful, so large tables
+;;; get a log in which GC records each moved pair as its index and the
+;;; key's old address. %REHASH-AND-FIND then just moves those pairs from
+;;; the bucket for the old address to the bucket for the new one.
+;;;
+;;; Element 0 is the number of logged pairs, or +MOVED-KEY-LOG-OVERFLOW+
+;;; if more moved than fit. Element 1 is the *MOVED-KEY-LOG-EPOCH* at which
+;;; the log was last emptied. The pairs follow. The runtime knows this
+;;; layout, see scan_nonweak_kv_vector() in gc-common.c.
+(defconstant +moved-key-log-overflow+ most-positive-word)
+;;; Tables with fewer pairs than this just rehash.
+(defconstant +min-moved-key-log-table-size+ 2048)
+(defconstant +moved-key-log-header-words+ 2)
+
+;;; The runtime relocates and defragments the heap without logging the keys
+;;; which move, so REINIT invalidates all logs by changing this.
+(define-load-time-global *moved-key-log-epoch* 0)
+(declaim (fixnum *moved-key-log-epoch*))
+
+(defun invalidate-moved-key-logs ()
+  (setq *moved-key-log-epoch* (logand (1+ *moved-key-log-epoch*) most-positive-fixnum)))
+
+(declaim (inline moved-key-log-capacity))
+(defun moved-key-log-capacity (log)
+  (ash (- (length log) +moved-key-log-header-words+) -1))
+
+;;; Give TABLE, which has just been given new vectors, a moved-key log if
+;;; it is large enough. REHASH-MOVED-KEYS computes the old bucket of a key
+;;; by masking the fixnum tag bits from its logged address, which isn't
+;;; what POINTER-HASH does on sparc.
+(defun attach-moved-key-log (table)
+  (let ((kv-vector (hash-table-pairs table)))
+    (when (and #+sparc nil
+               (not (hash-table-weak-p table))
+               (>= (hash-table-pairs-capacity kv-vector)
+                   +min-moved-key-log-table-size+))
+      (let ((log (make-array (+ +moved-key-log-header-words+
+                                (* 2 (min 4096 (ash (hash-table-pairs-capacity kv-vector) -3))))
+                             :element-type 'word :initial-element 0)))
+        (setf (aref log 1) *moved-key-log-epoch*)
+        ;; A key might already have moved without being logged.
+        (without-gcing
+          (when (oddp (kv-vector-rehash-stamp kv-vector))
+            (setf (aref log 0) +moved-key-log-overflow+))
+          (setf (hash-table-moved-key-log table) log
+                (kv-vector-supplement kv-vector) table))))))
+
+(defun reset-moved-key-log (log)
+  (declare (type (simple-array word (*)) log))
+  (setf (aref log 1) *moved-key-log-epoch*
+        (aref log 0) 0))
+
 ;;; We don't define +-MODFX for all backends, and I can't figure out
 ;;; the rationale, nor how to detect this other than by trial and error.
 ;;; Like why does 64-bit ARM have it but 32-bit not have?
@@ -786,6 +884,73 @@ multiple threads accessing the same hash-table without locking."
         ((= hwm (hash-table-pairs-capacity kv-vector)) 0)
         (t (1+ hwm))))
 
+;;; Rehash only the pairs in the moved-key log of TABLE, and find KEY,
+;;; which is hashed by its address. Return the index of KEY in the k/v
+;;; vector or 0, or NIL if the log can't be used.
+(defun rehash-moved-keys (table key
+                          &aux (log (hash-table-moved-key-log table)))
+  (declare (hash-table table))
+  (when log
+    (without-gcing
+      (let ((count (aref log 0)))
+        (when (and (<= count (moved-key-log-capacity log))
+                   (= (aref log 1) *moved-key-log-epoch*))
+          (let* ((kv-vector (hash-table-pairs table))
+                 (index-vector (hash-table-index-vector table))
+                 (next-vector (hash-table-next-vector table))
+                 (hash-vector (hash-table-hash-vector table))
+                 (mask (1- (length index-vector)))
+                 (hwm (kv-vector-high-water-mark kv-vector)))
+            (flet ((address-hashed-p (i)
+                     ;; As in REHASH, only these pairs are in the bucket
+                     ;; for the address of their key.
+                     (with-pair (key val)
+                       (cond ((and (empty-ht-slot-p key) (empty-ht-slot-p val))
+                              nil)
+                             (hash-vector
+                              (= (aref hash-vector i) +magic-hash-vector-value+))
+                             ((= (ht-flags-kind (hash-table-flags table))
+                                 hash-table-kind-eql)
+                              (nth-value 1 (eql-hash-no-memoize key)))
+                             (t
+                              (sb-vm:is-lisp-pointer (get-lisp-obj-address key))))))
+                   (unlink (i bucket)
+                     ;; A pair logged more than once is only in the bucket of
+                     ;; its oldest address, so the other attempts fail.
+                     (do ((previous 0 this)
+                          (this (aref index-vector bucket) (aref next-vector this))
+                          (n-probes 0 (1+ n-probes)))
+                         ((or (zerop this) (> n-probes hwm)) nil)
+                       (declare (index/2 previous this) (index n-probes))
+                       (when (= this i)
+                         (if (zerop previous)
+                             (setf (aref index-vector bucket) (aref next-vector i))
+                             (setf (aref next-vector previous) (aref next-vector i)))
+                         (return t)))))
+              (dotimes (n count)
+                (let* ((index-elt (+ +moved-key-log-header-words+ (* 2 n)))
+                       (i (aref log index-elt))
+                       (old-hash (%make-lisp-obj (logandc2 (aref log (1+ index-elt))
+                                                           sb-vm:fixnum-tag-mask))))
+                  (unless (and (<= 1 i hwm)
+                               (address-hashed-p i)
+                               (unlink i (pointer-hash->bucket old-hash mask)))
+                    ;; Mark as not to be relinked.
+                    (setf (aref log index-elt) 0))))
+              (dotimes (n count)
+                (let ((i (aref log (+ +moved-key-log-header-words+ (* 2 n)))))
+                  (unless (zerop i)
+                    (with-pair (pair-key)
+                      (push-in-chain (pointer-hash->bucket (pointer-hash pair-key) mask))))))
+              (reset-moved-key-log log)
+              (do ((this (aref index-vector (pointer-hash->bucket (pointer-hash key) mask))
+                         (aref next-vector this))
+                   (n-probes 0 (1+ n-probes)))
+                  ((or (zerop this) (> n-probes hwm)) 0)
+                (declare (index/2 this) (index n-probes))
+                (when (eq (aref kv-vector (* 2 this)) key)
+                  (return (* 2 this)))))))))))
+
 ;;; Rehash due to key movement, and find KEY at the same time.
 ;;; Finding the key obviates the need for the rehashing thread to loop
 ;;; testing whether to rehash. Imagine an unlucky schedule wherein each rehash
@@ -814,6 +979,15 @@ multiple threads accessing the same hash-table without locking."
    ;; rehash-in-progress bit. It also gives this thread exclusive write access
    ;; to the hashing vectors, since at most one thread can win this CAS.
    (when (eq (cas (svref kv-vector rehash-stamp-elt) epoch rehashing-state) epoch)
+     (let ((key-index (rehash-moved-keys table key)))
+       (when key-index
+         (done-rehashing kv-vector epoch)
+         (unless (eql key-index 0)
+           (setf (hash-table-cache table) key-index))
+         (return-from %rehash-and-find key-index)))
+     ;; Keys moved from now on are logged against the chains built below.
+     (awhen (hash-table-moved-key-log table)
+       (reset-moved-key-log it))
      ;; Remove address-sensitivity, preserving the other flags.
      (reset-array-flags kv-vector sb-vm:vector-addr-hashing-flag)
      ;; Rehash in place. For the duration of the rehash, readers who otherwise
@@ -891,7 +1065,11 @@ multiple threads accessing the same hash-table without locking."
             (hash-table-index-vector table) index-vector
             (hash-table-next-vector table) next-vector
             (hash-table-hash-vector table) hash-vector)
+      (attach-moved-key-log table)
       (return-from grow-hash-table 1)))
+  (when (and (eq (hash-table-%resize table) t)
+             (>= (hash-table-%count table) +min-incremental-resize-count+))
+    (return-from grow-hash-table (start-incremental-resize table)))
   (binding* (((new-kv-vector new-next-vector new-hash-vector new-index-vector)
               (hash-table-new-vectors table))
              (old-kv-vector (hash-table-pairs table))
@@ -905,7 +1083,7 @@ multiple threads accessing the same hash-table without locking."
     ;;  (1) every usable pair was at some point filled (so HWM = SIZE)
     ;;  (2) no cells below HWM are available (so COUNT = SIZE)
     (aver (= hwm (hash-table-size table)))
-    (when (and (not (hash-table-weak-p table)) (/= (hash-table-count table) hwm))
+    (when (and (not (hash-table-weak-p table)) (/= (hash-table-%count table) hwm))
       ;; If the table is not weak, then every cell pair has to be in use
       ;; as a precondition to resizing. If weak, this might not be true.
       (signal-corrupt-hash-table table))
@@ -961,6 +1139,7 @@ multiple threads accessing the same hash-table without locking."
         ;; we can set the vector's backpointer and turn it weak.
         (setf (kv-vector-supplement new-kv-vector) table)
         (logior-array-flags new-kv-vector sb-vm:vector-weak-flag))
+      (attach-moved-key-log table)
 
       ;; Zero-fill the old kv-vector. For weak hash-tables this removes the
       ;; strong references to each k/v. For non-weak vectors there is no technical
@@ -981,6 +1160,135 @@ multiple threads accessing the same hash-table without locking."
       (setf (kv-vector-high-water-mark old-kv-vector) 0)
       next-free)))
 
+;;;; Incremental resizing
+
+;;; Rather than rehashing all of its entries, a table resized incrementally
+;;; hands its vectors over to a copy of itself, OLD, and starts afresh with
+;;; larger empty vectors. Each write then moves some entries from OLD, and
+;;; lookups which miss in the table also look in OLD.
+;;; OLD retains the original methods of the table, which are called with
+;;; the table as argument to access its new vectors, and with OLD itself
+;;; to access the old ones. For synchronized tables these share a mutex.
+
+(defmacro with-resize-lock ((table) &body body)
+  `(dx-flet ((body () ,@body))
+     (if (hash-table-synchronized-p ,table)
+         (sb-thread::call-with-recursive-system-lock #'body (hash-table-%lock ,table))
+         (body))))
+
+;;; Called by GROW-HASH-TABLE instead of rehashing. Like it, returns the
+;;; index of a free pair.
+(defun start-incremental-resize (table)
+  (binding* (((kv-vector next-vector hash-vector index-vector)
+              (hash-table-new-vectors table))
+             (old (copy-structure table)))
+    ;; GC must find the old moved-key log and hash-vector through OLD.
+    (without-gcing
+      (when (eq (kv-vector-supplement (hash-table-pairs old)) table)
+        (setf (kv-vector-supplement (hash-table-pairs old)) old)))
+    (setf (hash-table-%resize old) nil
+          (hash-table-moved-key-log table) nil
+          (kv-vector-supplement kv-vector)
+          (or hash-vector
+              (= (ht-flags-kind (hash-table-flags table)) hash-table-kind-eql))
+          (hash-table-pairs table) kv-vector
+          (hash-table-index-vector table) index-vector
+          (hash-table-next-vector table) next-vector
+          (hash-table-hash-vector table) hash-vector
+          (hash-table-%count table) 0
+          (hash-table-cache table) 0
+          (hash-table-gethash-impl table) #'gethash/resizing
+          (hash-table-puthash-impl table) #'puthash/resizing
+          (hash-table-remhash-impl table) #'remhash/resizing
+          (hash-table-%resize table)
+          (cons old (kv-vector-high-water-mark (hash-table-pairs old))))
+    (attach-moved-key-log table)
+    1))
+
+(defun end-incremental-resize (table)
+  (let ((old (car (hash-table-%resize table))))
+    (setf (hash-table-gethash-impl table) (hash-table-gethash-impl old)
+          (hash-table-puthash-impl table) (hash-table-puthash-impl old)
+          (hash-table-remhash-impl table) (hash-table-remhash-impl old)
+          (hash-table-%resize table) t)))
+
+;;; Move entries from the old vectors of TABLE, visiting at most LIMIT pairs.
+(defun migrate-pairs (table limit)
+  (declare (index limit))
+  (let* ((resize (hash-table-%resize table))
+         (old (car resize))
+         (kv-vector (hash-table-pairs old))
+         (putter (hash-table-puthash-impl old))
+         (remover (hash-table-remhash-impl old)))
+    (declare (function putter remover))
+    (loop
+      (let ((i (cdr resize)))
+        (declare (index/2 i))
+        (when (zerop i)
+          (return (end-incremental-resize table)))
+        (when (zerop limit)
+          (return))
+        (setf (cdr resize) (1- i))
+        (decf limit)
+        (let ((key (svref kv-vector (* 2 i)))
+              (value (svref kv-vector (1+ (* 2 i)))))
+          (unless (or (empty-ht-slot-p key) (empty-ht-slot-p value))
+            (funcall putter key table value)
+            (funcall remover key old)))))))
+
+;;; Do the share of moving entries which falls on one write. This is enough
+;;; to empty the old vectors before the new ones fill up, since each write
+;;; adds at most one entry. Nothing moves while TABLE is being iterated,
+;;; when the only writes allowed are to keys already in it.
+(defun migrate-some-pairs (table)
+  (when (memq table *iterated-resizing-tables*)
+    (return-from migrate-some-pairs))
+  (let ((old-size (hash-table-pairs-capacity
+                   (hash-table-pairs (car (hash-table-%resize table)))))
+        (new-size (hash-table-pairs-capacity (hash-table-pairs table))))
+    (migrate-pairs table (max +incremental-resize-quantum+
+                              (ceiling old-size (max 1 (- new-size old-size)))))))
+
+(defun gethash/resizing (key table default)
+  (declare (hash-table table))
+  (with-resize-lock (table)
+    (let ((resize (hash-table-%resize table)))
+      (if (consp resize)
+          (let* ((old (car resize))
+                 (getter (hash-table-gethash-impl old)))
+            (declare (function getter))
+            (multiple-value-bind (value foundp) (funcall getter key table default)
+              (if foundp
+                  (values value t)
+                  (funcall getter key old default))))
+          ;; Finished by another thread while we waited for the lock.
+          (gethash3 key table default)))))
+
+(defun puthash/resizing (key table value)
+  (declare (hash-table table))
+  (with-resize-lock (table)
+    (let ((resize (hash-table-%resize table)))
+      (cond ((consp resize)
+             (let ((old (car resize)))
+               (migrate-some-pairs table)
+               ;; Entries only ever move from OLD to TABLE.
+               (funcall (hash-table-remhash-impl old) key old)
+               (funcall (hash-table-puthash-impl old) key table value)))
+            (t
+             (%puthash key table value))))))
+
+(defun remhash/resizing (key table)
+  (declare (hash-table table))
+  (with-resize-lock (table)
+    (let ((resize (hash-table-%resize table)))
+      (cond ((consp resize)
+             (let ((old (car resize)))
+               (migrate-some-pairs table)
+               (or (funcall (hash-table-remhash-impl old) key table)
+                   (funcall (hash-table-remhash-impl old) key old))))
+            (t
+             (remhash key table))))))
+
 (defun gethash (key hash-table &optional default)
   "Finds the entry in HASH-TABLE whose key is KEY and returns the
 associated value and T as multiple values, or returns DEFAULT and NIL
@@ -1464,16 +1772,25 @@ nnnn 1_    any       linear scan
           (t
            (values default nil)))))
 
-(defun pick-table-methods (synchronized kind)
+(defun pick-table-methods (synchronized kind &optional flat)
   (declare ((integer -1 3) kind))
   ;; test is specified as 0..3 for a standard fun or -1 for userfun
   (macrolet ((gen-cases (wrapping)
-              `(case kind
-                  (-1 (,wrapping gethash/any puthash/any remhash/any))
-                  (0  (,wrapping gethash/eq puthash/eq remhash/eq))
-                  (1  (,wrapping gethash/eql puthash/eql remhash/eql))
-                  (2  (,wrapping gethash/equal puthash/equal remhash/equal))
-                  (3  (,wrapping gethash/equalp puthash/equalp remhash/equalp))))
+              `(if flat
+                   (case kind
+                     (-1 (,wrapping gethash/flat-any puthash/flat-any remhash/flat-any))
+                     (0  (,wrapping gethash/flat-eq puthash/flat-eq remhash/flat-eq))
+                     (1  (,wrapping gethash/flat-eql puthash/flat-eql remhash/flat-eql))
+                     (2  (,wrapping gethash/flat-equal puthash/flat-equal
+                                    remhash/flat-equal))
+                     (3  (,wrapping gethash/flat-equalp puthash/flat-equalp
+                                    remhash/flat-equalp)))
+                   (case kind
+                     (-1 (,wrapping gethash/any puthash/any remhash/any))
+                     (0  (,wrapping gethash/eq puthash/eq remhash/eq))
+                     (1  (,wrapping gethash/eql puthash/eql remhash/eql))
+                     (2  (,wrapping gethash/equal puthash/equal remhash/equal))
+                     (3  (,wrapping gethash/equalp puthash/equalp remhash/equalp)))))
              (locked-methods (getter setter remover)
               ;; We might want to think about inlining the guts of CALL-WITH-...LOCK
               ;; into these methods
@@ -1886,6 +2203,11 @@ table itself."
   ;; bump the HWM, set them to desired values - because you can't let GC
   ;; observe junk, but you can't put good value at higher than the HWM]
   #+hash-table-simulate (setf (hash-table-%alist hash-table) nil)
+  (when (consp (hash-table-%resize hash-table))
+    ;; Drop the entries not yet moved.
+    (with-resize-lock (hash-table)
+      (when (consp (hash-table-%resize hash-table))
+        (end-incremental-resize hash-table))))
   (when (plusp (kv-vector-high-water-mark (hash-table-pairs hash-table)))
     (dx-flet ((clear ()
                 (let* ((kv-vector (hash-table-pairs hash-table))
@@ -1897,6 +2219,8 @@ table itself."
                   ;; Do this only after unsetting the address-sensitive bit,
                   ;; otherwise GC might come along and touch this bit again.
                   (setf (kv-vector-rehash-stamp kv-vector) 0)
+                  (awhen (hash-table-moved-key-log hash-table)
+                    (reset-moved-key-log it))
                   ;; We always deposit empty markers into k/v pairs that are REMHASHed,
                   ;; so a count of 0 implies no clearing need be done.
                   (when (plusp (hash-table-%count hash-table))
@@ -1915,6 +2239,421 @@ table itself."
   hash-table)
 
 
+;;;; Flat tables
+
+;;; A table made with :LAYOUT :FLAT stores each pair in the first free
+;;; slot of a probe sequence determined by the hash of its key, instead of
+;;; chaining the pairs of a bucket through NEXT-VECTOR. The sequence visits
+;;; groups of 16 slots. Which slots of a group might hold a key is found by
+;;; comparing the CONTROL byte of each slot with 7 bits of the hash, all 16
+;;; at once where the backend supports it, so that a lookup usually reads
+;;; one group of control bytes and one pair. Control byte I describes pair
+;;; index I+1, and the high-water-mark is always the capacity.
+;;;
+;;; The k/v vector, its supplement and the hash-vector are as for chained
+;;; tables, so GC treats both alike. When GC moves a key hashed by its
+;;; address, the table is rebuilt into new vectors by the first lookup of
+;;; such a key which misses. A reader doing that first moves the stamp of the
+;;; old k/v vector into the rehashing state, and installs the new control
+;;; vector before the new k/v vector, so that other readers can tell that
+;;; their miss might be wrong and retry.
+;;;
+;;; NEXT-FREE-KV holds the number of empty slots which may still be filled
+;;; before the table has to be rebuilt, which keeps at least 1/8 of the
+;;; slots empty or deleted and so ends every probe sequence.
+
+(defconstant +flat-empty+ #x80)
+(defconstant +flat-deleted+ #xfe)
+(defconstant +flat-group-size+ 16)
+
+;;; Return a mask of the bytes of CONTROL from INDEX to INDEX+15 which are BYTE.
+#+x86-64
+(defun %hash-control-match (control index byte)
+  (%hash-control-match control index byte))
+#-x86-64
+(defun %hash-control-match (control index byte)
+  (declare (type (simple-array (unsigned-byte 8) (*)) control)
+           (index index) ((unsigned-byte 8) byte))
+  (let ((mask 0))
+    (declare ((unsigned-byte 16) mask))
+    (dotimes (i +flat-group-size+ mask)
+      (when (= (aref control (+ index i)) byte)
+        (setq mask (logior mask (ash 1 i)))))))
+
+(declaim (inline flat-capacity flat-max-count flat-lowest-bit set-flat-control))
+(defun flat-capacity (control)
+  (- (length (the (simple-array (unsigned-byte 8) (*)) control)) +flat-group-size+))
+(defun flat-max-count (capacity)
+  (- capacity (ash capacity -3)))
+(defun flat-lowest-bit (mask)
+  (declare ((unsigned-byte 16) mask))
+  (1- (integer-length (logand mask (- mask)))))
+(defun set-flat-control (control slot byte)
+  (setf (aref control slot) byte)
+  ;; Keep the copy of the first group up to date.
+  (when (< slot +flat-group-size+)
+    (setf (aref control (+ slot (flat-capacity control))) byte)))
+
+;;; The smallest capacity which holds COUNT pairs.
+(defun flat-capacity-for (count)
+  (declare (index count))
+  (power-of-two-ceiling (max +flat-group-size+ (ceiling (* count 8) 7))))
+
+(defun make-flat-control (capacity)
+  (make-array (+ capacity +flat-group-size+)
+              :element-type '(unsigned-byte 8) :initial-element +flat-empty+))
+
+;;; Evaluate TEST with PAIR-INDEX and PAIR-KEY bound to each pair which might
+;;; hold a key whose prefuzzed hash is HASH, returning the first PAIR-INDEX
+;;; for which it is true, or 0. The starting group is picked by the bits
+;;; above the 7 stored in CONTROL. Successive groups are at triangular
+;;; offsets, which visit all of them since the capacity is a power of 2.
+(defmacro flat-search ((control hash kv-vector pair-index pair-key) test)
+  (with-unique-names (block)
+    `(block ,block
+       (let* ((mask (1- (flat-capacity ,control)))
+              (tag (logand ,hash #x7f))
+              (pos (logand (ash ,hash -7) mask))
+              (stride 0))
+         (declare (index pos stride))
+         (loop
+           (let ((matches (%hash-control-match ,control pos tag)))
+             (declare ((unsigned-byte 16) matches))
+             (loop until (zerop matches)
+                   do (let* ((,pair-index
+                               (1+ (logand (+ pos (flat-lowest-bit matches)) mask)))
+                             (,pair-key (aref ,kv-vector (* 2 ,pair-index))))
+                        (when ,test
+                          (return-from ,block ,pair-index)))
+                      (setq matches (logand matches (1- matches)))))
+           (when (or (/= (%hash-control-match ,control pos +flat-empty+) 0)
+                     (> (incf stride +flat-group-size+) mask))
+             (return-from ,block 0))
+           (setq pos (logand (+ pos stride) mask)))))))
+
+;;; Return the slot at which a key whose prefuzzed hash is HASH would be
+;;; inserted: the first one in its probe sequence which is empty or deleted.
+(defun flat-free-slot (control hash)
+  (declare (type (simple-array (unsigned-byte 8) (*)) control)
+           (type (and fixnum unsigned-byte) hash)
+           (optimize speed))
+  (let* ((mask (1- (flat-capacity control)))
+         (pos (logand (ash hash -7) mask))
+         (stride 0))
+    (declare (index pos stride))
+    (loop
+      (let ((free (logior (%hash-control-match control pos +flat-empty+)
+                          (%hash-control-match control pos +flat-deleted+))))
+        (unless (zerop free)
+          (return (logand (+ pos (flat-lowest-bit free)) mask))))
+      (incf stride +flat-group-size+)
+      (setq pos (logand (+ pos stride) mask)))))
+
+;;; Move the pairs of flat TABLE into new vectors with CAPACITY slots,
+;;; which drops the deleted slots and places address-based keys by their
+;;; current address. The caller must have exclusive access to the table,
+;;; or else have claimed the rebuild through the stamp of its k/v vector.
+(defun flat-rebuild (table capacity)
+  (declare (hash-table table) (index capacity))
+  (let* ((old-kv-vector (hash-table-pairs table))
+         (old-hash-vector (hash-table-hash-vector table))
+         (kv-vector (%alloc-kv-pairs capacity))
+         (hash-vector (when old-hash-vector
+                        (make-array (1+ capacity) :element-type 'hash-table-index)))
+         (control (make-flat-control capacity))
+         (eql-kind (= (ht-flags-kind (hash-table-flags table)) hash-table-kind-eql))
+         (count 0))
+    (declare (index count))
+    (setf (kv-vector-supplement kv-vector) (or hash-vector eql-kind)
+          (kv-vector-high-water-mark kv-vector) capacity)
+    ;; Pin each key from before its hash is taken until it is in KV-VECTOR
+    ;; and that is marked as address-sensitive.
+    (sb-vm::with-pinned-object-iterator (pin-object)
+      (loop for i from 1 to (kv-vector-high-water-mark old-kv-vector)
+            do (let ((key (aref old-kv-vector (* 2 i))))
+                 (unless (empty-ht-slot-p key)
+                   (pin-object key)
+                   (multiple-value-bind (hash stored-hash address-based-p)
+                       (cond ((and old-hash-vector
+                                   (/= (aref old-hash-vector i) +magic-hash-vector-value+))
+                              (let ((hash (aref old-hash-vector i)))
+                                (values hash hash nil)))
+                             (eql-kind
+                              (multiple-value-bind (hash0 address-based-p)
+                                  (eql-hash-no-memoize key)
+                                (values (prefuzz-hash hash0) nil address-based-p)))
+                             (t
+                              (values (prefuzz-hash (pointer-hash key))
+                                      +magic-hash-vector-value+
+                                      (sb-vm:is-lisp-pointer (get-lisp-obj-address key)))))
+                     (let* ((slot (flat-free-slot control hash))
+                            (pair-index (1+ slot)))
+                       (when address-based-p
+                         (logior-array-flags kv-vector sb-vm:vector-addr-hashing-flag))
+                       (when hash-vector
+                         (setf (aref hash-vector pair-index) stored-hash))
+                       (setf (aref kv-vector (* 2 pair-index)) key
+                             (aref kv-vector (1+ (* 2 pair-index)))
+                             (aref old-kv-vector (1+ (* 2 i))))
+                       (set-flat-control control slot (logand hash #x7f))
+                       (incf count)))))))
+    (setf (hash-table-control table) control
+          (hash-table-hash-vector table) hash-vector)
+    (sb-thread:barrier (:write))
+    (setf (hash-table-pairs table) kv-vector
+          (hash-table-%count table) count
+          (hash-table-next-free-kv table) (- (flat-max-count capacity) count)
+          (hash-table-cache table) 0)
+    table))
+
+;;; Rebuild TABLE, whose k/v vector KV-VECTOR had STAMP when a lookup of an
+;;; address-based key missed, unless another thread got there first.
+(defun flat-rehash (table kv-vector stamp)
+  (declare (hash-table table) (simple-vector kv-vector) (fixnum stamp))
+  (atomic-incf (hash-table-n-rehash+find table))
+  (without-interrupts
+    (when (eq (cas (svref kv-vector rehash-stamp-elt) stamp (1+ stamp)) stamp)
+      (flat-rebuild table (flat-capacity (hash-table-control table)))))
+  nil)
+
+;;; Add KEY, which is known to be absent and is pinned, to flat TABLE.
+(defun flat-insert (table key value hash address-based-p)
+  (declare (hash-table table) (type (and fixnum unsigned-byte) hash)
+           (optimize speed))
+  (let* ((control (hash-table-control table))
+         (slot (flat-free-slot control hash)))
+    (when (and (= (aref control slot) +flat-empty+)
+               (zerop (hash-table-next-free-kv table)))
+      ;; Grow, unless deleted slots account for much of the load,
+      ;; in which case dropping them is enough.
+      (let* ((capacity (flat-capacity control))
+             (count (hash-table-%count table))
+             (rehash-size (hash-table-rehash-size table)))
+        (flat-rebuild table
+                      (if (< (* 2 count) (flat-max-count capacity))
+                          capacity
+                          (flat-capacity-for
+                           (typecase rehash-size
+                             (float (max (the index (truncate (* rehash-size count)))
+                                         (1+ count)))
+                             (fixnum (+ rehash-size count)))))))
+      (setq control (hash-table-control table)
+            slot (flat-free-slot control hash)))
+    (let ((kv-vector (hash-table-pairs table))
+          (pair-index (1+ slot)))
+      (when (= (aref control slot) +flat-empty+)
+        (decf (hash-table-next-free-kv table)))
+      (when address-based-p
+        (logior-array-flags kv-vector sb-vm:vector-addr-hashing-flag))
+      (awhen (hash-table-hash-vector table)
+        (setf (aref it pair-index) (if address-based-p +magic-hash-vector-value+ hash)))
+      (setf (aref kv-vector (* 2 pair-index)) key
+            (aref kv-vector (1+ (* 2 pair-index))) value)
+      (set-flat-control control slot (logand hash #x7f))
+      (setf (hash-table-cache table) (* 2 pair-index))
+      (incf (hash-table-%count table))
+      value)))
+
+;;; Mark the slot of pair PAIR-INDEX of flat TABLE as free. It may become
+;;; empty rather than deleted if no group of 16 including it was ever full,
+;;; since then no probe sequence continued past it.
+(defun flat-delete (table pair-index)
+  (declare (hash-table table) (index pair-index) (optimize speed))
+  (let* ((control (hash-table-control table))
+         (kv-vector (hash-table-pairs table))
+         (slot (1- pair-index))
+         (empty-after (%hash-control-match control slot +flat-empty+))
+         (empty-before (%hash-control-match
+                        control (logand (- slot +flat-group-size+)
+                                        (1- (flat-capacity control)))
+                        +flat-empty+)))
+    (setf (aref kv-vector (* 2 pair-index)) +empty-ht-slot+
+          (aref kv-vector (1+ (* 2 pair-index))) +empty-ht-slot+)
+    (cond ((and (/= empty-after 0) (/= empty-before 0)
+                (< (+ (flat-lowest-bit empty-after)
+                      (- +flat-group-size+ (integer-length empty-before)))
+                   +flat-group-size+))
+           (set-flat-control control slot +flat-empty+)
+           (incf (hash-table-next-free-kv table)))
+          (t
+           (set-flat-control control slot +flat-deleted+)))
+    (decf (hash-table-%count table))
+    t))
+
+(eval-when (:compile-toplevel :load-toplevel :execute)
+  ;; Whether the key PAIR-KEY in pair PAIR-INDEX matches KEY. When the
+  ;; probing should use EQ per HT-PROBING-SHOULD-USE-EQ, it does.
+  ;; The control byte already matched 7 bits of the hash, so comparing
+  ;; the rest of it is only worthwhile before calling a predicate.
+  (defun flat-key-compare (std-fn)
+    (let ((general
+           (case std-fn
+             (eq nil)
+             (eql '(%eql key pair-key))
+             ((equal equalp)
+              `(and (= hash (aref hash-vector pair-index)) (,std-fn key pair-key)))
+             ((nil)
+              ;; A reader racing with a rebuild could see an empty pair,
+              ;; which must not be passed to a user's predicate.
+              '(and (= hash (aref hash-vector pair-index))
+                    (not (empty-ht-slot-p pair-key))
+                    (funcall test-fun key pair-key))))))
+      (if general
+          `(if eq-test (eq key pair-key) ,general)
+          '(eq key pair-key))))
+
+  (defun flat-probe-setup (std-fn)
+    `((control (hash-table-control hash-table))
+      ,@(unless (member std-fn '(eq eql))
+          '((hash-vector (hash-table-hash-vector hash-table))))
+      ,@(when (null std-fn)
+          '((test-fun (hash-table-test-fun hash-table))))
+      (pair-index (flat-search (control hash kv-vector pair-index pair-key)
+                               ,(flat-key-compare std-fn))))))
+
+(defmacro define-flat-ht-getter (name std-fn)
+  `(defun ,name (key table default &aux (hash-table (truly-the hash-table table)))
+     (declare (optimize speed (sb-c:verify-arg-count 0)))
+     (let ((kv-vector (hash-table-pairs hash-table))
+           (cache (hash-table-cache hash-table)))
+       (when (and (< cache (length kv-vector))
+                  (eq (aref kv-vector cache) key)
+                  (/= cache 0)) ; don't falsely match the metadata cell
+         (return-from ,name (values (aref kv-vector (1+ cache)) t))))
+     (with-pinned-objects (key)
+       (binding* (,@(ht-hash-setup std-fn 'gethash)
+                  (eq-test ,(ht-probing-should-use-eq std-fn)))
+         (declare (fixnum hash0) (ignorable eq-test))
+         (loop
+           (let* ((kv-vector (hash-table-pairs hash-table))
+                  (initial-stamp (kv-vector-rehash-stamp kv-vector)))
+             ;; The control vector must be read after the stamp.
+             (sb-thread:barrier (:read))
+             (binding* (,@(flat-probe-setup std-fn))
+               (declare (index pair-index))
+               (if (/= pair-index 0)
+                   (let ((key-index (* 2 pair-index)))
+                     (setf (hash-table-cache hash-table) key-index)
+                     (return (values (aref kv-vector (1+ key-index)) t)))
+                   (let ((stamp (kv-vector-rehash-stamp kv-vector)))
+                     ;; Like the chained getter, except that a concurrent
+                     ;; rebuild is waited out rather than searched around.
+                     (cond ((logtest initial-stamp kv-vector-rehashing)
+                            (sb-thread:thread-yield))
+                           ((/= (logandc2 stamp 1) (logandc2 initial-stamp 1)))
+                           ((or (evenp initial-stamp) (not address-based-p))
+                            (return (values default nil)))
+                           (t
+                            (flat-rehash hash-table kv-vector stamp))))))))))))
+
+(defmacro define-flat-ht-setter (name std-fn)
+  `(defun ,name (key table value &aux (hash-table (truly-the hash-table table)))
+     (declare (optimize speed (sb-c:verify-arg-count 0)))
+     (let ((kv-vector (hash-table-pairs hash-table))
+           (cache (hash-table-cache hash-table)))
+       (when (and (< cache (length kv-vector))
+                  (eq (aref kv-vector cache) key)
+                  (/= cache 0)) ; don't falsely match the metadata cell
+         (return-from ,name (setf (aref kv-vector (1+ cache)) value))))
+     (with-pinned-objects (key)
+       (binding* (,@(ht-hash-setup std-fn 'puthash)
+                  (eq-test ,(ht-probing-should-use-eq std-fn)))
+         (declare (fixnum hash0) (ignorable eq-test))
+         (loop
+           (binding* ((kv-vector (hash-table-pairs hash-table))
+                      (initial-stamp (kv-vector-rehash-stamp kv-vector))
+                      ,@(flat-probe-setup std-fn))
+             (declare (index pair-index))
+             (cond ((/= pair-index 0)
+                    (setf (hash-table-cache hash-table) (* 2 pair-index))
+                    (return (setf (aref kv-vector (1+ (* 2 pair-index))) value)))
+                   ((and address-based-p (oddp initial-stamp))
+                    ;; KEY might be present in the slot for its old address.
+                    (flat-rebuild hash-table (flat-capacity control)))
+                   (t
+                    (return (flat-insert hash-table key value hash
+                                         address-based-p))))))))))
+
+(defmacro define-flat-remhash (name std-fn)
+  `(defun ,name (key table &aux (hash-table (truly-the hash-table table)))
+     (declare (optimize speed (sb-c:verify-arg-count 0)))
+     (with-pinned-objects (key)
+       (binding* (,@(ht-hash-setup std-fn 'remhash)
+                  (eq-test ,(ht-probing-should-use-eq std-fn)))
+         (declare (fixnum hash0) (ignorable eq-test))
+         (loop
+           (binding* ((kv-vector (hash-table-pairs hash-table))
+                      (initial-stamp (kv-vector-rehash-stamp kv-vector))
+                      ,@(flat-probe-setup std-fn))
+             (declare (index pair-index))
+             (cond ((/= pair-index 0)
+                    (return (flat-delete hash-table pair-index)))
+                   ((and address-based-p (oddp initial-stamp))
+                    (flat-rebuild hash-table (flat-capacity control)))
+                   (t
+                    (return nil)))))))))
+
+(define-flat-ht-getter gethash/flat-eq eq)
+(define-flat-ht-getter gethash/flat-eql eql)
+(define-flat-ht-getter gethash/flat-equal equal)
+(define-flat-ht-getter gethash/flat-equalp equalp)
+(define-flat-ht-getter gethash/flat-any nil)
+(define-flat-ht-setter puthash/flat-eq eq)
+(define-flat-ht-setter puthash/flat-eql eql)
+(define-flat-ht-setter puthash/flat-equal equal)
+(define-flat-ht-setter puthash/flat-equalp equalp)
+(define-flat-ht-setter puthash/flat-any nil)
+(define-flat-remhash remhash/flat-eq eq)
+(define-flat-remhash remhash/flat-eql eql)
+(define-flat-remhash remhash/flat-equal equal)
+(define-flat-remhash remhash/flat-equalp equalp)
+(define-flat-remhash remhash/flat-any nil)
+
+(defun clrhash/flat (hash-table)
+  (dx-flet ((clear ()
+              (let* ((kv-vector (hash-table-pairs hash-table))
+                     (capacity (kv-vector-high-water-mark kv-vector)))
+                (reset-array-flags kv-vector sb-vm:vector-addr-hashing-flag)
+                (setf (kv-vector-rehash-stamp kv-vector) 0)
+                (when (< (hash-table-next-free-kv hash-table) (flat-max-count capacity))
+                  (fill kv-vector +empty-ht-slot+ :start 2 :end (* (1+ capacity) 2))
+                  (fill (hash-table-control hash-table) +flat-empty+)
+                  (setf (hash-table-%count hash-table) 0
+                        (hash-table-next-free-kv hash-table) (flat-max-count capacity)
+                        (hash-table-cache hash-table) 0)))))
+    (if (hash-table-synchronized-p hash-table)
+        (sb-thread::call-with-recursive-system-lock #'clear (hash-table-%lock hash-table))
+        (clear)))
+  hash-table)
+
+(defun %make-flat-hash-table (flags test test-fun hash-fun size rehash-size rehash-threshold)
+  (let* ((capacity (flat-capacity-for
+                    (max size (the index (truncate (/ (float size) rehash-threshold))))))
+         (kind (ht-flags-kind flags))
+         (userfunp (logtest flags hash-table-userfun-flag))
+         (synchronized (logtest flags hash-table-synchronized-flag))
+         (kv-vector (%alloc-kv-pairs capacity))
+         (hash-vector (when (or userfunp (>= kind 2))
+                        (make-array (1+ capacity) :element-type 'hash-table-index)))
+         (table
+          (multiple-value-bind (getter setter remover)
+              (pick-table-methods synchronized (if userfunp -1 kind) t)
+            (%alloc-hash-table flags getter setter remover #'clrhash/flat
+                               test test-fun hash-fun
+                               rehash-size rehash-threshold
+                               kv-vector
+                               #.(sb-xc:make-array 0 :element-type '(unsigned-byte 32))
+                               #.(sb-xc:make-array 0 :element-type '(unsigned-byte 32))
+                               hash-vector))))
+    (setf (kv-vector-supplement kv-vector)
+          (or hash-vector (= kind hash-table-kind-eql))
+          (kv-vector-high-water-mark kv-vector) capacity
+          (hash-table-control table) (make-flat-control capacity)
+          (hash-table-next-free-kv table) (flat-max-count capacity))
+    (when synchronized
+      (install-hash-table-lock table))
+    table))
+
 ;;;; methods on HASH-TABLE
 
 ;;; Return an association list representing the same data as HASH-TABLE.
@@ -1924,8 +2663,14 @@ table itself."
 ;;; same order as insertion, and moreover, preserving that order makes
 ;;; %STUFF-HASH-TABLE produce the same k/v vector.
 (defun %hash-table-alist (hash-table)
-  (let ((result nil))
-    (let ((kvv (hash-table-pairs hash-table)))
+  (let ((result nil)
+        (resize (hash-table-%resize hash-table)))
+    ;; During an incremental resize, the entries not yet moved are the
+    ;; older ones, so they go first.
+    (dolist (kvv (if (consp resize)
+                     (list (hash-table-pairs hash-table)
+                           (hash-table-pairs (car resize)))
+                     (list (hash-table-pairs hash-table))))
       (do ((i (* 2 (kv-vector-high-water-mark kvv)) (- i 2)))
           ((= i 0))
         (let ((k (aref kvv i))
@@ -1963,7 +2708,14 @@ table itself."
                         (:rehash-size ,#'hash-table-rehash-size ,default-rehash-size)
                         (:rehash-threshold ,#'hash-table-rehash-threshold $1.0)
                         (:synchronized ,#'hash-table-synchronized-p nil)
-                        (:weakness ,#'hash-table-weakness nil)))
+                        (:weakness ,#'hash-table-weakness nil)
+                        (:incremental-resize
+                         ,(lambda (table) (and (hash-table-%resize table) t))
+                         nil)
+                        (:layout
+                         ,(lambda (table)
+                            (if (hash-table-control table) :flat :chained))
+                         :chained)))
                      for value = (funcall accessor hash-table)
                      unless (eql value default)
                      collect key
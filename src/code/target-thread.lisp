@@ -416,6 +416,10 @@ See also: RETURN-FROM-THREAD and SB-EXT:EXIT."
       (define-structure-slot-addressor waitqueue-token-address
         :structure waitqueue
         :slot token
+        :byte-offset (+ #+(and 64-bit big-endian) 4))
+      (define-structure-slot-addressor rwlock-state-address
+        :structure rwlock
+        :slot state
         :byte-offset (+ #+(and 64-bit big-endian) 4)))
 
     (export 'futex-wake) ; for naughty users only
@@ -462,6 +466,18 @@ See also: RETURN-FROM-THREAD and SB-EXT:EXIT."
 
 (sb-ext:define-load-time-global **deadlock-lock** nil)
 
+;;; The thread a lock that can be waited for is exclusively held by.
+;;; Both readers and writers waiting for a RWLOCK are recorded in
+;;; THREAD-WAITING-FOR, so a cycle through a RWLOCK held for writing is
+;;; detected whichever kind of access the waiting thread wants. A RWLOCK
+;;; held only by readers has no owner, so cycles through its readers are
+;;; not.
+(declaim (inline lock-owner))
+(defun lock-owner (lock)
+  (if (mutex-p lock)
+      (mutex-%owner lock)
+      (rwlock-%writer lock)))
+
 ;;; Signals an error if owner of LOCK is waiting on a lock whose release
 ;;; depends on the current thread. Does not detect deadlocks from sempahores.
 (defun check-deadlock ()
@@ -470,7 +486,7 @@ See also: RETURN-FROM-THREAD and SB-EXT:EXIT."
                    (barrier (:read))
                    (thread-waiting-for self))))
     (labels ((detect-deadlock (lock)
-               (let ((other-thread (mutex-%owner lock)))
+               (let ((other-thread (lock-owner lock)))
                  (cond ((not other-thread))
                        ((eq self other-thread)
                         (let ((chain
@@ -498,10 +514,12 @@ See also: RETURN-FROM-THREAD and SB-EXT:EXIT."
                           ;; If the thread is waiting with a timeout OTHER-LOCK
                           ;; is a cons, and we don't consider it a deadlock -- since
                           ;; it will time out on its own sooner or later.
-                          (when (mutex-p other-lock)
+                          (when (or (mutex-p other-lock) (rwlock-p other-lock))
                             (detect-deadlock other-lock)))))))
              (deadlock-chain (thread lock)
-               (let* ((other-thread (mutex-owner lock))
+               (let* ((other-thread (progn
+                                      (barrier (:read))
+                                      (lock-owner lock)))
                       (other-lock (when other-thread
                                     (barrier (:read))
                                     (thread-waiting-for other-thread))))
@@ -525,7 +543,7 @@ See also: RETURN-FROM-THREAD and SB-EXT:EXIT."
                             ;; Again, the deadlock is gone?
                             (return-from check-deadlock nil)))))))
       ;; Timeout means there is no deadlock
-      (when (mutex-p origin)
+      (when (or (mutex-p origin) (rwlock-p origin))
         (detect-deadlock origin)
         t))))
 
@@ -915,6 +933,213 @@ IF-NOT-OWNER is :FORCE)."
       nil)))
 
 
+;;;; Reader-writer locks
+
+(setf (documentation 'make-rwlock 'function)
+      "Create a reader-writer lock. If PREFER-WRITERS is true (the default),
+threads asking for read access wait while a writer is waiting for the lock,
+so that writers are not starved by a steady stream of readers."
+      (documentation 'rwlock-name 'function)
+      "The name of the reader-writer lock. Setfable.")
+
+;;; The bits of RWLOCK-STATE above the two flags count the readers. A
+;;; thread which finds the lock unavailable sets the waiters flag before
+;;; going to sleep on the state word, and whoever clears the flag wakes
+;;; up all sleepers, which then compete for the lock again: there is no
+;;; queue to hand the lock over to a particular waiter.
+(defconstant +rwlock-writer+ 1)
+(defconstant +rwlock-waiters+ 2)
+(defconstant +rwlock-reader+ 4)
+
+(defmethod print-object ((rwlock rwlock) stream)
+  (let ((name (rwlock-name rwlock))
+        (writer (rwlock-writer rwlock))
+        (readers (truncate (rwlock-state rwlock) +rwlock-reader+))
+        (*print-circle* t))
+    (print-unreadable-object (rwlock stream :type t :identity (not name))
+      (cond (writer
+             (format stream "~@[~S ~]~2I~_writer: ~S" name writer))
+            ((plusp readers)
+             (format stream "~@[~S ~](~D reader~:P)" name readers))
+            (t
+             (format stream "~@[~S ~](free)" name))))))
+
+(defun %try-read-lock (rwlock)
+  (declare (type rwlock rwlock) (optimize (speed 3)))
+  (loop
+    (let ((old (rwlock-state rwlock)))
+      (when (or (logtest old +rwlock-writer+)
+                (and (rwlock-prefer-writers rwlock)
+                     (progn
+                       (barrier (:read))
+                       (plusp (rwlock-writers-waiting rwlock)))))
+        (when (eq (rwlock-%writer rwlock) *current-thread*)
+          (error "Recursive lock attempt ~S." rwlock))
+        (return nil))
+      (when (= old (sb-ext:cas (rwlock-state rwlock) old (+ old +rwlock-reader+)))
+        (return t)))))
+
+(defun %try-write-lock (rwlock new-owner)
+  (declare (type rwlock rwlock) (optimize (speed 3)))
+  (loop
+    (let ((old (rwlock-state rwlock)))
+      (unless (zerop (logandc2 old +rwlock-waiters+))
+        (when (eq (rwlock-%writer rwlock) new-owner)
+          (error "Recursive lock attempt ~S." rwlock))
+        (return nil))
+      (when (= old (sb-ext:cas (rwlock-state rwlock) old (logior old +rwlock-writer+)))
+        (setf (rwlock-%writer rwlock) new-owner)
+        (return t)))))
+
+;;; Clear the waiters flag, and wake up everybody if it was set.
+(defun %wake-rwlock-waiters (rwlock)
+  (declare (type rwlock rwlock) (ignorable rwlock))
+  #+sb-futex
+  (loop
+    (let ((old (rwlock-state rwlock)))
+      (unless (logtest old +rwlock-waiters+)
+        (return))
+      (when (= old (sb-ext:cas (rwlock-state rwlock) old
+                               (logandc2 old +rwlock-waiters+)))
+        (with-pinned-objects (rwlock)
+          (futex-wake (rwlock-state-address rwlock)
+                      (ldb (byte 29 0) most-positive-fixnum)))
+        (return)))))
+
+#+sb-thread
+(defun %%wait-for-rwlock (rwlock try to-sec to-usec stop-sec stop-usec)
+  (declare (type rwlock rwlock) (function try) (ignorable rwlock to-sec to-usec))
+  (declare (sb-ext:muffle-conditions sb-ext:compiler-note))
+  (cond
+   #+sb-futex
+   (t
+    (loop
+      (when (funcall try)
+        (return t))
+      (let ((old (rwlock-state rwlock)))
+        (cond ((not (logtest old +rwlock-waiters+))
+               ;; Ask to be woken up, then look at the lock again: whatever
+               ;; kept us out may have gone away before the flag was set.
+               (sb-ext:cas (rwlock-state rwlock) old (logior old +rwlock-waiters+)))
+              ((eql 1 (with-pinned-objects (rwlock)
+                        (futex-wait (rwlock-state-address rwlock) (ldb (byte 32 0) old)
+                                    (or to-sec -1) (or to-usec 0))))
+               ;; ETIMEDOUT
+               (return nil))
+              (stop-sec
+               (setf (values to-sec to-usec)
+                     (sb-impl::relative-decoded-times stop-sec stop-usec)))))))
+   #-sb-futex
+   (t
+    (%%wait-for try stop-sec stop-usec))))
+
+#+sb-thread
+(defun %wait-for-rwlock (rwlock self try timeout to-sec to-usec stop-sec stop-usec deadlinep)
+  (declare (sb-ext:muffle-conditions sb-ext:compiler-note))
+  (with-deadlocks (self rwlock timeout)
+    (with-interrupts (check-deadlock))
+    (tagbody
+     :again
+       (return-from %wait-for-rwlock
+         (or (%%wait-for-rwlock rwlock try to-sec to-usec stop-sec stop-usec)
+             (when deadlinep
+               (signal-deadline)
+               (setf (values to-sec to-usec stop-sec stop-usec deadlinep)
+                     (decode-timeout timeout))
+               (go :again)))))))
+
+(declaim (ftype (sfunction (rwlock &key (:waitp t) (:timeout (or null (real 0)))) boolean)
+                grab-read-lock grab-write-lock))
+(defun grab-read-lock (rwlock &key (waitp t) (timeout nil))
+  "Acquire RWLOCK for reading. Other threads may hold it for reading at
+the same time, but no thread holds it for writing until RELEASE-READ-LOCK
+is called. WAITP and TIMEOUT are as for GRAB-MUTEX, and likewise the
+return value tells whether the lock was acquired.
+
+Read locks are not recursive in the presence of writers: if RWLOCK
+prefers writers, a thread asking for a read lock it already holds waits
+for any waiting writer, which in turn waits for the thread to release its
+first read lock.
+
+A thread waiting for a read lock held for writing by another thread
+takes part in deadlock detection like a thread waiting for a mutex.
+
+It is recommended that you use WITH-READ-LOCK instead of calling
+GRAB-READ-LOCK directly."
+  (declare (ignorable waitp timeout))
+  (or (%try-read-lock rwlock)
+      #-sb-thread
+      (when waitp
+        (error "Strange deadlock on ~S in an unithreaded build?" rwlock))
+      #+sb-thread
+      (when waitp
+        (dx-flet ((try () (%try-read-lock rwlock)))
+          (multiple-value-call #'%wait-for-rwlock
+            rwlock *current-thread* #'try timeout (decode-timeout timeout))))))
+
+(defun grab-write-lock (rwlock &key (waitp t) (timeout nil))
+  "Acquire RWLOCK for writing, excluding all other readers and writers
+until RELEASE-WRITE-LOCK is called. WAITP and TIMEOUT are as for
+GRAB-MUTEX, and likewise the return value tells whether the lock was
+acquired. A thread waiting for a write lock held by another thread takes
+part in deadlock detection like a thread waiting for a mutex.
+
+It is recommended that you use WITH-WRITE-LOCK instead of calling
+GRAB-WRITE-LOCK directly."
+  (declare (ignorable waitp timeout))
+  (let ((self *current-thread*))
+    (or (%try-write-lock rwlock self)
+        #-sb-thread
+        (when waitp
+          (error "Strange deadlock on ~S in an unithreaded build?" rwlock))
+        #+sb-thread
+        (when waitp
+          (dx-flet ((try () (%try-write-lock rwlock self)))
+            (let ((got-it nil))
+              (sb-ext:atomic-incf (rwlock-writers-waiting rwlock))
+              (unwind-protect
+                   (setq got-it (multiple-value-call #'%wait-for-rwlock
+                                  rwlock self #'try timeout (decode-timeout timeout)))
+                (sb-ext:atomic-decf (rwlock-writers-waiting rwlock))
+                ;; Readers held back by our waiting need to look again.
+                (unless got-it
+                  (%wake-rwlock-waiters rwlock)))))))))
+
+(declaim (ftype (sfunction (rwlock) null) release-read-lock release-write-lock))
+(defun release-read-lock (rwlock)
+  "Release a read lock on RWLOCK acquired by GRAB-READ-LOCK. Wake up
+waiting threads if this was the last reader.
+
+Like RELEASE-MUTEX, this is not interrupt safe."
+  (loop
+    (let ((old (rwlock-state rwlock)))
+      (when (< old +rwlock-reader+)
+        (error "~S is not held for reading." rwlock))
+      (let ((new (- old +rwlock-reader+)))
+        (when (= old (sb-ext:cas (rwlock-state rwlock) old new))
+          (when (= new +rwlock-waiters+)
+            (%wake-rwlock-waiters rwlock))
+          (return nil))))))
+
+(defun release-write-lock (rwlock)
+  "Release the write lock on RWLOCK held by the current thread, and wake
+up waiting threads.
+
+Like RELEASE-MUTEX, this is not interrupt safe."
+  (let ((self *current-thread*))
+    (unless (eq self (sb-ext:compare-and-swap (rwlock-%writer rwlock) self nil))
+      (error "~S is not held for writing by ~S." rwlock self))
+    (loop
+      (let ((old (rwlock-state rwlock)))
+        (when (= old (sb-ext:cas (rwlock-state rwlock) old 0))
+          #+sb-futex
+          (when (logtest old +rwlock-waiters+)
+            (with-pinned-objects (rwlock)
+              (futex-wake (rwlock-state-address rwlock)
+                          (ldb (byte 29 0) most-positive-fixnum))))
+          (return nil))))))
+
+
 ;;;; Waitqueues/condition variables
 
 #+(and sb-thread (not sb-futex))
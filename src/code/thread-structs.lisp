@@ -50,6 +50,20 @@
   . #+sb-futex nil
     #-sb-futex (%owner %head %tail))
 
+(sb-xc:defstruct (rwlock (:copier nil)
+                         (:constructor make-rwlock (&key name (prefer-writers t))))
+  "Reader-writer lock type."
+  ;; Writer bit, waiters bit and reader count, see +RWLOCK-WRITER+ et al.
+  ;; Only the low 32 bits are used, so that this can be a futex word.
+  (state 0 :type #+sb-futex sb-vm:word #-sb-futex fixnum)
+  ;; If adding slots between STATE and NAME, please see futex_name() in linux_os.c
+  (name nil :type (or null simple-string))
+  (%writer nil :type (or null thread))
+  ;; Number of threads waiting to write. When PREFER-WRITERS is true new
+  ;; readers wait for these before entering.
+  (writers-waiting 0 :type sb-vm:word)
+  (prefer-writers t :type boolean :read-only t))
+
 (sb-xc:defstruct (semaphore (:copier nil)
                             (:constructor %make-semaphore (%count mutex queue)))
   "Semaphore type. The fact that a SEMAPHORE is a STRUCTURE-OBJECT
@@ -60,7 +74,7 @@ future."
   (mutex nil :read-only t :type mutex)
   (queue nil :read-only t :type waitqueue))
 
-(declaim (sb-ext:freeze-type waitqueue semaphore))
+(declaim (sb-ext:freeze-type waitqueue rwlock semaphore))
 
 (sb-ext:define-load-time-global *profiled-threads* :all)
 (declaim (type (or (eql :all) list) *profiled-threads*))
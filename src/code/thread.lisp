@@ -48,6 +48,12 @@ HOLDING-MUTEX-P."
 
 (defsetf mutex-value set-mutex-value)
 
+(declaim (inline rwlock-writer))
+(defun rwlock-writer (rwlock)
+  "The thread holding RWLOCK for writing, NIL if there is none. Like
+MUTEX-OWNER this is intended for informative purposes."
+  (sb-ext:compare-and-swap (rwlock-%writer rwlock) nil nil))
+
 (declaim (sb-ext:deprecated :final ("SBCL" "1.2.15") #'set-mutex-value))
 
 ;;; SPINLOCK no longer exists as a type -- provided for backwards compatibility.
@@ -116,7 +122,7 @@ HOLDING-MUTEX-P."
                        (,with (exec)))
                   ;; If we were waiting on a waitqueue, this becomes a bogus
                   ;; wakeup.
-                  (when (mutex-p ,prev)
+                  (when (or (mutex-p ,prev) (rwlock-p ,prev))
                     (setf (thread-waiting-for ,thread) ,prev)
                     (barrier (:write)))))
                (exec)))))))
@@ -182,6 +188,25 @@ held mutex, WITH-RECURSIVE-LOCK allows recursive lock attempts to succeed."
       ,wait-p
       ,timeout)))
 
+(defmacro with-read-lock ((rwlock &key (wait-p t) timeout) &body body)
+  "Acquire RWLOCK for reading for the dynamic scope of BODY. Any number of
+threads can hold RWLOCK for reading at the same time, but not while some
+thread holds it for writing. WAIT-P and TIMEOUT are as for WITH-MUTEX.
+
+If the lock isn't acquired, the body is not executed, and WITH-READ-LOCK
+returns NIL. Otherwise WITH-READ-LOCK returns the values of BODY."
+  `(dx-flet ((with-read-lock-thunk () ,@body))
+     (call-with-read-lock #'with-read-lock-thunk ,rwlock ,wait-p ,timeout)))
+
+(defmacro with-write-lock ((rwlock &key (wait-p t) timeout) &body body)
+  "Acquire RWLOCK for writing for the dynamic scope of BODY, excluding all
+other readers and writers. WAIT-P and TIMEOUT are as for WITH-MUTEX.
+
+If the lock isn't acquired, the body is not executed, and WITH-WRITE-LOCK
+returns NIL. Otherwise WITH-WRITE-LOCK returns the values of BODY."
+  `(dx-flet ((with-write-lock-thunk () ,@body))
+     (call-with-write-lock #'with-write-lock-thunk ,rwlock ,wait-p ,timeout)))
+
 (macrolet ((def (name &optional variant)
              `(defun ,(if variant (symbolicate name "/" variant) name)
                   (function mutex)
@@ -222,7 +247,17 @@ held mutex, WITH-RECURSIVE-LOCK allows recursive lock attempts to succeed."
   (defun call-with-recursive-system-lock (function lock)
     (declare (function function) (ignore lock))
     (without-interrupts
-      (funcall function))))
+      (funcall function)))
+
+  (defun call-with-read-lock (function rwlock waitp timeout)
+    (declare (ignore rwlock waitp timeout)
+             (function function))
+    (funcall function))
+
+  (defun call-with-write-lock (function rwlock waitp timeout)
+    (declare (ignore rwlock waitp timeout)
+             (function function))
+    (funcall function)))
 
 #+sb-thread
 (progn
@@ -263,6 +298,32 @@ held mutex, WITH-RECURSIVE-LOCK allows recursive lock attempts to succeed."
              (when (or had-it (setf got-it (grab-mutex lock)))
                (funcall function))
           (when got-it
-            (release-mutex lock)))))))
+            (release-mutex lock))))))
+
+  (defun call-with-read-lock (function rwlock waitp timeout)
+    (declare (function function))
+    (declare (dynamic-extent function))
+    (let ((got-it nil))
+      (without-interrupts
+        (unwind-protect
+             (when (setq got-it (allow-with-interrupts
+                                  (grab-read-lock rwlock :waitp waitp
+                                                         :timeout timeout)))
+               (with-local-interrupts (funcall function)))
+          (when got-it
+            (release-read-lock rwlock))))))
+
+  (defun call-with-write-lock (function rwlock waitp timeout)
+    (declare (function function))
+    (declare (dynamic-extent function))
+    (let ((got-it nil))
+      (without-interrupts
+        (unwind-protect
+             (when (setq got-it (allow-with-interrupts
+                                  (grab-write-lock rwlock :waitp waitp
+                                                          :timeout timeout)))
+               (with-local-interrupts (funcall function)))
+          (when got-it
+            (release-write-lock rwlock)))))))
 
 (sb-ext:define-load-time-global *make-thread-lock* nil)
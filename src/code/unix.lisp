@@ -348,6 +348,51 @@ corresponds to NAME, or NIL if there is none."
       (system-area-pointer
        (%write buf)))))
 
+;;; UNIX-WRITEV and UNIX-READV transfer to or from COUNT buffers
+;;; described by the iovec array IOV in a single call, returning the
+;;; total number of octets transferred.
+#-win32
+(progn
+  (define-alien-type nil
+    (struct iovec
+      (iov-base system-area-pointer)
+      (iov-len size-t)))
+
+  (defun unix-writev (fd iov count)
+    (declare (type unix-fd fd)
+             (type (unsigned-byte 16) count))
+    (int-syscall ("writev" int (* (struct iovec)) int) fd iov count))
+
+  (defun unix-readv (fd iov count)
+    (declare (type unix-fd fd)
+             (type (unsigned-byte 16) count))
+    (int-syscall ("readv" int (* (struct iovec)) int) fd iov count)))
+
+;;; UNIX-MMAP maps LEN octets of FD starting at file offset OFFSET
+;;; into memory, read-only and private. It returns the SAP of the
+;;; mapping, or NIL and the errno.
+#-win32
+(defun unix-mmap (fd len offset)
+  (declare (type unix-fd fd)
+           (type index len)
+           (type (alien off-t) offset))
+  (let ((sap (alien-funcall (extern-alien #-largefile "mmap"
+                                          #+largefile "mmap_largefile"
+                                          (function system-area-pointer
+                                                    system-area-pointer size-t
+                                                    int int int off-t))
+                            (int-sap 0) len prot_read map_private fd offset)))
+    ;; MAP_FAILED is (void*)-1
+    (if (= (sap-int sap) (ldb (byte sb-vm:n-machine-word-bits 0) -1))
+        (values nil (get-errno))
+        (values sap 0))))
+
+#-win32
+(defun unix-munmap (sap len)
+  (declare (type system-area-pointer sap)
+           (type index len))
+  (void-syscall ("munmap" system-area-pointer size-t) sap len))
+
 ;;; Set up a unix-piping mechanism consisting of an input pipe and an
 ;;; output pipe. Return two values: if no error occurred the first
 ;;; value is the pipe to be read from and the second is can be written
@@ -478,3 +478,59 @@
                 (setf (code-header-ref code wordindex)
                       (cons (code-header-ref code wordindex) locs)))))))))
   code)
+
+;;;; choosing among variants of a function compiled for different CPUs
+
+;;; Each entry is (NAME BASELINE . VARIANTS), where VARIANTS is a list of
+;;; (FEATURE-BIT . FUNCTION) in order of preference.
+(define-load-time-global *cpu-dispatched-functions* nil)
+
+(defun cpu-feature-p (feature-bit)
+  (let ((bits *cpu-feature-bits*))
+    (and (fixnump bits) (logbitp feature-bit bits))))
+
+(defun select-cpu-variant (entry baseline)
+  (destructuring-bind (name default . variants) entry
+    (setf (fdefn-fun (find-fdefn name))
+          (or (unless baseline
+                (loop for (feature-bit . fun) in variants
+                      when (cpu-feature-p feature-bit) return fun))
+              default))))
+
+;;; Called by SAVE with BASELINE true, so that nothing can call a variant
+;;; which the CPU running the saved core does not support, and by REINIT.
+(defun select-cpu-variants (&key baseline)
+  (dolist (entry *cpu-dispatched-functions*)
+    (select-cpu-variant entry baseline)))
+
+(defun register-cpu-variants (name variants)
+  (let ((entry (list* name (fdefn-fun (find-fdefn name)) variants)))
+    (setq *cpu-dispatched-functions*
+          (cons entry (remove name *cpu-dispatched-functions* :key #'car)))
+    ;; Callers go through the fdefn, like a PLT entry, so that changing
+    ;; the variant does not involve finding and patching each call site.
+    (pushnew name *never-statically-link* :test 'equal)
+    (select-cpu-variant entry nil))
+  name)
+
+;;; Define NAME as a function whose body is compiled once for the baseline
+;;; instruction set and once assuming AVX2. Which one NAME calls is decided
+;;; when it is loaded and again each time a core starts, so the AVX2 variant
+;;; need not test the CPU features where it uses the vector instructions.
+(defmacro define-cpu-dispatched-function (name lambda-list &body body)
+  #-avx2 `(defun ,name ,lambda-list ,@body)
+  #+avx2
+  (multiple-value-bind (forms decls doc) (parse-body body t)
+    (let ((avx2-name (package-symbolicate (cl:symbol-package name) name "/AVX2")))
+      `(progn
+         (defun ,avx2-name ,lambda-list
+           ,@decls
+           (declare (optimize (sb-c::assume-avx2 3)))
+           (block ,name ,@forms))
+         (defun ,name ,lambda-list
+           ,@(when doc (list doc))
+           ,@decls
+           (declare (optimize (sb-c::assume-avx2 0)))
+           ,@forms)
+         (register-cpu-variants
+          ',name (list (cons cpu-has-ymm-registers #',avx2-name)))))))
@@ -1265,16 +1265,18 @@
                  (if-alternative-constraints last))))
         (block-out pred))))
 
-(defun compute-block-in (block)
+(defun compute-block-in (block &optional pessimistic)
   (let ((in nil))
     (dolist (pred (block-pred block))
       ;; If OUT has not been calculated, assume it to be the universal
-      ;; set.
+      ;; set, or the empty set if PESSIMISTIC.
       (let ((out (block-out-for-successor pred block)))
-        (when out
-          (if in
-              (conset-intersection in out)
-              (setq in (copy-conset out))))))
+        (cond (out
+               (if in
+                   (conset-intersection in out)
+                   (setq in (copy-conset out))))
+              (pessimistic
+               (return-from compute-block-in (make-conset))))))
     (or in (make-conset))))
 
 (defun update-block-in (block)
@@ -1320,25 +1322,50 @@
               (push block leading-blocks))))
       (values (nreverse leading-blocks) (nreverse rest-of-blocks)))))
 
-;;; Append OBJ to the end of LIST as if by NCONC but only if it is not
-;;; a member already.
-(defun nconc-new (obj list)
-  (do ((x list (cdr x))
-       (prev nil x))
-      ((endp x) (if prev
-                    (progn
-                      (setf (cdr prev) (list obj))
-                      list)
-                    (list obj)))
-    (when (eql (car x) obj)
-      (return-from nconc-new list))))
+(defparameter *constraint-propagate-pass-limit* 30
+  "The number of times constraint propagation may process each block
+following a loop, on average, before giving up on finding the constraints
+which hold around loops, so that the time it takes stays proportional
+to the size of the component.")
+
+(defevent constraint-propagate-maxed-out
+  "*CONSTRAINT-PROPAGATE-PASS-LIMIT* exceeded.")
+
+;;; Give up on iterating to a fixpoint: assume that nothing is known
+;;; at the start of the blocks of REST-OF-BLOCKS reached by an edge
+;;; from a later block, and propagate constraints through them once.
+;;; Going through the blocks in DFO, that is every edge into them
+;;; which is not from a block preceding them.
+(defun propagate-constraints-pessimistically (rest-of-blocks)
+  (dolist (block rest-of-blocks)
+    (setf (block-out block) nil)
+    (let ((last (block-last block)))
+      (when (if-p last)
+        (setf (if-alternative-constraints last) nil)
+        (setf (if-consequent-constraints last) nil))))
+  (dolist (block rest-of-blocks)
+    (setf (block-in block) (compute-block-in block t))
+    (find-block-type-constraints block nil)))
 
 (defun find-and-propagate-constraints (component)
-  (let ((blocks-to-process ()))
+  ;; A FIFO of blocks whose BLOCK-IN may have changed, with the blocks
+  ;; in it marked by having it as their BLOCK-FLAG so that adding a
+  ;; block already in it takes constant time.
+  (let* ((queue (list nil))
+         (tail queue))
     (flet ((enqueue (blocks)
              (dolist (block blocks)
-               (when (block-type-check block)
-                 (setq blocks-to-process (nconc-new block blocks-to-process))))))
+               (when (and (block-type-check block)
+                          (neq (block-flag block) queue))
+                 (setf (block-flag block) queue
+                       tail (setf (cdr tail) (list block))))))
+           (dequeue ()
+             (let ((block (pop (cdr queue))))
+               (when block
+                 (unless (cdr queue)
+                   (setq tail queue))
+                 (setf (block-flag block) nil))
+               block)))
       (multiple-value-bind (leading-blocks rest-of-blocks)
           (leading-component-blocks component)
         ;; Update every block once to account for changes in the
@@ -1348,15 +1375,23 @@
         (dolist (block leading-blocks)
           (setf (block-in block) (compute-block-in block))
           (find-block-type-constraints block t))
-        (setq blocks-to-process (copy-list rest-of-blocks))
+        (enqueue rest-of-blocks)
         ;; The rest of the blocks.
         (dolist (block rest-of-blocks)
-          (aver (eq block (pop blocks-to-process)))
+          (aver (eq block (dequeue)))
           (setf (block-in block) (compute-block-in block))
           (enqueue (find-block-type-constraints block nil)))
         ;; Propagate constraints
-        (loop for block = (pop blocks-to-process)
+        (loop with budget = (* *constraint-propagate-pass-limit*
+                               (length rest-of-blocks))
+              for block = (dequeue)
               while block do
+              (when (minusp (decf budget))
+                (maybe-mumble "[Constraint Limit]")
+                (event constraint-propagate-maxed-out)
+                (loop while (dequeue))
+                (propagate-constraints-pessimistically rest-of-blocks)
+                (return))
               (unless (eq block (component-tail component))
                 (when (update-block-in block)
                   (enqueue (find-block-type-constraints block nil)))))
@@ -178,9 +178,57 @@
             (control-analyze-1-fun new-fun component)))))))
   (values))
 
+;;; Return true if BLOCK ends in a full call which never returns, such
+;;; as a call to ERROR or to signal a failed type check. The code for
+;;; these is only run when something has gone wrong, so it shouldn't
+;;; take up space among the code that runs normally.
+(defun cold-block-p (block)
+  (declare (type cblock block))
+  (let ((last (block-last block)))
+    (and (basic-combination-p last)
+         (not (node-tail-p last))
+         (eq (first (block-succ block))
+             (component-tail (block-component block)))
+         (eq (node-derived-type last) *empty-type*)
+         (not (eq (node-block (lambda-bind (block-home-lambda block)))
+                  block)))))
+
+;;; Move the cold blocks in the emit order of COMPONENT after the
+;;; other blocks of the same home lambda which are emitted
+;;; contiguously with them, so that code which runs together is
+;;; packed together and loops don't jump over error code. The first
+;;; block of each run is left where it is, so that the code of each
+;;; function still begins and ends where it did. (Error traps from
+;;; VOPs already go into the *ELSEWHERE* segment.)
+(defun emit-cold-blocks-last (component)
+  (declare (type component component))
+  (let ((tail (block-info (component-tail component))))
+    (flet ((home (note)
+             (block-home-lambda (block-annotation-block note))))
+      (do ((note (block-annotation-next (block-info (component-head component)))))
+          ((eq note tail))
+        (let ((home (home note))
+              (cold '()))
+          (setq note (block-annotation-next note))
+          (loop until (or (eq note tail) (neq (home note) home))
+                do (let ((next (block-annotation-next note)))
+                     (when (cold-block-p (block-annotation-block note))
+                       (let ((prev (block-annotation-prev note)))
+                         (setf (block-annotation-next prev) next)
+                         (setf (block-annotation-prev next) prev))
+                       (push note cold))
+                     (setq note next)))
+          (let ((after (block-annotation-prev note)))
+            (dolist (block (nreverse cold))
+              (add-to-emit-order block after)
+              (setq after block)))))))
+  (values))
+
 ;;; Do control analysis on COMPONENT, finding the emit order. Our only
 ;;; cleverness here is that we walk XEP's first to increase the
-;;; probability that the tail call will be a drop-through.
+;;; probability that the tail call will be a drop-through. Blocks that
+;;; only signal an error are then moved out of the way by
+;;; EMIT-COLD-BLOCKS-LAST.
 ;;;
 ;;; When we are done, we delete blocks that weren't reached by the
 ;;; walk. Some return blocks are made unreachable by LTN without
@@ -211,7 +259,9 @@
     (do-blocks (block component)
       (unless (block-flag block)
         (event control-deleted-block (block-start-node block))
-        (delete-block block))))
+        (delete-block block)))
+
+    (emit-cold-blocks-last component))
 
   (let ((2comp (component-info component)))
     (when (ir2-component-p 2comp)
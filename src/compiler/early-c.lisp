@@ -127,6 +127,9 @@
 (defvar *lambda-conversions*)
 (defvar *compile-object* nil)
 (defvar *location-context* nil)
+;;; While COMPILE-FILE is filling the fasl cache, a FASL-CACHE-RECORD of
+;;; the definitions the compilation used and the ones it made.
+(defvar *fasl-cache-record* nil)
 
 (defvar *handled-conditions* nil)
 (defvar *disabled-package-locks* nil)
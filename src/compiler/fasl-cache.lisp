@@ -0,0 +1,288 @@
+;;;; reusing the fasls of files which have been compiled before
+
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; This software is derived from the CMU CL system, which was
+;;;; written at Carnegie Mellon University and released into the
+;;;; public domain. The software is in the public domain and is
+;;;; provided with absolutely no warranty. See the COPYING and CREDITS
+;;;; files for more information.
+
+(in-package "SB-C")
+
+;;; When *FASL-CACHE-DIRECTORY* is set, COMPILE-FILE looks for an entry
+;;; named by a hash of its key: the truename and contents of the source
+;;; file, the version of SBCL, the policy, the calls which
+;;; *PROFILE-FEEDBACK* says are hot, and the other arguments and
+;;; specials which affect the fasl written. An entry is three files:
+;;;
+;;;  - the fasl;
+;;;  - the cfasl, which replays the compile-time side effects of the
+;;;    file, such as defining its macros and packages, when the entry is
+;;;    used instead of compiling;
+;;;  - the deps file, holding the key itself and the definitions made
+;;;    elsewhere which the compilation used, each with a fingerprint
+;;;    of the definition it used.
+;;;
+;;; An entry is used if its key is the same and every definition it
+;;; depends on still has the same fingerprint. The definitions
+;;; recorded are global macros, compiler macros, inline expansions
+;;; (with the INLINE or NOTINLINE proclamation of the function), and
+;;; the features tested by #+ and #-. Every global function name
+;;; referenced is recorded as all three of macro, compiler macro and
+;;; inline expansion, so that defining one of them later for a name
+;;; which had none invalidates the entry too. Definitions made by the file
+;;; itself are replayed by the cfasl and are not recorded. Other things
+;;; in the global environment which affect compilation, such as types,
+;;; structure definitions, constants and reader macros, are not
+;;; recorded. Neither are the functions which a macro calls while
+;;; expanding, nor any variables it reads: only the file defining the
+;;; macro itself is, so a change to a helper defined in another file
+;;; goes unnoticed. After changing any of these in one file, remove the
+;;; entries of the files depending on them, or the whole cache.
+;;;
+;;; Only compilations which signal no warnings (not even style
+;;; warnings) and which depend only on macros with a source file are
+;;; stored, so that using an entry never hides a diagnostic and never
+;;; depends on a definition typed at the REPL.
+
+(defstruct (fasl-cache-record (:copier nil) (:predicate nil))
+  ;; (KIND . NAME) of a definition the compilation used, to the
+  ;; fingerprint of the definition when it was first used
+  (dependencies (make-hash-table :test 'equal) :read-only t)
+  ;; (KIND . NAME) of the definitions made while compiling
+  (definitions (make-hash-table :test 'equal) :read-only t)
+  ;; true if a definition used has no fingerprint
+  (uncacheable nil))
+
+;;; 64-bit FNV-1a of OCTETS.
+(defun fasl-cache-hash (octets &optional (hash #xcbf29ce484222325))
+  (declare (type (simple-array (unsigned-byte 8) (*)) octets)
+           (type (unsigned-byte 64) hash))
+  (loop for octet across octets
+        do (setq hash (logand (* (logxor hash octet) #x100000001b3)
+                              #xffffffffffffffff)))
+  hash)
+
+(defun fasl-cache-print (object)
+  (with-standard-io-syntax
+    (let ((*package* *keyword-package*)
+          (*print-readably* nil)
+          (*print-circle* t))
+      (prin1-to-string object))))
+
+;;; Return a fingerprint of the definition of KIND named NAME which is
+;;; EQUAL to a fingerprint of the same definition taken in a different
+;;; image, and true, or NIL and NIL if the definition can't be
+;;; identified. The fingerprint of a definition which doesn't exist
+;;; is NIL. That of a macro or compiler macro covers only the file
+;;; defining it, not the functions it calls.
+(defun fasl-cache-fingerprint (kind name)
+  (flet ((fun-fingerprint (fun)
+           (let* ((info (and fun (%code-debug-info (fun-code-header (%fun-fun fun)))))
+                  (source (and (typep info 'debug-info) (debug-info-source info))))
+             ;; A function compiled from a file is identified by the
+             ;; file and the time it was written.
+             (cond ((not fun)
+                    (values nil t))
+                   ((and (typep source 'debug-source)
+                         (debug-source-namestring source)
+                         (debug-source-created source))
+                    (values (list (debug-source-namestring source)
+                                  (debug-source-created source))
+                            t))
+                   (t
+                    (values nil nil))))))
+    (let ((*fasl-cache-record* nil))
+      (ecase kind
+        (:feature
+         (values (sb-impl::featurep name) t))
+        (:macro
+         (fun-fingerprint (and (eq (info :function :kind name) :macro)
+                               (macro-function name))))
+        (:compiler-macro
+         (fun-fingerprint (compiler-macro-function name)))
+        (:inline
+         (values (list (info :function :inlinep name)
+                       (fasl-cache-hash
+                        (string-to-octets
+                         (fasl-cache-print (fun-name-inline-expansion name))
+                         :external-format :utf-8)))
+                 t))))))
+
+;;; Called by the compiler when it uses a definition of KIND named NAME
+;;; while *FASL-CACHE-RECORD* is set.
+(defun note-fasl-cache-dependency (kind name)
+  (let ((record *fasl-cache-record*)
+        (key (cons kind name)))
+    (unless (or (gethash key (fasl-cache-record-definitions record))
+                (nth-value 1 (gethash key (fasl-cache-record-dependencies record))))
+      (multiple-value-bind (fingerprint winp) (fasl-cache-fingerprint kind name)
+        (if winp
+            (setf (gethash key (fasl-cache-record-dependencies record)) fingerprint)
+            (setf (fasl-cache-record-uncacheable record) t))))))
+
+;;; Called when a definition of KIND named NAME is made while
+;;; *FASL-CACHE-RECORD* is set.
+(defun note-fasl-cache-definition (kind name)
+  (setf (gethash (cons kind name)
+                 (fasl-cache-record-definitions *fasl-cache-record*))
+        t))
+
+;;; Return a string of everything besides the definitions used which
+;;; determines the fasl compiled from SOURCE.
+(defun fasl-cache-key (source external-format)
+  (let ((octets (with-open-file (stream source :element-type '(unsigned-byte 8))
+                  (let ((octets (make-array (file-length stream)
+                                            :element-type '(unsigned-byte 8))))
+                    (read-sequence octets stream)
+                    octets))))
+    (fasl-cache-print
+     (list (lisp-implementation-version)
+           +fasl-file-version+
+           (sb-fasl::compute-features-affecting-fasl-format)
+           (namestring (truename source))
+           (length octets)
+           (fasl-cache-hash octets)
+           external-format
+           (policy-to-decl-spec *policy*)
+           (and *macro-policy* (policy-to-decl-spec *macro-policy*))
+           *block-compile-argument*
+           *entry-points-argument*
+           (package-name (sane-package))
+           *read-base*
+           *read-default-float-format*
+           (readtable-case *readtable*)
+           *derive-function-types*
+           *inline-expansion-limit*
+           *source-namestring*
+           *source-plist*
+           ;; Only which calls are hot matters, not the table itself.
+           (let ((feedback *profile-feedback*))
+             (and feedback
+                  (sort (loop for call being each hash-key
+                                of feedback using (hash-value hotp)
+                              when hotp
+                                collect (fasl-cache-print call))
+                        #'string<)))))))
+
+;;; Return true if the deps file DEPS is for KEY and every definition
+;;; it lists is as it was.
+(defun fasl-cache-entry-valid-p (deps key)
+  (let ((entry (handler-case
+                   (with-open-file (stream deps :if-does-not-exist nil)
+                     (when stream
+                       (with-standard-io-syntax
+                         (let ((*package* *keyword-package*)
+                               (*read-eval* nil))
+                           (read stream)))))
+                 ;; A package of a name it depends on is gone, or the
+                 ;; file was truncated.
+                 (error () nil))))
+    (and (listp entry)
+         (equal (getf entry :key) key)
+         (loop for ((kind . name) fingerprint) in (getf entry :dependencies)
+               always (multiple-value-bind (current winp)
+                          (fasl-cache-fingerprint kind name)
+                        (and winp (equal current fingerprint)))))))
+
+(defun copy-fasl-cache-file (from to)
+  (with-open-file (in from :element-type '(unsigned-byte 8))
+    (with-open-file (out to :direction :output :if-exists :supersede
+                            :element-type '(unsigned-byte 8))
+      (let ((buffer (make-array 65536 :element-type '(unsigned-byte 8))))
+        (loop for n = (read-sequence buffer in)
+              while (plusp n)
+              do (write-sequence buffer out :end n))))))
+
+(define-load-time-global *fasl-cache-temp-counter* (list 0))
+
+;;; Return a pathname next to PATHNAME which no other thread or process
+;;; uses.
+(defun fasl-cache-temp-pathname (pathname)
+  (make-pathname :type (format nil "~A-~D-~D" (pathname-type pathname)
+                               (sb-unix:unix-getpid)
+                               (atomic-incf (car *fasl-cache-temp-counter*)))
+                 :defaults pathname))
+
+;;; Write the entry into a temporary file and rename it, so that a
+;;; concurrent COMPILE-FILE never sees it half written. The deps file
+;;; is written last.
+(defun store-fasl-cache-entry (entry key record fasl cfasl)
+  (flet ((store (pathname writer)
+           (let ((temp (fasl-cache-temp-pathname pathname)))
+             (funcall writer temp)
+             (rename-file temp pathname))))
+    (ensure-directories-exist entry)
+    (store (make-pathname :type "fasl" :defaults entry)
+           (lambda (temp) (copy-fasl-cache-file fasl temp)))
+    (store (make-pathname :type "cfasl" :defaults entry)
+           (lambda (temp) (copy-fasl-cache-file cfasl temp)))
+    (store (make-pathname :type "deps" :defaults entry)
+           (lambda (temp)
+             (with-open-file (stream temp :direction :output :if-exists :supersede)
+               (with-standard-io-syntax
+                 (let ((*package* *keyword-package*))
+                   (prin1 (list :key key
+                                :dependencies
+                                (loop for dependency being each hash-key
+                                      of (fasl-cache-record-dependencies record)
+                                      using (hash-value fingerprint)
+                                      collect (list dependency fingerprint)))
+                          stream))))))))
+
+;;; COMPILE-FILE of a single file while *FASL-CACHE-DIRECTORY* is set.
+;;; Either load the cfasl of an entry for it and copy its fasl to the
+;;; output, or compile the file as usual, and store an entry if the
+;;; compilation was clean.
+(defun compile-file-with-cache (input-file external-format
+                                output-file-p output-file emit-cfasl)
+  (let* ((source (verify-source-file input-file))
+         (output-pathname (compile-file-pathname
+                           input-file (when output-file-p :output-file) output-file))
+         (cfasl-pathname (make-pathname :type "cfasl" :defaults output-pathname))
+         (key (fasl-cache-key source external-format))
+         (entry (merge-pathnames
+                 (format nil "~16,'0X"
+                         (fasl-cache-hash (string-to-octets key :external-format :utf-8)))
+                 (pathname *fasl-cache-directory*)))
+         (entry-fasl (make-pathname :type "fasl" :defaults entry))
+         (entry-cfasl (make-pathname :type "cfasl" :defaults entry)))
+    (when (and (fasl-cache-entry-valid-p (make-pathname :type "deps" :defaults entry) key)
+               (probe-file entry-fasl)
+               (probe-file entry-cfasl))
+      (when *compile-verbose*
+        (compiler-mumble "~&; using cached fasl ~A for ~A~%"
+                         (namestring entry-fasl) (namestring source)))
+      (load entry-cfasl :verbose nil :print nil)
+      (ensure-directories-exist output-pathname)
+      (copy-fasl-cache-file entry-fasl output-pathname)
+      (when emit-cfasl
+        (copy-fasl-cache-file entry-cfasl cfasl-pathname))
+      (return-from compile-file-with-cache
+        (values (or (and *merge-pathnames* (probe-file output-pathname))
+                    output-pathname)
+                nil
+                nil)))
+    ;; The entry needs a cfasl even if the caller didn't ask for one.
+    ;; Write that one beside the entry instead, so as not to touch a
+    ;; cfasl which may exist next to the output.
+    (let ((record (make-fasl-cache-record))
+          (cfasl (if emit-cfasl
+                     cfasl-pathname
+                     (fasl-cache-temp-pathname entry-cfasl))))
+      (unless emit-cfasl
+        (ensure-directories-exist cfasl))
+      (unwind-protect
+           (multiple-value-bind (output-truename warnings-p failure-p)
+               (let ((*fasl-cache-record* record))
+                 (%compile-files (list input-file) external-format
+                                 output-file-p output-file nil cfasl))
+             (when (and output-truename (not warnings-p) (not failure-p)
+                        (not (fasl-cache-record-uncacheable record)))
+               (store-fasl-cache-entry entry key record output-pathname cfasl))
+             (values output-truename warnings-p failure-p))
+        (unless emit-cfasl
+          (when (probe-file cfasl)
+            (delete-file cfasl)))))))
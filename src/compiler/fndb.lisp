@@ -783,6 +783,30 @@
 (defknown (%bit-pos-fwd %bit-pos-rev) (t simple-bit-vector index index)
   (or (mod #.(1- array-dimension-limit)) null)
   (foldable flushable))
+(defknown %octet-position ((unsigned-byte 8) simple-octet-vector t index index)
+  (or (mod #.(1- array-dimension-limit)) null)
+  (foldable flushable))
+(defknown %octet-count ((unsigned-byte 8) simple-octet-vector index index)
+  index
+  (foldable flushable))
+(defknown (%octet-mismatch %octet-mismatch-from-end)
+  (simple-octet-vector index simple-octet-vector index index)
+  index
+  (foldable flushable))
+(defknown %octet-search
+  (simple-octet-vector index index simple-octet-vector index index t)
+  (or (mod #.(1- array-dimension-limit)) null)
+  (foldable flushable))
+(defknown %octet-string-compare
+  (simple-base-string index index simple-base-string index index)
+  (values index fixnum)
+  (foldable flushable))
+(defknown %ub8-vector-sum ((simple-array (unsigned-byte 8) (*)) index index)
+  unsigned-byte
+  (foldable flushable))
+(defknown %ub32-vector-sum ((simple-array (unsigned-byte 32) (*)) index index)
+  unsigned-byte
+  (foldable flushable))
 
 (defknown count
   (t proper-sequence &rest t &key
@@ -1059,7 +1083,9 @@
         (:rehash-threshold (real 0 1))
         (:hash-function (or null function-designator))
         (:weakness (member nil :key :value :key-and-value :key-or-value))
-        (:synchronized t))
+        (:synchronized t)
+        (:incremental-resize t)
+        (:layout (member :chained :flat)))
   hash-table
   (flushable))
 (defknown sb-impl::make-hash-table-using-defaults (integer) hash-table (flushable))
@@ -1610,6 +1636,7 @@
                                            :append :supersede nil))
                        (:if-does-not-exist (member :error :create nil))
                        (:external-format external-format-designator)
+                       (:mmap t)
                        #+win32 (:overlapped t))
   (or stream null))
 
@@ -93,6 +93,28 @@
 ;;;; miscellaneous "sub-primitives"
 
 (defknown pointer-hash (t) fixnum (flushable))
+(defknown sb-impl::%hash-control-match
+  ((simple-array (unsigned-byte 8) (*)) index (unsigned-byte 8)) (unsigned-byte 16)
+  (flushable))
+#+x86-64
+(progn
+  (defknown sb-vm::octet-match-mask
+      (simple-octet-vector index (unsigned-byte 8)) (unsigned-byte 32)
+      (flushable))
+  (defknown sb-vm::octet-compare-mask
+      (simple-octet-vector index simple-octet-vector index) (unsigned-byte 32)
+      (flushable))
+  (defknown sb-vm::fill-words (simple-unboxed-array index index word) (values)
+      ())
+  (defknown sb-vm::copy-words
+      (simple-unboxed-array index simple-unboxed-array index index) (values)
+      ())
+  (defknown sb-vm::vector-map-blocks
+      (symbol (simple-array * (*)) (simple-array * (*)) (simple-array * (*)) index)
+      (values)
+      ())
+  (defknown sb-vm::sum-blocks ((member 8 32) (simple-array * (*)) index index) word
+      (flushable)))
 
 (defknown %sp-string-compare
   (simple-string index (or null index) simple-string index (or null index))
@@ -1313,6 +1313,26 @@
                      (mark-for-deletion succ)))))
         t))))
 
+;;; The name of the global function NAME is in, for
+;;; *PROFILE-FEEDBACK*: (FLET F :IN FOO) and (LAMBDA (X) :IN FOO) are
+;;; in FOO.
+(defun profile-feedback-name (name)
+  (loop while (and (consp name)
+                   (eq (car (last name 2)) :in))
+        do (setq name (car (last name))))
+  name)
+
+;;; Does *PROFILE-FEEDBACK* say that CALL to LEAF is hot?
+(defun hot-call-p (call leaf)
+  (let ((feedback *profile-feedback*))
+    (and feedback
+         (policy call (<= space 1))
+         (values
+          (gethash (cons (profile-feedback-name
+                          (leaf-debug-name (node-home-lambda call)))
+                         (leaf-source-name leaf))
+                   feedback)))))
+
 ;;; This is called both by IR1 conversion and IR1 optimization when
 ;;; they have verified the type signature for the call, and are
 ;;; wondering if something should be done to special-case the call. If
@@ -1320,12 +1340,12 @@
 ;;; or known:
 ;;; -- If a DEFINED-FUN should be inline expanded, then convert
 ;;;    the expansion and change the call to call it. Expansion is
-;;;    enabled if INLINE or if SPACE=0. If the FUNCTIONAL slot is
-;;;    true, we never expand, since this function has already been
-;;;    converted. Local call analysis will duplicate the definition
-;;;    if necessary. We claim that the parent form is LABELS for
-;;;    context declarations, since we don't want it to be considered
-;;;    a real global function.
+;;;    enabled if INLINE, if SPACE=0, or if *PROFILE-FEEDBACK* says
+;;;    the call is hot. If the FUNCTIONAL slot is true, we never
+;;;    expand, since this function has already been converted. Local
+;;;    call analysis will duplicate the definition if necessary. We
+;;;    claim that the parent form is LABELS for context declarations,
+;;;    since we don't want it to be considered a real global function.
 ;;; -- If it is a known function, mark it as such by setting the KIND.
 ;;;
 ;;; We return the leaf referenced (NIL if not a leaf) and the
@@ -1355,7 +1375,8 @@
       ((and (ecase inlinep
               (inline t)
               (no-chance nil)
-              ((nil maybe-inline) (policy call (zerop space))))
+              ((nil maybe-inline) (or (policy call (zerop space))
+                                      (hot-call-p call leaf))))
             (defined-fun-p leaf)
             (defined-fun-inline-expansion leaf)
             (inline-expansion-ok call leaf))
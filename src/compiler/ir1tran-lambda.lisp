@@ -1469,6 +1469,9 @@ is potentially harmful to any already-compiled callers using (SAFETY 0)."
 ;;; The inline lambda will be NIL for a structure accessor, predicate, or copier
 ;;; since those can always be reconstructed from a defstruct description.
 (defun %compiler-defun (name compile-toplevel inline-lambda extra-info)
+  #-sb-xc-host
+  (when *fasl-cache-record*
+    (note-fasl-cache-definition :inline name))
   (let ((defined-fun nil)) ; will be set below if we're in the compiler
     (when compile-toplevel
       (with-single-package-locked-error
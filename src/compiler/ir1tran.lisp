@@ -348,6 +348,14 @@
            (check-fun-name name)
            (let ((expansion (fun-name-inline-expansion name))
                  (inlinep (info :function :inlinep name)))
+             #-sb-xc-host
+             (when *fasl-cache-record*
+               ;; Record that NAME is not a macro, and whether it has a
+               ;; compiler macro, so that defining either later
+               ;; invalidates the cached fasl.
+               (note-fasl-cache-dependency :macro name)
+               (note-fasl-cache-dependency :compiler-macro name)
+               (note-fasl-cache-dependency :inline name))
              (setf (gethash name free-funs)
                    (if (or expansion inlinep)
                        (let ((where (info :function :where-from name)))
@@ -892,6 +900,9 @@
             ;; suppresses compiler-macros.
             (not (fun-lexically-notinline-p cmacro-fun-name)))
        (check-deprecated-thing 'function name)
+       #-sb-xc-host
+       (when *fasl-cache-record*
+         (note-fasl-cache-dependency :compiler-macro cmacro-fun-name))
        (values (handler-case (careful-expand-macro cmacro-fun form t)
                  (compiler-macro-keyword-problem (condition)
                    (print-compiler-message
@@ -975,6 +986,9 @@
   ;; happens with lexically-defined (MACROLET) macros here, anyway?
   (ecase (info :function :kind fun)
     (:macro
+     #-sb-xc-host
+     (when *fasl-cache-record*
+       (note-fasl-cache-dependency :macro fun))
      (ir1-convert start next result
                   (careful-expand-macro (info :function :macro-function fun)
                                         form))
@@ -1129,6 +1143,40 @@
         (setf (combination-args node) (arg-lvars))))
     node))
 
+;;; A form calling the generic function NAME with the arguments of FORM
+;;; through a cache of the fast method function for the wrapper of the
+;;; first argument (see SB-PCL::FILL-CALL-SITE-CACHE), saving the
+;;; dispatch of the discriminating function while the class of the
+;;; first argument at this call stays the same. A miss refills the
+;;; cache, unless it has missed too often already, and then calls the
+;;; generic function as usual. NIL if FORM should be converted as
+;;; usual.
+(defun gf-call-site-cache-form (name form)
+  #+sb-xc-host (declare (ignore name form))
+  #-sb-xc-host
+  (let ((args (cdr form)))
+    (when (and (consp args)
+               (proper-list-p args)
+               (eq (info :function :type name) :generic-function)
+               (not (info :function :info name))
+               (policy *lexenv* (> speed (max space debug))))
+      (let ((temps (make-gensym-list (length args)))
+            (cache (gensym "CACHE"))
+            (entry (gensym "ENTRY")))
+        `(let ,(mapcar #'list temps args)
+           (let* ((,cache (load-time-value
+                           (sb-impl::make-call-site-cache ',name) t))
+                  (,entry (sb-impl::call-site-cache-entry ,cache)))
+             (if (eq (wrapper-of ,(first temps)) (svref ,entry 0))
+                 (funcall (truly-the function (svref ,entry 1))
+                          (svref ,entry 2) (svref ,entry 3) ,@temps)
+                 (progn
+                   (when (< (sb-impl::call-site-cache-misses ,cache)
+                            sb-impl::+call-site-cache-max-misses+)
+                     (sb-pcl::fill-call-site-cache ,cache (list ,@temps)))
+                   (locally (declare (notinline ,name))
+                     (,name ,@temps))))))))))
+
 ;;; Convert a call to a global function. If not NOTINLINE, then we do
 ;;; source transforms and try out any inline expansion. If there is no
 ;;; expansion, but is INLINE, then give an efficiency note (unless a
@@ -1162,9 +1210,12 @@
                          (when (eq (car *current-path*) 'original-source-start)
                            (setf (ctran-source-path start) *current-path*))
                          (ir1-convert start next result transformed)))))
-              (ir1-convert-maybe-predicate start next result
-                                           (proper-list form)
-                                           var))))))
+              (let ((cached (gf-call-site-cache-form name form)))
+                (if cached
+                    (ir1-convert start next result cached)
+                    (ir1-convert-maybe-predicate start next result
+                                                 (proper-list form)
+                                                 var))))))))
 
 
 ;;; KLUDGE: If we insert a synthetic IF for a function with the PREDICATE
@@ -16,6 +16,21 @@
 (defvar *block-compile-default* nil
   "The default value for the :Block-Compile argument to COMPILE-FILE.")
 
+(defvar *fasl-cache-directory* nil
+  "If non-NIL, a directory in which COMPILE-FILE keeps the fasls it
+produces, to be reused instead of compiling a file again when neither the
+file nor anything recorded as affecting its compilation has changed.
+See SB-C::COMPILE-FILE-WITH-CACHE for what is recorded.")
+
+(defvar *profile-feedback* nil
+  "NIL, or an EQUAL hash table whose keys are conses (CALLER . CALLEE) of
+the names of functions, for the calls which took a large part of the time
+profiled, as returned by SB-SPROF:READ-PROFILE-FEEDBACK. The name of a
+local function or lambda is that of the global function it is in. Calls
+to functions with an inline expansion, such as those declared
+MAYBE-INLINE, are expanded inline at those call sites unless SPACE is
+above 1.")
+
 (defvar *entry-points-argument*)
 (declaim (type list *entry-points-argument*))
 
@@ -62,6 +77,131 @@
   (when *compile-progress*
     (apply #'compiler-mumble foo)))
 
+;;;; profiling the phases of compilation
+
+(defvar *compile-phase-profile* nil
+  "When this is true, each compilation unit records the real time taken
+  and the bytes consed by each phase of the compilation of each function,
+  and how often IR1 optimization hit its iteration limits, and at its end
+  prints to *STANDARD-OUTPUT* the totals by phase followed by the
+  functions which took longest to compile. If it is an integer, that many
+  functions are printed, else 10.")
+
+(defstruct (phase-profile-entry (:constructor make-phase-profile-entry (name))
+                                (:copier nil) (:predicate nil))
+  (name nil :read-only t)
+  ;; list of (PHASE TIME . BYTES), with TIME in internal time units,
+  ;; not counting the phases nested in PHASE
+  (phases nil :type list)
+  ;; the number of calls to IR1-OPTIMIZE-UNTIL-DONE, and of the times
+  ;; it hit *MAX-OPTIMIZE-ITERATIONS* and IR1-OPTIMIZE-PHASE-1 hit
+  ;; *REOPTIMIZE-LIMIT*
+  (optimize-passes 0 :type index)
+  (optimize-maxed-out 0 :type index)
+  (reoptimize-maxed-out 0 :type index))
+
+;;; A cons whose CAR is the list of PHASE-PROFILE-ENTRYs of the
+;;; components compiled in the current compilation unit, most recent
+;;; first, or NIL if it isn't being profiled.
+(defvar *phase-profile* nil)
+;;; The entry of the component being compiled.
+(defvar *phase-profile-entry* nil)
+;;; (TIME . BYTES) of the phases nested in the one being profiled.
+(defvar *phase-profile-nested* nil)
+
+(defun phase-profile-bytes ()
+  #+sb-xc-host 0
+  #-sb-xc-host (get-bytes-consed))
+
+(defun call-with-phase-profile (phase fun)
+  (declare (function fun))
+  (let ((entry *phase-profile-entry*)
+        (outer *phase-profile-nested*)
+        (nested (cons 0 0))
+        (start-time (get-internal-real-time))
+        (start-bytes (phase-profile-bytes)))
+    (multiple-value-prog1 (let ((*phase-profile-nested* nested))
+                            (funcall fun))
+      (let ((time (- (get-internal-real-time) start-time))
+            (bytes (- (phase-profile-bytes) start-bytes))
+            (cell (or (assoc phase (phase-profile-entry-phases entry))
+                      (car (push (list* phase 0 0)
+                                 (phase-profile-entry-phases entry))))))
+        (incf (cadr cell) (- time (car nested)))
+        (incf (cddr cell) (- bytes (cdr nested)))
+        (when outer
+          (incf (car outer) time)
+          (incf (cdr outer) bytes))))))
+
+;;; Execute BODY as PHASE of the compilation of the current component.
+(defmacro with-phase-profile ((phase) &body body)
+  `(flet ((phase () ,@body))
+     (declare (dynamic-extent #'phase))
+     (if *phase-profile-entry*
+         (call-with-phase-profile ,phase #'phase)
+         (phase))))
+
+(defmacro note-phase-profile-event (accessor)
+  `(awhen *phase-profile-entry*
+     (incf (,accessor it))))
+
+(defun phase-profile-entry-time (entry)
+  (reduce #'+ (phase-profile-entry-phases entry) :key #'cadr))
+
+;;; Print the totals of each phase over the components of ENTRIES, then
+;;; the COUNT components which took longest, with their slowest phases.
+(defun report-phase-profile (entries count stream)
+  (let ((totals '())
+        (entries (stable-sort (reverse entries) #'>
+                              :key #'phase-profile-entry-time)))
+    (flet ((msec (time)
+             (/ (* time 1000.0) internal-time-units-per-second))
+           (sum (key)
+             (reduce #'+ entries :key key)))
+      (dolist (entry entries)
+        (loop for (phase time . bytes) in (phase-profile-entry-phases entry)
+              for cell = (or (assoc phase totals)
+                             (car (push (list* phase 0 0) totals)))
+              do (incf (cadr cell) time)
+                 (incf (cddr cell) bytes)))
+      (setq totals (sort totals #'> :key #'cadr))
+      (fresh-line stream)
+      (pprint-logical-block (stream nil :per-line-prefix "; ")
+        (format stream "compilation phase profile: ~D component~:P, ~,1F msec, ~
+                        ~:D byte~:P consed~@
+                        ~D IR1 optimization pass~:P, ~D hitting ~
+                        *MAX-OPTIMIZE-ITERATIONS*, ~D hitting *REOPTIMIZE-LIMIT*~
+                        ~%~%  ~16A ~10@A ~14@A"
+                (length entries)
+                (msec (reduce #'+ totals :key #'cadr))
+                (reduce #'+ totals :key #'cddr)
+                (sum #'phase-profile-entry-optimize-passes)
+                (sum #'phase-profile-entry-optimize-maxed-out)
+                (sum #'phase-profile-entry-reoptimize-maxed-out)
+                "phase" "msec" "bytes")
+        (loop for (phase time . bytes) in totals
+              do (format stream "~%  ~(~16A~) ~10,1F ~14:D" phase (msec time) bytes))
+        (format stream "~%~%  ~10@A ~14@A ~5@A ~5@A ~5@A  component"
+                "msec" "bytes" "opt" "max" "reopt")
+        (loop for entry in entries
+              repeat count
+              do (let ((phases (sort (copy-list (phase-profile-entry-phases entry))
+                                     #'> :key #'cadr)))
+                   (format stream "~%  ~10,1F ~14:D ~5D ~5D ~5D  ~A~
+                                   ~%    ~{~(~A~) ~,1F~^, ~}"
+                           (msec (phase-profile-entry-time entry))
+                           (reduce #'+ phases :key #'cddr)
+                           (phase-profile-entry-optimize-passes entry)
+                           (phase-profile-entry-optimize-maxed-out entry)
+                           (phase-profile-entry-reoptimize-maxed-out entry)
+                           (phase-profile-entry-name entry)
+                           (loop for (phase time) in phases
+                                 repeat 4
+                                 collect phase
+                                 collect (msec time))))))
+      (terpri stream)
+      (force-output stream))))
+
 
 (deftype object () '(or fasl-output core-object null))
 (declaim (type object *compile-object*))
@@ -185,6 +325,7 @@ Examples:
                        (*undefined-warnings* nil)
                        *argument-mismatch-warnings*
                        *methods-in-compilation-unit*
+                       (*phase-profile* (and *compile-phase-profile* (list nil)))
                        (*in-compilation-unit* t))
                    (handler-bind ((parse-unknown-type
                                     (lambda (c)
@@ -195,7 +336,14 @@ Examples:
                           (multiple-value-prog1 (funcall fn) (setf succeeded-p t))
                        (unless succeeded-p
                          (incf *aborted-compilation-unit-count*))
-                       (summarize-compilation-unit (not succeeded-p)))))))))
+                       (summarize-compilation-unit (not succeeded-p))
+                       (when *phase-profile*
+                         (report-phase-profile
+                          (car *phase-profile*)
+                          (if (typep *compile-phase-profile* 'index)
+                              *compile-phase-profile*
+                              10)
+                          *standard-output*)))))))))
     (if policy
         (let ((*policy* (process-optimize-decl policy (unless override *policy*)))
               (*policy-min* (unless override *policy-min*))
@@ -403,6 +551,7 @@ necessary, since type inference may take arbitrarily long to converge.")
   (declare (type component component))
   (maybe-mumble "Opt")
   (event ir1-optimize-until-done)
+  (note-phase-profile-event phase-profile-entry-optimize-passes)
   (let ((count 0)
         (cleared-reanalyze nil)
         (fastp nil))
@@ -425,6 +574,7 @@ necessary, since type inference may take arbitrarily long to converge.")
                       (setq count 0))
                      (t
                       (event ir1-optimize-maxed-out)
+                      (note-phase-profile-event phase-profile-entry-optimize-maxed-out)
                       (ir1-optimize-last-effort component)
                       (return)))))
             ((retry-delayed-ir1-transforms :optimize)
@@ -466,16 +616,19 @@ necessary, since type inference may take arbitrarily long to converge.")
     (tagbody
      again
        (loop
-        (ir1-optimize-until-done component)
+        (with-phase-profile (:ir1-optimize)
+          (ir1-optimize-until-done component))
         (when (or (component-new-functionals component)
                   (component-reanalyze-functionals component))
           (maybe-mumble "Locall ")
-          (locall-analyze-component component))
+          (with-phase-profile (:locall)
+            (locall-analyze-component component)))
         (eliminate-dead-code component)
         (dfo-as-needed component)
         (when *constraint-propagate*
           (maybe-mumble "Constraint ")
-          (constraint-propagate component)
+          (with-phase-profile (:constraint)
+            (constraint-propagate component))
           (when (retry-delayed-ir1-transforms :constraint)
             (setf loop-count 0) ;; otherwise nothing may get retried
             (maybe-mumble "Rtran ")))
@@ -487,6 +640,7 @@ necessary, since type inference may take arbitrarily long to converge.")
         (when (> loop-count *reoptimize-limit*)
           (maybe-mumble "[Reoptimize Limit]")
           (event reoptimize-maxed-out)
+          (note-phase-profile-event phase-profile-entry-reoptimize-maxed-out)
           (return))
         (incf loop-count))
        ;; Do it once more for the transforms that will produce code
@@ -510,14 +664,16 @@ necessary, since type inference may take arbitrarily long to converge.")
     (ir1-optimize-phase-1 component)
     (loop while (progn
                   (maybe-mumble "Type ")
-                  (generate-type-checks component))
+                  (with-phase-profile (:type-check)
+                    (generate-type-checks component)))
           do
           (ir1-optimize-phase-1 component))
     ;; Join the blocks that were generated by GENERATE-TYPE-CHECKS
     ;; now that all the blocks have the same TYPE-CHECK attribute
     (join-blocks-if-possible component))
 
-  (ir1-finalize component)
+  (with-phase-profile (:ir1-finalize)
+    (ir1-finalize component))
   (values))
 
 ;;; COMPILE-FILE usually puts all nontoplevel code in immobile space, but COMPILE
@@ -565,25 +721,29 @@ necessary, since type inference may take arbitrarily long to converge.")
 (defun %compile-component (component)
   (let ((*adjustable-vectors* nil)) ; Needed both by codegen and fasl writer
     (maybe-mumble "GTN ")
-    (gtn-analyze component)
+    (with-phase-profile (:gtn)
+      (gtn-analyze component))
     (maybe-mumble "LTN ")
-    (ltn-analyze component)
+    (with-phase-profile (:ltn)
+      (ltn-analyze component))
     (dfo-as-needed component)
 
     (maybe-mumble "Control ")
-    (control-analyze component)
+    (with-phase-profile (:control)
+      (control-analyze component))
 
     (report-code-deletion)
 
     (when (or (ir2-component-values-receivers (component-info component))
               (component-dx-lvars component))
       (maybe-mumble "Stack ")
-      ;; STACK only uses dominance information for DX LVAR back
-      ;; propagation (see BACK-PROPAGATE-ONE-DX-LVAR).
-      (when (component-dx-lvars component)
-        (clear-dominators component)
-        (find-dominators component))
-      (stack-analyze component)
+      (with-phase-profile (:stack)
+        ;; STACK only uses dominance information for DX LVAR back
+        ;; propagation (see BACK-PROPAGATE-ONE-DX-LVAR).
+        (when (component-dx-lvars component)
+          (clear-dominators component)
+          (find-dominators component))
+        (stack-analyze component))
       ;; Assign BLOCK-NUMBER for any cleanup blocks introduced by
       ;; stack analysis. There shouldn't be any unreachable code after
       ;; control, so this won't delete anything.
@@ -592,22 +752,27 @@ necessary, since type inference may take arbitrarily long to converge.")
     (unwind-protect
         (progn
           (maybe-mumble "IR2Tran ")
-          (entry-analyze component)
-          (ir2-convert component)
+          (with-phase-profile (:ir2-convert)
+            (entry-analyze component)
+            (ir2-convert component))
 
           (when (policy *lexenv* (>= speed compilation-speed))
             (maybe-mumble "Copy ")
-            (copy-propagate component))
+            (with-phase-profile (:copy-propagate)
+              (copy-propagate component)))
 
-          (ir2-optimize component)
+          (with-phase-profile (:ir2-optimize)
+            (ir2-optimize component))
 
-          (select-representations component)
+          (with-phase-profile (:representation)
+            (select-representations component))
           ;; Try to combine consecutive uses of %INSTANCE-SET.
           ;; This can't be done prior to selecting representations
           ;; because SELECT-REPRESENTATIONS might insert some
           ;; things like MOVE-FROM-DOUBLE which makes the
           ;; "consecutive" vops no longer consecutive.
-          (ir2-optimize-stores component)
+          (with-phase-profile (:ir2-optimize)
+            (ir2-optimize-stores component))
 
           (when *check-consistency*
             (maybe-mumble "Check2 ")
@@ -616,7 +781,8 @@ necessary, since type inference may take arbitrarily long to converge.")
           (delete-unreferenced-tns component)
 
           (maybe-mumble "Life ")
-          (lifetime-analyze component)
+          (with-phase-profile (:lifetime)
+            (lifetime-analyze component))
 
           (when *compile-progress*
             (compiler-mumble "") ; Sync before doing more output.
@@ -627,15 +793,17 @@ necessary, since type inference may take arbitrarily long to converge.")
             (check-life-consistency component))
 
           (maybe-mumble "Pack ")
-          (sb-regalloc:pack component)
+          (with-phase-profile (:pack)
+            (sb-regalloc:pack component))
 
           (when *check-consistency*
             (maybe-mumble "CheckP ")
             (check-pack-consistency component))
 
-          (delete-no-op-vops component)
-          (ir2-optimize-jumps component)
-          (optimize-constant-loads component)
+          (with-phase-profile (:ir2-optimize)
+            (delete-no-op-vops component)
+            (ir2-optimize-jumps component)
+            (optimize-constant-loads component))
           (when *compiler-trace-output*
             (when (memq :ir1 *compile-trace-targets*)
               (describe-component component *compiler-trace-output*))
@@ -648,7 +816,8 @@ necessary, since type inference may take arbitrarily long to converge.")
               (let ((*compiler-trace-output*
                       (and (memq :vop *compile-trace-targets*)
                            *compiler-trace-output*)))
-                (generate-code component))
+                (with-phase-profile (:generate-code)
+                  (generate-code component)))
             (declare (ignorable text-length fun-table))
 
             (let ((bytes (sb-assem:segment-contents-as-vector segment))
@@ -670,15 +839,16 @@ necessary, since type inference may take arbitrarily long to converge.")
                   (sb-disassem:disassemble-assem-segment
                    bytes ranges *compiler-trace-output*)))
 
-              (funcall (etypecase object
-                         (fasl-output (maybe-mumble "FASL") #'fasl-dump-component)
-                         #-sb-xc-host   ; no compiling to core
-                         (core-object (maybe-mumble "Core") #'make-core-component)
-                         (null (lambda (&rest dummies)
-                                 (declare (ignore dummies)))))
-                       component segment (length bytes)
-                       fixup-notes alloc-points
-                       object))))))
+              (with-phase-profile (:dump)
+                (funcall (etypecase object
+                           (fasl-output (maybe-mumble "FASL") #'fasl-dump-component)
+                           #-sb-xc-host   ; no compiling to core
+                           (core-object (maybe-mumble "Core") #'make-core-component)
+                           (null (lambda (&rest dummies)
+                                   (declare (ignore dummies)))))
+                         component segment (length bytes)
+                         fixup-notes alloc-points
+                         object)))))))
 
   ;; We're done, so don't bother keeping anything around.
   (setf (component-info component) :dead)
@@ -720,7 +890,11 @@ necessary, since type inference may take arbitrarily long to converge.")
     (aver (eql (lambda-component lambda) component))
     (aver (eql (node-component (lambda-bind lambda)) component)))
 
-  (let* ((*component-being-compiled* component))
+  (let* ((*component-being-compiled* component)
+         (*phase-profile-entry*
+           (when *phase-profile*
+             (car (push (make-phase-profile-entry (component-name component))
+                        (car *phase-profile*))))))
 
     (when *compile-progress*
       (compiler-mumble "~&")
@@ -741,10 +915,11 @@ necessary, since type inference may take arbitrarily long to converge.")
 
     (when *loop-analyze*
       (dfo-as-needed component)
-      (maybe-mumble "Dom ")
-      (find-dominators component)
-      (maybe-mumble "Loop ")
-      (loop-analyze component))
+      (with-phase-profile (:loop)
+        (maybe-mumble "Dom ")
+        (find-dominators component)
+        (maybe-mumble "Loop ")
+        (loop-analyze component)))
 
     #|
     (when (and *loop-analyze* *compiler-trace-output*)
@@ -761,7 +936,8 @@ necessary, since type inference may take arbitrarily long to converge.")
     |#
 
     (maybe-mumble "Env ")
-    (environment-analyze component)
+    (with-phase-profile (:environment)
+      (environment-analyze component))
     (dfo-as-needed component)
 
     (delete-if-no-entries component)
@@ -1083,6 +1259,11 @@ necessary, since type inference may take arbitrarily long to converge.")
       (unless (eq expansion form)
         (return-from preprocessor-macroexpand-1
           (values expansion t)))))
+  #-sb-xc-host
+  (when (and *fasl-cache-record* (consp form) (symbolp (car form))
+             (eq (info :function :kind (car form)) :macro)
+             (not (lexenv-find (car form) funs)))
+    (note-fasl-cache-dependency :macro (car form)))
   (handler-bind
       ((error (lambda (condition)
                 (compiler-error "(during macroexpansion of ~A)~%~A"
@@ -1979,6 +2160,12 @@ returning its filename.
 
 (defun %compile-files (inputs external-format output-file-p output-file
                        trace-file emit-cfasl)
+  #-sb-xc-host
+  (when (and *fasl-cache-directory* (not *fasl-cache-record*)
+             (not (cdr inputs)) (not trace-file))
+    (return-from %compile-files
+      (compile-file-with-cache (car inputs) external-format
+                               output-file-p output-file emit-cfasl)))
   (let* ((output-file-pathname nil)
          (fasl-output nil)
          (cfasl-pathname nil)
@@ -2007,7 +2194,11 @@ returning its filename.
                 fasl-output (open-fasl-output output-file-pathname
                                               (namestring input-pathname)))
           (when emit-cfasl
-            (setq cfasl-pathname (make-pathname :type "cfasl" :defaults output-file-pathname))
+            ;; COMPILE-FILE-WITH-CACHE passes the pathname to write.
+            (setq cfasl-pathname (if (pathnamep emit-cfasl)
+                                     emit-cfasl
+                                     (make-pathname :type "cfasl"
+                                                    :defaults output-file-pathname)))
             (setq cfasl-output (open-fasl-output cfasl-pathname (namestring input-pathname))))
           (when trace-file
             (setf *compiler-trace-output*
@@ -17,6 +17,12 @@
 ;;; attempt
 (defvar *pack-assign-costs* t)
 (defvar *pack-optimize-saves* t)
+
+;;; If true, the number of offsets SELECT-LOCATION tries in an
+;;; :UNBOUNDED SB before giving up, so that PACK-TN puts the TN past
+;;; the end of the SB instead. PACK sets this for large components.
+(defvar *unbounded-sc-attempts* nil)
+(declaim (type (or null index) *unbounded-sc-attempts*))
 ;;; FIXME: Perhaps SB-FLUID should be renamed to SB-TWEAK and these
 ;;; should be made conditional on SB-TWEAK.
 
@@ -1361,29 +1367,56 @@
 ;;; succeed, and NIL if we fail.
 ;;;
 ;;; For :UNBOUNDED SCs just find the smallest correctly aligned offset
-;;; where the TN doesn't conflict with the TNs that have already been
-;;; packed. For :FINITE SCs try to pack the TN into the most heavily
+;;; not below START where the TN doesn't conflict with the TNs that
+;;; have already been packed. When *UNBOUNDED-SC-ATTEMPTS* limits the
+;;; search, and START isn't given, it instead resumes from where the
+;;; last one left off, wrapping around at the end of the SB, so that
+;;; successive searches sweep the whole SB rather than always retrying
+;;; its start. For :FINITE SCs try to pack the TN into the most heavily
 ;;; used locations first (as estimated in FIND-LOCATION-USAGE).
-(defun select-location (tn sc &key use-reserved-locs)
-  (declare (type tn tn) (type storage-class sc))
+(defun select-location (tn sc &key use-reserved-locs start)
+  (declare (type tn tn) (type storage-class sc) (type (or null index) start))
   (let* ((sb (sc-sb sc))
          (element-size (sc-element-size sc))
          (alignment (sc-alignment sc))
          (align-mask (1- alignment)))
-    (labels ((attempt-location (start-offset)
+    (labels ((align (offset)
+               (logandc2 (+ offset align-mask) align-mask))
+             (attempt-location (start-offset)
                (let ((conflict (conflicts-in-sc tn sc start-offset)))
                  (if conflict
-                     (logandc2 (+ conflict align-mask 1)
-                               align-mask)
+                     (align (1+ conflict))
                      (return-from select-location start-offset))))
              (try (locations)
                (do-sc-locations (location locations nil element-size)
                  (attempt-location location))))
       (if (eq (sb-kind sb) :unbounded)
-          (let ((size (finite-sb-current-size sb)))
-            (loop with offset = 0
-                  until (> (+ offset element-size) size) do
-                  (setf offset (attempt-location offset))))
+          (let ((size (finite-sb-current-size sb))
+                (attempts *unbounded-sc-attempts*))
+            (if (and attempts (not start))
+                (let* ((from (align (finite-sb-last-offset sb)))
+                       (offset from)
+                       (wrapped nil))
+                  (declare (type index from offset))
+                  (loop
+                    (when (and (> (+ offset element-size) size) (not wrapped))
+                      (setf offset 0 wrapped t))
+                    (when (or (> (+ offset element-size) size)
+                              (and wrapped (>= offset from))
+                              (minusp (decf attempts)))
+                      (return))
+                    (let ((conflict (conflicts-in-sc tn sc offset)))
+                      (unless conflict
+                        (setf (finite-sb-last-offset sb) offset)
+                        (return-from select-location offset))
+                      (setf offset (align (1+ conflict)))))
+                  ;; Carry on from here next time.
+                  (setf (finite-sb-last-offset sb) offset)
+                  nil)
+                (loop with offset = (align (or start 0))
+                      until (or (> (+ offset element-size) size)
+                                (and attempts (minusp (decf attempts))))
+                      do (setf offset (attempt-location offset)))))
           (let* ((locations (sc-locations sc))
                  (reserved (sc-reserve-locations sc))
                  (wired (logandc2 (finite-sb-wired-map sb) reserved)))
@@ -1443,9 +1476,14 @@
         (let ((loc (or (find-ok-target-offset original sc)
                        (select-location original sc :use-reserved-locs restricted)
                        (when (unbounded-sc-p sc)
-                         (grow-sc sc)
-                         (or (select-location original sc)
-                             (error "failed to pack after growing SC?"))))))
+                         (let ((size (finite-sb-current-size (sc-sb sc))))
+                           (grow-sc sc)
+                           ;; Nothing is packed past SIZE yet, so when
+                           ;; the search is bounded go straight there.
+                           (or (select-location
+                                original sc
+                                :start (if *unbounded-sc-attempts* size 0))
+                               (error "failed to pack after growing SC?")))))))
           (when loc
             (add-location-conflicts original sc loc)
             (setf (tn-sc tn) sc)
@@ -1576,11 +1614,58 @@
 
 (declaim (ftype function pack-greedy pack-iterative))
 
+;;; Components whose interference graph may have more edges than this
+;;; are packed by PACK-GREEDY whatever *REGISTER-ALLOCATION-METHOD*
+;;; says, and look for stack locations in at most
+;;; *UNBOUNDED-SC-ATTEMPTS* places. PACK-ITERATIVE builds the graph and
+;;; colors it up to *PACK-ITERATIONS* times, and the first-fit search
+;;; for stack locations is linear in the size of the frame, so both
+;;; take time superlinear in the size of the component.
+(defvar *pack-edge-limit* 1000000)
+(declaim (fixnum *pack-edge-limit*)
+         (always-bound *pack-edge-limit*))
+
+(defevent pack-large-component
+  "Packed a component with too large an interference graph greedily.")
+
+;;; Is the interference graph of COMPONENT possibly larger than
+;;; *PACK-EDGE-LIMIT*?  Bound its edges without building it:
+;;; :COMPONENT TNs conflict with every TN, and any two TNs appearing in
+;;; the same IR2 block may conflict.
+(defun interference-graph-too-large-p (component 2comp)
+  (declare (type component component) (type ir2-component 2comp))
+  (let ((limit *pack-edge-limit*)
+        (n-tns 0)
+        (n-component-tns 0)
+        (edges 0))
+    (declare (type index n-tns n-component-tns) (type unsigned-byte edges))
+    (dolist (tns (list (ir2-component-wired-tns 2comp)
+                       (ir2-component-restricted-tns 2comp)
+                       (ir2-component-normal-tns 2comp)))
+      (do ((tn tns (tn-next tn)))
+          ((null tn))
+        (incf n-tns)
+        (when (eq (tn-kind tn) :component)
+          (incf n-component-tns))))
+    (setf edges (* n-component-tns n-tns))
+    (do-ir2-blocks (block component (> edges limit))
+      (let ((n (ir2-block-local-tn-count block)))
+        (declare (type index n))
+        (do ((conflict (ir2-block-global-tns block)
+                       (global-conflicts-next-blockwise conflict)))
+            ((null conflict))
+          (incf n))
+        (incf edges (floor (* n (1- n)) 2))
+        (when (> edges limit)
+          (return t))))))
+
 (defun pack (component)
   (unwind-protect
-       (let ((optimize nil)
-             (speed-3 nil)
-             (2comp (component-info component)))
+       (let* ((optimize nil)
+              (speed-3 nil)
+              (2comp (component-info component))
+              (large (interference-graph-too-large-p component 2comp))
+              (*unbounded-sc-attempts* (when large 16)))
          (init-sb-vectors component)
 
          ;; Determine whether we want to do more expensive packing by
@@ -1589,7 +1674,9 @@
          ;;
          ;; Also, determine if any such block also declares (speed 3),
          ;; in which case :adaptive register allocation will switch to
-         ;; the iterative Chaitin-Briggs spilling/coloring algorithm.
+         ;; the iterative Chaitin-Briggs spilling/coloring algorithm,
+         ;; unless the component is too large for it: see
+         ;; *PACK-EDGE-LIMIT*.
          ;;
          ;; FIXME: This means that a declaration can have a minor
          ;; effect even outside its scope, and as the packing is done
@@ -1616,10 +1703,14 @@
          ;; Actually allocate registers for most TNs. After this, only
          ;; :normal tns may be left unallocated (or TNs :restricted to
          ;; an unbounded SC).
-         (funcall (ecase *register-allocation-method*
-                    (:greedy #'pack-greedy)
-                    (:iterative #'pack-iterative)
-                    (:adaptive (if speed-3 #'pack-iterative #'pack-greedy)))
+         (when large
+           (event pack-large-component))
+         (funcall (if large
+                      #'pack-greedy
+                      (ecase *register-allocation-method*
+                        (:greedy #'pack-greedy)
+                        (:iterative #'pack-iterative)
+                        (:adaptive (if speed-3 #'pack-iterative #'pack-greedy))))
                   component 2comp)
 
          ;; Pack any leftover normal/restricted TN that is not already
@@ -158,6 +158,15 @@ this declaration does not prevent out-of-line function calls, which
 will encounter safepoints unless the target function has also been
 compiled with this declaration in effect.")
 
+#+avx2
+(define-optimization-quality assume-avx2
+    0
+  ("no" "no" "yes" "yes")
+  "When enabled, the compiler may use AVX2 instructions without first
+checking whether the CPU supports them. This is declared in the AVX2
+variant of a function defined with SB-VM::DEFINE-CPU-DISPATCHED-FUNCTION,
+which is only called on a CPU that has AVX2.")
+
 (define-optimization-quality store-closure-debug-pointer
     0
   ("no" "no" "yes" "yes"))
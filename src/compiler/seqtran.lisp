@@ -2267,6 +2267,210 @@
       ;; The type is known exactly, other transforms will take care of it.
       (give-up-ir1-transform)))
 
+;;;; vectors of octets
+
+;;; POSITION, FIND, COUNT, MISMATCH and SEARCH on vectors of BASE-CHAR,
+;;; (UNSIGNED-BYTE 8) or (SIGNED-BYTE 8), and comparison of SIMPLE-BASE-STRINGs,
+;;; can use the octet functions in bit-bash.lisp, which look at many
+;;; elements at once, provided that elements are compared as if by EQL.
+
+;;; Give up unless TEST and KEY, the lvars of those arguments or NIL if not
+;;; supplied, amount to comparing elements with EQL. CHAR= will do for
+;;; strings if ITEM, when given, is known to be a character.
+(defun check-octet-test (test key node chars &optional item)
+  (unless (and (or (not key) (lvar-fun-is key '(identity)))
+               (or (not test)
+                   (lvar-fun-is test '(eq eql equal))
+                   (and chars
+                        (lvar-fun-is test '(char=))
+                        (or (not item)
+                            (csubtypep (lvar-type item)
+                                       (specifier-type 'character))))))
+    (delay-ir1-transform node :optimize)
+    (give-up-ir1-transform "non-trivial :KEY or :TEST")))
+
+(macrolet ((def (element-type octet)
+             (let ((chars (eq element-type 'base-char)))
+               `(progn
+                  (deftransform %find-position ((item sequence from-end start end key test)
+                                                (t (vector ,element-type) t t t t t)
+                                                * :node node)
+                    (check-octet-test test key node ,chars item)
+                    `(with-array-data ((octets sequence :offset-var offset)
+                                       (start start)
+                                       (end end)
+                                       :check-fill-pointer t)
+                       (let* ((octet ,',octet)
+                              (p (and octet
+                                      (%octet-position octet octets from-end start end))))
+                         (if p
+                             (values item (the index (- (truly-the index p) offset)))
+                             (values nil nil)))))
+
+                  (deftransform count ((item sequence &key from-end (start 0) end
+                                             key test test-not)
+                                       (t (vector ,element-type) &rest t)
+                                       * :node node)
+                    (when test-not
+                      (give-up-ir1-transform))
+                    (check-octet-test test key node ,chars item)
+                    `(with-array-data ((octets sequence)
+                                       (start start)
+                                       (end end)
+                                       :check-fill-pointer t)
+                       (let ((octet ,',octet))
+                         (if octet
+                             (%octet-count octet octets start end)
+                             0))))
+
+                  (deftransform mismatch ((sequence1 sequence2 &key from-end
+                                                     test test-not key
+                                                     (start1 0) end1 (start2 0) end2)
+                                          ((vector ,element-type) (vector ,element-type)
+                                           &rest t)
+                                          * :node node)
+                    (when test-not
+                      (give-up-ir1-transform))
+                    (check-octet-test test key node ,chars)
+                    `(with-array-data ((octets1 sequence1 :offset-var offset1)
+                                       (start1 start1)
+                                       (end1 end1)
+                                       :check-fill-pointer t)
+                       (with-array-data ((octets2 sequence2)
+                                         (start2 start2)
+                                         (end2 end2)
+                                         :check-fill-pointer t)
+                         (let* ((length1 (- end1 start1))
+                                (length2 (- end2 start2))
+                                (length (min length1 length2))
+                                (same (if from-end
+                                          (%octet-mismatch-from-end
+                                           octets1 end1 octets2 end2 length)
+                                          (%octet-mismatch
+                                           octets1 start1 octets2 start2 length))))
+                           (unless (and (= same length) (= length1 length2))
+                             (- (if from-end (- end1 same) (+ start1 same))
+                                offset1))))))
+
+                  (deftransform search ((pattern text &key from-end
+                                                 test test-not key
+                                                 (start1 0) end1 (start2 0) end2)
+                                        ((vector ,element-type) (vector ,element-type)
+                                         &rest t)
+                                        * :node node)
+                    (when test-not
+                      (give-up-ir1-transform))
+                    (check-octet-test test key node ,chars)
+                    `(with-array-data ((octets1 pattern)
+                                       (start1 start1)
+                                       (end1 end1)
+                                       :check-fill-pointer t)
+                       (with-array-data ((octets2 text :offset-var offset2)
+                                         (start2 start2)
+                                         (end2 end2)
+                                         :check-fill-pointer t)
+                         (let ((p (%octet-search octets1 start1 end1
+                                                 octets2 start2 end2 from-end)))
+                           (and p (- p offset2))))))))))
+  (def base-char (and (typep item 'base-char) (char-code item)))
+  (def (unsigned-byte 8) (and (typep item '(unsigned-byte 8)) item))
+  (def (signed-byte 8) (and (typep item '(signed-byte 8)) (logand item #xff))))
+
+(deftransform %sp-string-compare ((string1 start1 end1 string2 start2 end2)
+                                  (simple-base-string t t simple-base-string t t))
+  `(with-array-data ((string1 string1) (start1 start1) (end1 end1)
+                     :check-fill-pointer t)
+     (with-array-data ((string2 string2) (start2 start2) (end2 end2)
+                       :check-fill-pointer t)
+       (%octet-string-compare string1 start1 end1 string2 start2 end2))))
+
+(deftransform string=* ((string1 string2 start1 end1 start2 end2)
+                        (simple-base-string simple-base-string t t t t))
+  `(with-array-data ((string1 string1) (start1 start1) (end1 end1)
+                     :check-fill-pointer t)
+     (with-array-data ((string2 string2) (start2 start2) (end2 end2)
+                       :check-fill-pointer t)
+       (let ((length (- end1 start1)))
+         (and (= length (- end2 start2))
+              (= (%octet-mismatch string1 start1 string2 start2 length)
+                 length))))))
+
+;;;; element-wise arithmetic and sums on vectors of numbers
+
+;;; MAP-INTO of a float arithmetic operator over two vectors of floats,
+;;; or of a bitwise operator over two vectors of integers, of the same
+;;; specialized type as the result, does all but the last few elements
+;;; with VECTOR-MAP-BLOCKS and those with the scalar operator. Each
+;;; element is computed just as the scalar loop would, which is why
+;;; integer + and - are not done this way: they must signal an error
+;;; when the sum does not fit.
+#+x86-64
+(macrolet ((def (element-type size ops)
+             `(deftransform map-into ((result fun vector1 vector2)
+                                      ((simple-array ,element-type (*)) t
+                                       (simple-array ,element-type (*))
+                                       (simple-array ,element-type (*)))
+                                      * :policy (>= speed space))
+                (let* ((ops ',ops)
+                       (name (or (lvar-fun-is fun (mapcar #'car ops))
+                                 (give-up-ir1-transform)))
+                       (op (cdr (assoc name ops))))
+                  `(let* ((length (min (length result)
+                                       (length vector1)
+                                       (length vector2)))
+                          (nbytes (logandc2 (* length ,',size) 31)))
+                     (sb-vm::vector-map-blocks ,op result vector1 vector2 nbytes)
+                     (loop for i of-type index from (truncate nbytes ,',size)
+                           below length
+                           do (setf (aref result i)
+                                    (,name (aref vector1 i) (aref vector2 i))))
+                     result)))))
+  (def double-float 8
+    ((+ . :add-double) (- . :sub-double) (* . :mul-double) (/ . :div-double)))
+  (def single-float 4
+    ((+ . :add-single) (- . :sub-single) (* . :mul-single) (/ . :div-single)))
+  (def fixnum 8 ((logand . :and) (logior . :or) (logxor . :xor)))
+  (def (unsigned-byte 8) 1 ((logand . :and) (logior . :or) (logxor . :xor)))
+  (def (unsigned-byte 16) 2 ((logand . :and) (logior . :or) (logxor . :xor)))
+  (def (unsigned-byte 32) 4 ((logand . :and) (logior . :or) (logxor . :xor)))
+  (def (unsigned-byte 64) 8 ((logand . :and) (logior . :or) (logxor . :xor)))
+  (def (signed-byte 8) 1 ((logand . :and) (logior . :or) (logxor . :xor)))
+  (def (signed-byte 16) 2 ((logand . :and) (logior . :or) (logxor . :xor)))
+  (def (signed-byte 32) 4 ((logand . :and) (logior . :or) (logxor . :xor)))
+  (def (signed-byte 64) 8 ((logand . :and) (logior . :or) (logxor . :xor))))
+
+;;; REDUCE of + over a vector of (UNSIGNED-BYTE 8) or (UNSIGNED-BYTE 32)
+;;; adds up the elements in a word, many at a time on x86-64. Integer
+;;; addition being associative, the order does not matter. Sums of
+;;; floats are left alone, since adding in a different order could give
+;;; a different result: so is a sum starting from an :INITIAL-VALUE not
+;;; known to be an integer, since (+ 1.0 (+ 1 1)) need not be
+;;; (+ (+ 1.0 1) 1).
+(macrolet ((def (element-type sum)
+             `(deftransform reduce ((fun vector &key key from-end (start 0) end
+                                         initial-value)
+                                    (t (vector ,element-type) &rest t)
+                                    * :node node)
+                (unless (and (lvar-fun-is fun '(+))
+                             (or (not key) (lvar-fun-is key '(identity))))
+                  (delay-ir1-transform node :optimize)
+                  (give-up-ir1-transform "not a sum of the elements"))
+                (when (and initial-value
+                           (not (csubtypep (lvar-type initial-value)
+                                           (specifier-type 'integer))))
+                  (give-up-ir1-transform "initial value not known to be an integer"))
+                `(with-array-data ((data vector)
+                                   (start start)
+                                   (end end)
+                                   :check-fill-pointer t)
+                   ,(if initial-value
+                        `(if (= start end)
+                             initial-value
+                             (+ initial-value (,',sum data start end)))
+                        `(,',sum data start end))))))
+  (def (unsigned-byte 8) %ub8-vector-sum)
+  (def (unsigned-byte 32) %ub32-vector-sum))
+
 ;;; logic to unravel :TEST, :TEST-NOT, and :KEY options in FIND,
 ;;; POSITION-IF, etc.
 (define-source-transform effective-find-position-test (test test-not)
@@ -4823,15 +4823,29 @@
              (give-up-ir1-transform))))))
 
 (define-source-transform sb-impl::sort-vector (vector start end predicate key)
-  ;; Like CMU CL, we use HEAPSORT. However, other than that, this code
-  ;; isn't really related to the CMU CL code, since instead of trying
-  ;; to generalize the CMU CL code to allow START and END values, this
-  ;; code has been written from scratch following Chapter 7 of
-  ;; _Introduction to Algorithms_ by Corman, Rivest, and Shamir.
+  ;; This is pattern-defeating quicksort, as described by Orson Peters in
+  ;; "Pattern-defeating Quicksort" (2021): quicksort with the median of 3, or
+  ;; of 9 for large ranges, as pivot, and insertion sort for small ranges.
+  ;; A range whose partitioning moved nothing is checked for being sorted
+  ;; already. A partition which is very unbalanced gets some elements
+  ;; swapped around to break up the pattern that caused it, and once that
+  ;; has happened log2(N) times, the range is heapsorted instead, which
+  ;; bounds the time at O(N log N). A range whose pivot is equal to the
+  ;; element before it is split into the elements equal to the pivot, which
+  ;; are done, and the rest, so few distinct keys take linear time.
+  ;;
+  ;; Each scan is bounded by the ends of the range, which is not needed
+  ;; for a consistent predicate but keeps an inconsistent one within the
+  ;; vector.
+  ;;
+  ;; The HEAPSORT follows Chapter 7 of _Introduction to Algorithms_ by
+  ;; Corman, Rivest, and Shamir, and was once all that SORT did, as in CMU CL.
   `(macrolet ((%index (x) `(truly-the index ,x))
               (%parent (i) `(ash ,i -1))
               (%left (i) `(%index (ash ,i 1)))
               (%right (i) `(%index (1+ (ash ,i 1))))
+              (%ref (i)
+                `(aref ,',vector (%index ,i)))
               (%elt (i)
                 `(aref ,',vector
                        (%index (+ (%index ,i) start-1))))
@@ -4864,23 +4878,169 @@
                                         (%elt largest) i-elt
                                         i largest)))))))))
               (%sort-vector (keyfun)
-                `(let ( ;; Heaps prefer 1-based addressing.
-                       (start-1 (1- ,',start))
-                       (current-heap-size (- ,',end ,',start))
-                       (keyfun ,keyfun))
-                   (declare (type (integer -1 #.(1- most-positive-fixnum))
-                                  start-1))
-                   (declare (type index current-heap-size))
+                `(let ((keyfun ,keyfun))
                    (declare (type function keyfun))
-                   (loop for i of-type index
-                         from (ash current-heap-size -1) downto 1 do
-                         (%heapify i))
-                   (loop
-                    (when (< current-heap-size 2)
-                      (return))
-                    (rotatef (%elt 1) (%elt current-heap-size))
-                    (decf current-heap-size)
-                    (%heapify 1)))))
+                   (labels ((less (a b)
+                              (funcall ,',predicate (funcall keyfun a) (funcall keyfun b)))
+                            (sort2 (i j)
+                              (when (less (%ref j) (%ref i))
+                                (rotatef (%ref i) (%ref j))))
+                            (sort3 (i j k)
+                              (sort2 i j)
+                              (sort2 j k)
+                              (sort2 i j))
+                            (heapsort (lo hi)
+                              (let ( ;; Heaps prefer 1-based addressing.
+                                    (start-1 (1- lo))
+                                    (current-heap-size (- hi lo)))
+                                (declare (type (integer -1 #.(1- most-positive-fixnum))
+                                               start-1))
+                                (declare (type index current-heap-size))
+                                (loop for i of-type index
+                                      from (ash current-heap-size -1) downto 1 do
+                                      (%heapify i))
+                                (loop
+                                 (when (< current-heap-size 2)
+                                   (return))
+                                 (rotatef (%elt 1) (%elt current-heap-size))
+                                 (decf current-heap-size)
+                                 (%heapify 1))))
+                            ;; Insertion sort of [LO,HI). If LIMIT is given, give up
+                            ;; and return NIL once more than that many elements moved.
+                            (insertion-sort (lo hi limit)
+                              (declare (type index lo hi) (type (or null index) limit))
+                              (let ((moved 0))
+                                (declare (type index moved))
+                                (loop for i of-type index from (1+ lo) below hi
+                                      do (let ((x (%ref i))
+                                               (j i))
+                                           (declare (type index j))
+                                           (loop while (and (> j lo) (less x (%ref (1- j))))
+                                                 do (setf (%ref j) (%ref (1- j)))
+                                                    (decf j))
+                                           (setf (%ref j) x)
+                                           (when (and limit (> (incf moved (- i j)) limit))
+                                             (return-from insertion-sort nil))))
+                                t))
+                            ;; Partition [LO,HI) around the element at LO into the
+                            ;; elements less than it and those not less. Return the
+                            ;; final index of the pivot, and whether nothing moved.
+                            (partition-right (lo hi)
+                              (declare (type index lo hi))
+                              (let ((pivot (%ref lo))
+                                    (first (1+ lo))
+                                    (last hi))
+                                (declare (type index first last))
+                                (loop while (and (< first hi) (less (%ref first) pivot))
+                                      do (incf first))
+                                (if (= first (1+ lo))
+                                    (loop while (and (< first last)
+                                                     (not (less (%ref (decf last)) pivot))))
+                                    (loop while (and (> last lo)
+                                                     (not (less (%ref (decf last)) pivot)))))
+                                (let ((already-partitioned (>= first last)))
+                                  (loop while (< first last)
+                                        do (rotatef (%ref first) (%ref last))
+                                           (loop while (and (< (incf first) hi)
+                                                            (less (%ref first) pivot)))
+                                           (loop while (and (> last lo)
+                                                            (not (less (%ref (decf last))
+                                                                       pivot))))))
+                                  (let ((pivot-pos (1- first)))
+                                    (setf (%ref lo) (%ref pivot-pos)
+                                          (%ref pivot-pos) pivot)
+                                    (values pivot-pos already-partitioned)))))
+                            ;; Partition [LO,HI) around the element at LO, which is
+                            ;; not less than any, into the elements equal to it and
+                            ;; those greater. Return the final index of the pivot.
+                            (partition-left (lo hi)
+                              (declare (type index lo hi))
+                              (let ((pivot (%ref lo))
+                                    (first lo)
+                                    (last hi))
+                                (declare (type index first last))
+                                (loop while (and (> last lo) (less pivot (%ref (decf last)))))
+                                (if (= (1+ last) hi)
+                                    (loop while (and (< first last)
+                                                     (not (less pivot (%ref (incf first)))))))
+                                    (loop while (and (< (1+ first) hi)
+                                                     (not (less pivot (%ref (incf first))))))))
+                                (loop while (< first last)
+                                      do (rotatef (%ref first) (%ref last))
+                                         (loop while (and (> last lo)
+                                                          (less pivot (%ref (decf last)))))
+                                         (loop while (and (< (1+ first) hi)
+                                                          (not (less pivot
+                                                                     (%ref (incf first)))))))
+                                (setf (%ref lo) (%ref last)
+                                      (%ref last) pivot)
+                                last))
+                            (pdqsort (lo hi bad-allowed leftmost)
+                              (declare (type index lo hi) (type fixnum bad-allowed))
+                              (loop
+                               (let ((size (- hi lo)))
+                                 (declare (type index size))
+                                 (when (< size 24)
+                                   (insertion-sort lo hi nil)
+                                   (return))
+                                 (let ((half (ash size -1)))
+                                   (cond ((> size 128)
+                                          (sort3 lo (+ lo half) (- hi 1))
+                                          (sort3 (+ lo 1) (+ lo half -1) (- hi 2))
+                                          (sort3 (+ lo 2) (+ lo half 1) (- hi 3))
+                                          (sort3 (+ lo half -1) (+ lo half) (+ lo half 1))
+                                          (rotatef (%ref lo) (%ref (+ lo half))))
+                                         (t
+                                          (sort3 (+ lo half) lo (- hi 1)))))
+                                 (if (and (not leftmost) (not (less (%ref (1- lo)) (%ref lo))))
+                                     (setq lo (1+ (partition-left lo hi)))
+                                     (multiple-value-bind (pivot-pos already-partitioned)
+                                         (partition-right lo hi)
+                                       (declare (type index pivot-pos))
+                                       (let ((left (- pivot-pos lo))
+                                             (right (- hi pivot-pos 1)))
+                                         (declare (type index left right))
+                                         (cond ((or (< left (ash size -3))
+                                                    (< right (ash size -3)))
+                                                (when (<= (decf bad-allowed) 0)
+                                                  (heapsort lo hi)
+                                                  (return))
+                                                (when (>= left 24)
+                                                  (let ((q (ash left -2)))
+                                                    (rotatef (%ref lo) (%ref (+ lo q)))
+                                                    (rotatef (%ref (- pivot-pos 1))
+                                                             (%ref (- pivot-pos q)))
+                                                    (when (> left 128)
+                                                      (rotatef (%ref (+ lo 1)) (%ref (+ lo q 1)))
+                                                      (rotatef (%ref (+ lo 2)) (%ref (+ lo q 2)))
+                                                      (rotatef (%ref (- pivot-pos 2))
+                                                               (%ref (- pivot-pos q 1)))
+                                                      (rotatef (%ref (- pivot-pos 3))
+                                                               (%ref (- pivot-pos q 2))))))
+                                                (when (>= right 24)
+                                                  (let ((q (ash right -2)))
+                                                    (rotatef (%ref (+ pivot-pos 1))
+                                                             (%ref (+ pivot-pos q 1)))
+                                                    (rotatef (%ref (- hi 1)) (%ref (- hi q)))
+                                                    (when (> right 128)
+                                                      (rotatef (%ref (+ pivot-pos 2))
+                                                               (%ref (+ pivot-pos q 2)))
+                                                      (rotatef (%ref (+ pivot-pos 3))
+                                                               (%ref (+ pivot-pos q 3)))
+                                                      (rotatef (%ref (- hi 2)) (%ref (- hi q 1)))
+                                                      (rotatef (%ref (- hi 3))
+                                                               (%ref (- hi q 2)))))))
+                                               ((and already-partitioned
+                                                     (insertion-sort lo pivot-pos 8)
+                                                     (insertion-sort (1+ pivot-pos) hi 8))
+                                                (return)))
+                                         (pdqsort lo pivot-pos bad-allowed leftmost)
+                                         (setq lo (1+ pivot-pos) leftmost nil))))))))
+                     (let ((start ,',start)
+                           (end ,',end))
+                       (declare (type index start end))
+                       (when (> (- end start) 1)
+                         (pdqsort start end (integer-length (- end start)) t)))))))
      (declare (optimize (insert-array-bounds-checks 0) speed))
      (if (typep ,vector 'simple-vector)
          ;; (VECTOR T) is worth optimizing for, and SIMPLE-VECTOR is
@@ -827,9 +827,8 @@
 (defstruct (finite-sb (:copier nil) (:predicate nil) (:conc-name fsb-))
   ;; the number of locations currently allocated in this SB
   (current-size 0 :type index)
-  ;; the last location packed in, used by pack to scatter TNs to
-  ;; prevent a few locations from getting all the TNs, and thus
-  ;; getting overcrowded, reducing the possibilities for targeting.
+  ;; In an :UNBOUNDED SB, where the next search for a location limited
+  ;; by *UNBOUNDED-SC-ATTEMPTS* starts (see SELECT-LOCATION).
   (last-offset 0 :type index)
   ;; a vector containing, for each location in this SB, a vector
   ;; indexed by IR2 block numbers, holding local conflict bit vectors.
@@ -1064,3 +1064,357 @@
               array index (ash 1 (- word-shift n-fixnum-tag-bits)))
           diff)
     (move result diff)))
+
+;;;; comparing octets 32 at a time
+
+;;; These support the octet searching functions in bit-bash.lisp. Each
+;;; examines the 32 octets of a SIMPLE-OCTET-VECTOR starting at INDEX, which
+;;; the caller ensures are all within the vector, and returns a mask with
+;;; bit I set if octet INDEX+I compares equal. AVX2 is used when the CPU
+;;; has it, otherwise two SSE2 compares.
+;;; VZEROUPPER clobbers the upper half of every YMM register, so these
+;;; must not be used where SIMD-PACK-256 values are live.
+(defmacro octet-block-ea (vector index &optional (disp 0))
+  `(ea (+ (- (* vector-data-offset n-word-bytes) other-pointer-lowtag) ,disp)
+       ,vector ,index))
+
+(define-vop (octet-match-mask)
+  (:translate octet-match-mask)
+  (:policy :fast-safe)
+  (:args (vector :scs (descriptor-reg))
+         (index :scs (unsigned-reg))
+         (octet :scs (unsigned-reg)))
+  (:arg-types * unsigned-num unsigned-num)
+  (:temporary (:sc unsigned-reg) temp)
+  (:temporary (:sc int-sse-reg) pattern data)
+  #+(and avx2 sb-simd-pack-256) (:temporary (:sc ymm-reg) wide)
+  (:results (res :scs (unsigned-reg)))
+  (:result-types unsigned-num)
+  (:node-var node)
+  (:generator 12
+    (inst mov temp #x0101010101010101)
+    (inst imul temp octet)
+    (inst movq pattern temp)
+    (flet ((sse2 ()
+             (inst punpcklqdq pattern pattern)
+             (inst movdqu data (octet-block-ea vector index))
+             (inst pcmpeqb data pattern)
+             (inst pmovmskb temp data)
+             (inst movdqu data (octet-block-ea vector index 16))
+             (inst pcmpeqb data pattern)
+             (inst pmovmskb res data)
+             (inst shl res 16)
+             (inst or res temp)))
+      #-(and avx2 sb-simd-pack-256) (sse2)
+      #+(and avx2 sb-simd-pack-256)
+      (if-avx2 node
+               (progn (inst vpbroadcastb wide pattern)
+                      (inst vpcmpeqb wide wide (octet-block-ea vector index))
+                      (inst vpmovmskb res wide)
+                      (inst vzeroupper))
+               (sse2)))))
+
+(define-vop (octet-compare-mask)
+  (:translate octet-compare-mask)
+  (:policy :fast-safe)
+  (:args (vector1 :scs (descriptor-reg))
+         (index1 :scs (unsigned-reg))
+         (vector2 :scs (descriptor-reg))
+         (index2 :scs (unsigned-reg)))
+  (:arg-types * unsigned-num * unsigned-num)
+  (:temporary (:sc unsigned-reg) temp)
+  (:temporary (:sc int-sse-reg) data1 data2)
+  #+(and avx2 sb-simd-pack-256) (:temporary (:sc ymm-reg) wide)
+  (:results (res :scs (unsigned-reg)))
+  (:result-types unsigned-num)
+  (:node-var node)
+  (:generator 12
+    (flet ((sse2 ()
+             (inst movdqu data1 (octet-block-ea vector1 index1))
+             (inst movdqu data2 (octet-block-ea vector2 index2))
+             (inst pcmpeqb data1 data2)
+             (inst pmovmskb temp data1)
+             (inst movdqu data1 (octet-block-ea vector1 index1 16))
+             (inst movdqu data2 (octet-block-ea vector2 index2 16))
+             (inst pcmpeqb data1 data2)
+             (inst pmovmskb res data1)
+             (inst shl res 16)
+             (inst or res temp)))
+      #-(and avx2 sb-simd-pack-256) (sse2)
+      #+(and avx2 sb-simd-pack-256)
+      (if-avx2 node
+               (progn (inst vmovdqu wide (octet-block-ea vector1 index1))
+                      (inst vpcmpeqb wide wide (octet-block-ea vector2 index2))
+                      (inst vpmovmskb res wide)
+                      (inst vzeroupper))
+               (sse2)))))
+
+;;;; filling and copying words with vector stores
+
+;;; FILL-WORDS stores VALUE into COUNT words of the data of VECTOR from
+;;; word START. COPY-WORDS copies COUNT words in ascending order, so it
+;;; may be used on overlapping words of the same vector only when moving
+;;; them toward lower addresses. Fewer than 16 words are done one at a
+;;; time, and more in blocks of 64 bytes using SSE2 or, if the CPU has it,
+;;; AVX2. Filling more than NON-TEMPORAL-FILL-WORDS uses non-temporal
+;;; stores, because writing that much would only evict everything else
+;;; from the cache. Copies that large go to memmove(), which knows best.
+(defconstant non-temporal-fill-words (/ (* 4 1024 1024) n-word-bytes))
+
+(defmacro word-block-ea (vector index)
+  `(ea (- (* vector-data-offset n-word-bytes) other-pointer-lowtag)
+       ,vector ,index n-word-bytes))
+
+(define-vop (fill-words)
+  (:translate fill-words)
+  (:policy :fast-safe)
+  (:args (vector :scs (descriptor-reg))
+         (start :scs (unsigned-reg))
+         (count :scs (unsigned-reg))
+         (value :scs (unsigned-reg)))
+  (:arg-types * unsigned-num unsigned-num unsigned-num)
+  (:temporary (:sc unsigned-reg) ptr end limit)
+  (:temporary (:sc int-sse-reg) pattern)
+  #+(and avx2 sb-simd-pack-256) (:temporary (:sc ymm-reg) wide)
+  (:node-var node)
+  (:generator 30
+    (let ((aligned (gen-label))
+          (non-temporal (gen-label))
+          (tail (gen-label))
+          (tail-loop (gen-label))
+          (done (gen-label)))
+      (inst lea ptr (word-block-ea vector start))
+      (inst lea end (ea ptr count n-word-bytes))
+      (inst cmp count 16)
+      (inst jmp :b tail)
+      ;; Vector data are 16-byte-aligned, so one word aligns PTR if need be,
+      ;; after which at least 64 bytes remain.
+      (inst test :byte ptr n-word-bytes)
+      (inst jmp :z aligned)
+      (inst mov (ea ptr) value)
+      (inst add ptr n-word-bytes)
+      (emit-label aligned)
+      (inst lea limit (ea -64 end))
+      (inst movq pattern value)
+      (inst punpcklqdq pattern pattern)
+      (inst cmp count non-temporal-fill-words)
+      (inst jmp :ae non-temporal)
+      (flet ((sse2 ()
+               (let ((loop (gen-label)))
+                 (emit-label loop)
+                 (dotimes (i 4)
+                   (inst movdqa (ea (* i 16) ptr) pattern))
+                 (inst add ptr 64)
+                 (inst cmp ptr limit)
+                 (inst jmp :be loop))))
+        #-(and avx2 sb-simd-pack-256) (sse2)
+        #+(and avx2 sb-simd-pack-256)
+        (if-avx2 node
+                 (let ((loop (gen-label)))
+                   (inst vpbroadcastq wide pattern)
+                   (emit-label loop)
+                   (inst vmovdqu (ea ptr) wide)
+                   (inst vmovdqu (ea 32 ptr) wide)
+                   (inst add ptr 64)
+                   (inst cmp ptr limit)
+                   (inst jmp :be loop)
+                   (inst vzeroupper))
+                 (sse2)))
+      (inst jmp tail)
+      (emit-label non-temporal)
+      (let ((loop (gen-label)))
+        (emit-label loop)
+        (dotimes (i 4)
+          (inst movntdq (ea (* i 16) ptr) pattern))
+        (inst add ptr 64)
+        (inst cmp ptr limit)
+        (inst jmp :be loop)
+        (inst sfence))
+      (emit-label tail)
+      (inst cmp ptr end)
+      (inst jmp :ae done)
+      (emit-label tail-loop)
+      (inst mov (ea ptr) value)
+      (inst add ptr n-word-bytes)
+      (inst cmp ptr end)
+      (inst jmp :b tail-loop)
+      (emit-label done))))
+
+(define-vop (copy-words)
+  (:translate copy-words)
+  (:policy :fast-safe)
+  (:args (src :scs (descriptor-reg))
+         (src-start :scs (unsigned-reg))
+         (dst :scs (descriptor-reg))
+         (dst-start :scs (unsigned-reg))
+         (count :scs (unsigned-reg)))
+  (:arg-types * unsigned-num * unsigned-num unsigned-num)
+  (:temporary (:sc unsigned-reg) from to end limit)
+  (:temporary (:sc int-sse-reg) data1 data2 data3 data4)
+  #+(and avx2 sb-simd-pack-256) (:temporary (:sc ymm-reg) wide1 wide2)
+  (:node-var node)
+  (:generator 30
+    (let ((tail (gen-label))
+          (tail-loop (gen-label))
+          (done (gen-label)))
+      (inst lea from (word-block-ea src src-start))
+      (inst lea to (word-block-ea dst dst-start))
+      (inst lea end (ea to count n-word-bytes))
+      (inst cmp count 16)
+      (inst jmp :b tail)
+      (inst lea limit (ea -64 end))
+      ;; Each block is loaded entirely before any of it is stored.
+      (flet ((sse2 ()
+               (let ((loop (gen-label))
+                     (data (list data1 data2 data3 data4)))
+                 (emit-label loop)
+                 (loop for reg in data for disp from 0 by 16
+                       do (inst movdqu reg (ea disp from)))
+                 (loop for reg in data for disp from 0 by 16
+                       do (inst movdqu (ea disp to) reg))
+                 (inst add from 64)
+                 (inst add to 64)
+                 (inst cmp to limit)
+                 (inst jmp :be loop))))
+        #-(and avx2 sb-simd-pack-256) (sse2)
+        #+(and avx2 sb-simd-pack-256)
+        (if-avx2 node
+                 (let ((loop (gen-label)))
+                   (emit-label loop)
+                   (inst vmovdqu wide1 (ea from))
+                   (inst vmovdqu wide2 (ea 32 from))
+                   (inst vmovdqu (ea to) wide1)
+                   (inst vmovdqu (ea 32 to) wide2)
+                   (inst add from 64)
+                   (inst add to 64)
+                   (inst cmp to limit)
+                   (inst jmp :be loop)
+                   (inst vzeroupper))
+                 (sse2)))
+      (emit-label tail)
+      (inst cmp to end)
+      (inst jmp :ae done)
+      (emit-label tail-loop)
+      (inst mov limit (ea from))
+      (inst mov (ea to) limit)
+      (inst add from n-word-bytes)
+      (inst add to n-word-bytes)
+      (inst cmp to end)
+      (inst jmp :b tail-loop)
+      (emit-label done))))
+
+;;;; element-wise arithmetic and sums on vectors of numbers
+
+;;; VECTOR-MAP-BLOCKS stores into the first NBYTES bytes of the data of
+;;; RESULT the OP of the bytes at the same place in VECTOR1 and VECTOR2,
+;;; taken as packed floats or integers, 32 bytes at a time. NBYTES must be
+;;; a multiple of 32. Each element is computed exactly as the scalar
+;;; operation would, so this is only used for operations for which the
+;;; packed instruction gives the same result: the float arithmetic
+;;; operators, and the bitwise operators on any kind of integer, including
+;;; fixnums, whose tag bits they leave at zero.
+(defun vector-map-block-insts (op)
+  (ecase op
+    (:add-double '(addpd vaddpd))
+    (:sub-double '(subpd vsubpd))
+    (:mul-double '(mulpd vmulpd))
+    (:div-double '(divpd vdivpd))
+    (:add-single '(addps vaddps))
+    (:sub-single '(subps vsubps))
+    (:mul-single '(mulps vmulps))
+    (:div-single '(divps vdivps))
+    (:and '(pand vpand))
+    (:or '(por vpor))
+    (:xor '(pxor vpxor))))
+
+(define-vop (vector-map-blocks)
+  (:translate vector-map-blocks)
+  (:policy :fast-safe)
+  (:info op)
+  (:args (result :scs (descriptor-reg))
+         (vector1 :scs (descriptor-reg))
+         (vector2 :scs (descriptor-reg))
+         (nbytes :scs (unsigned-reg)))
+  (:arg-types (:constant symbol) * * * unsigned-num)
+  (:temporary (:sc unsigned-reg) i)
+  (:temporary (:sc int-sse-reg) data1 data2)
+  #+(and avx2 sb-simd-pack-256) (:temporary (:sc ymm-reg) wide)
+  (:node-var node)
+  (:generator 20
+    (destructuring-bind (sse avx) (vector-map-block-insts op)
+      (declare (ignorable avx))
+      (flet ((block-loop (body)
+               (let ((loop (gen-label))
+                     (test (gen-label)))
+                 (zeroize i)
+                 (inst jmp test)
+                 (emit-label loop)
+                 (funcall body)
+                 (inst add i 32)
+                 (emit-label test)
+                 (inst cmp i nbytes)
+                 (inst jmp :b loop))))
+        (flet ((sse2 ()
+                 (block-loop
+                  (lambda ()
+                    (dolist (disp '(0 16))
+                      (inst movdqu data1 (octet-block-ea vector1 i disp))
+                      (inst movdqu data2 (octet-block-ea vector2 i disp))
+                      (inst* sse data1 data2)
+                      (inst movdqu (octet-block-ea result i disp) data1))))))
+          #-(and avx2 sb-simd-pack-256) (sse2)
+          #+(and avx2 sb-simd-pack-256)
+          (if-avx2 node
+                   (progn
+                     (block-loop
+                      (lambda ()
+                        (inst vmovdqu wide (octet-block-ea vector1 i))
+                        (inst* avx wide wide (octet-block-ea vector2 i))
+                        (inst vmovdqu (octet-block-ea result i) wide)))
+                     (inst vzeroupper))
+                   (sse2)))))))
+
+;;; SUM-BLOCKS returns the sum of the elements, of WIDTH 8 or 32 bits, in
+;;; the NBYTES bytes of VECTOR from byte START. NBYTES must be a multiple
+;;; of 32, and the caller must ensure that the sum fits in a word. Each
+;;; PSADBW adds up 8 octets; 32-bit elements are widened to 64 bits.
+(define-vop (sum-blocks)
+  (:translate sum-blocks)
+  (:policy :fast-safe)
+  (:info width)
+  (:args (vector :scs (descriptor-reg))
+         (start :scs (unsigned-reg))
+         (nbytes :scs (unsigned-reg)))
+  (:arg-types (:constant (member 8 32)) * unsigned-num unsigned-num)
+  (:temporary (:sc unsigned-reg) ptr end)
+  (:temporary (:sc int-sse-reg) zero sum data high)
+  (:results (res :scs (unsigned-reg)))
+  (:result-types unsigned-num)
+  (:generator 20
+    (let ((loop (gen-label))
+          (test (gen-label)))
+      (inst pxor zero zero)
+      (inst pxor sum sum)
+      (inst lea ptr (octet-block-ea vector start))
+      (inst lea end (ea ptr nbytes))
+      (inst jmp test)
+      (emit-label loop)
+      (dolist (disp '(0 16))
+        (inst movdqu data (ea disp ptr))
+        (ecase width
+          (8
+           (inst psadbw data zero)
+           (inst paddq sum data))
+          (32
+           (inst movdqa high data)
+           (inst punpckldq data zero)
+           (inst punpckhdq high zero)
+           (inst paddq sum data)
+           (inst paddq sum high))))
+      (inst add ptr 32)
+      (emit-label test)
+      (inst cmp ptr end)
+      (inst jmp :b loop)
+      (inst pshufd data sum #b1110)
+      (inst paddq sum data)
+      (inst movq res sum))))
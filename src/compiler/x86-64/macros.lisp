@@ -179,6 +179,27 @@
                         values)
       start-lab)))
 
+;;;; CPU feature dispatch
+
+;;; Emit the code generated by AVX2, or if the policy of NODE does not
+;;; promise that the CPU has AVX2, a test of *CPU-FEATURE-BITS* choosing
+;;; between AVX2 and FALLBACK. The promise is made in the AVX2 variant of
+;;; a function defined by DEFINE-CPU-DISPATCHED-FUNCTION.
+#+avx2
+(defmacro if-avx2 (node avx2 fallback)
+  (with-unique-names (no-avx2 done)
+    `(if (policy ,node (> sb-c::assume-avx2 1))
+         ,avx2
+         (let ((,no-avx2 (gen-label))
+               (,done (gen-label)))
+           (test-cpu-feature cpu-has-ymm-registers)
+           (inst jmp :z ,no-avx2)
+           ,avx2
+           (inst jmp ,done)
+           (emit-label ,no-avx2)
+           ,fallback
+           (emit-label ,done)))))
+
 
 ;;;; PSEUDO-ATOMIC
 
@@ -155,7 +155,9 @@
 ;;;     Note these spaces grow from low to high addresses.
 (defvar *binding-stack-pointer*)
 
-;;; Bit indices into *CPU-FEATURE-BITS*
+;;; Bit indices into *CPU-FEATURE-BITS*, which the runtime sets to a fixnum
+;;; on startup and to 0 when saving a core.
+(defvar *cpu-feature-bits*)
 (defconstant cpu-has-ymm-registers   0)
 (defconstant cpu-has-popcnt          1)
 
@@ -256,6 +256,30 @@
   (:generator 1
     (move res ptr)
     (inst and res (lognot fixnum-tag-mask))))
+
+;;; Compare the 16 control bytes of a flat hash-table at INDEX with BYTE,
+;;; returning a bit mask of the ones which are equal.
+(define-vop (hash-control-match)
+  (:translate sb-impl::%hash-control-match)
+  (:policy :fast-safe)
+  (:args (control :scs (descriptor-reg))
+         (index :scs (unsigned-reg))
+         (byte :scs (unsigned-reg)))
+  (:arg-types simple-array-unsigned-byte-8 unsigned-num unsigned-num)
+  (:temporary (:sc unsigned-reg) temp)
+  (:temporary (:sc int-sse-reg) group pattern)
+  (:results (res :scs (unsigned-reg)))
+  (:result-types unsigned-num)
+  (:generator 6
+    ;; Broadcast BYTE to all 16 lanes using only SSE2.
+    (inst mov temp #x0101010101010101)
+    (inst imul temp byte)
+    (inst movq pattern temp)
+    (inst punpcklqdq pattern pattern)
+    (inst movdqu group (ea (- (* vector-data-offset n-word-bytes) other-pointer-lowtag)
+                           control index))
+    (inst pcmpeqb group pattern)
+    (inst pmovmskb res group)))
 
 ;;;; allocation
 
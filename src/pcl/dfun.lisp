@@ -1715,6 +1715,8 @@ Except see also BREAK-VICIOUS-METACIRCLE.  -- CSR, 2003-05-28
                              (or dfun (make-initial-dfun generic-function))
                              (compute-discriminating-function generic-function))))
                (set-funcallable-instance-function generic-function dfun)
+               (when (eq **boot-state** 'complete)
+                 (flush-gf-call-site-caches generic-function))
                dfun)))
       ;; This needs to be atomic per generic function, consider:
       ;;   1. T1 sets dfun-state to S1 and computes discr. fun using S1
@@ -1743,6 +1745,94 @@ Except see also BREAK-VICIOUS-METACIRCLE.  -- CSR, 2003-05-28
             ;; still enabled...
             (sb-thread::call-with-recursive-system-lock #'update lock))))))
 
+;;; A full call to a generic function compiled for speed goes straight
+;;; to the fast method function that its cache (see
+;;; SB-IMPL::MAKE-CALL-SITE-CACHE) holds for the wrapper of the first
+;;; argument, and calls this before calling the generic function as
+;;; usual when the wrapper isn't the one cached. Only standard generic
+;;; functions which dispatch on their first argument alone, have no
+;;; EQL methods and no &KEY or &REST arguments, and whose effective
+;;; method for the class is a FAST-METHOD-CALL are cached.
+;;;
+;;; The caches filled for a generic function are kept with it, so
+;;; that UPDATE-DFUN can empty them whatever name the function is
+;;; called by; the redefinition of the name or of a class empties them
+;;; too. The cache is filled only if neither happened while the
+;;; effective method was computed.
+(defvar *filling-call-site-cache* nil)
+
+(define-load-time-global *gf-call-site-caches* nil)
+
+(defun note-gf-call-site-cache (gf cache)
+  (let ((table (or *gf-call-site-caches*
+                   (let ((table (make-gf-hash-table)))
+                     (or (cas *gf-call-site-caches* nil table) table)))))
+    (with-locked-hash-table (table)
+      (let ((weak-pointers (delete-if-not #'weak-pointer-value
+                                          (gethash gf table))))
+        (setf (gethash gf table)
+              (if (find cache weak-pointers :key #'weak-pointer-value)
+                  weak-pointers
+                  (cons (make-weak-pointer cache) weak-pointers)))))))
+
+(defun flush-gf-call-site-caches (gf)
+  (let ((table *gf-call-site-caches*))
+    (when table
+      (dolist (weak-pointer (with-locked-hash-table (table)
+                              (gethash gf table)))
+        (let ((cache (weak-pointer-value weak-pointer)))
+          (when cache
+            (sb-impl::empty-call-site-cache cache)))))))
+
+(defun fill-call-site-cache (cache args)
+  (let ((gf (and (eq **boot-state** 'complete)
+                 ;; Computing an effective method may miss in a cache
+                 ;; for the same call site.
+                 (not *filling-call-site-cache*)
+                 (fboundp (sb-impl::call-site-cache-name cache))
+                 (fdefinition (sb-impl::call-site-cache-name cache)))))
+    (when (and gf
+               (eq (class-of gf) *the-class-standard-generic-function*)
+               (null (generic-function-encapsulations gf)))
+      (multiple-value-bind (nreq applyp metatypes nkeys arg-info)
+          (get-generic-fun-info gf)
+        (declare (ignore nkeys))
+        (let ((wrapper (wrapper-of (car args)))
+              (nargs (length args))
+              (state (safe-gf-dfun-state gf))
+              (*filling-call-site-cache* t))
+          (when (and metatypes
+                     (not (eq (car metatypes) t))
+                     (every (lambda (mt) (eq mt t)) (cdr metatypes))
+                     ;; The fast method function is called with the
+                     ;; arguments as they are, so their number must
+                     ;; be valid for the generic function.
+                     (<= nreq nargs)
+                     (if applyp
+                         (and (null (arg-info-keys arg-info))
+                              (<= nargs
+                                  (+ nreq (arg-info-number-optional arg-info))))
+                         (= nargs nreq))
+                     (not (invalid-wrapper-p wrapper))
+                     (not (methods-contain-eql-specializer-p
+                           (generic-function-methods gf))))
+            ;; As for a caching dfun, the permutation vector of the
+            ;; fast method call is the one for WRAPPER.
+            (multiple-value-bind (emf methods)
+                (cache-miss-values gf args 'caching)
+              (when (and methods (fast-method-call-p emf))
+                (note-gf-call-site-cache gf cache)
+                (unless (eq (svref (sb-impl::call-site-cache-entry cache) 0) nil)
+                  (incf (sb-impl::call-site-cache-misses cache)))
+                (setf (sb-impl::call-site-cache-entry cache)
+                      (vector wrapper
+                              (fast-method-call-function emf)
+                              (fast-method-call-pv emf)
+                              (fast-method-call-next-method-call emf)))
+                (unless (and (eq (safe-gf-dfun-state gf) state)
+                             (not (invalid-wrapper-p wrapper)))
+                  (sb-impl::empty-call-site-cache cache))))))))))
+
 ;;; These functions aren't used in SBCL, or documented anywhere that
 ;;; I'm aware of, but they look like they might be useful for
 ;;; debugging or performance tweaking or something, so I've just
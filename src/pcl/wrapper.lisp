@@ -195,6 +195,9 @@
     #+metaspace (setf (layout-clos-hash (wrapper-friend owrapper)) 0)
     (setf (wrapper-clos-hash owrapper) 0)
     (push (make-weak-pointer owrapper) new-previous)
+    ;; Instances of the old class must not be passed to methods chosen
+    ;; by a call-site cache before it was invalidated.
+    (sb-impl::flush-call-site-caches)
     ;; This function is called for effect; return value is arbitrary.
     (setf  (sb-kernel::standard-classoid-old-layouts classoid)
            new-previous)))
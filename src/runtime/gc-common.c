@@ -1364,6 +1364,43 @@ static inline boolean stable_eql_hash_p(lispobj obj)
     if (rehash) \
       NON_FAULTING_STORE(KV_PAIRS_REHASH(data) |= make_fixnum(1), &data[1])
 
+/* As SCAV_ENTRIES, but also record each pair whose address-based key moved
+ * in the table's moved-key log, so that Lisp need only rehash those pairs.
+ * Element 0 of the log is the number of pairs recorded, or all ones
+ * if there were too many. Each pair is recorded as its index followed by
+ * the old key. See ATTACH-MOVED-KEY-LOG in target-hash-table.lisp */
+#define MOVED_KEY_LOG_HEADER_WORDS 2
+#define MOVED_KEY_LOG_OVERFLOW (~(uword_t)0)
+static void scan_logging_kv_vector(lispobj* data, uint32_t* hashvals,
+                                   boolean eql_hashing, struct vector* log,
+                                   void (*scav_entry)(lispobj*))
+{
+    uword_t* log_data = (uword_t*)log->data;
+    uword_t capacity = (vector_len(log) - MOVED_KEY_LOG_HEADER_WORDS) / 2;
+    boolean rehash = 0;
+    unsigned hwm = KV_PAIRS_HIGH_WATER_MARK(data);
+    unsigned i;
+    for (i = 1; i <= hwm; i++) {
+        lispobj key = data[2*i], value = data[2*i+1];
+        if (!at_least_one_pointer_p(key,value)) continue;
+        scav_entry(&data[2*i]);
+        lispobj newkey = data[2*i];
+        if (newkey == key) continue;
+        if (hashvals ? hashvals[i] != MAGIC_HASH_VECTOR_VALUE
+                     : eql_hashing && stable_eql_hash_p(newkey)) continue;
+        rehash = 1;
+        uword_t count = log_data[0];
+        if (count < capacity) {
+            log_data[MOVED_KEY_LOG_HEADER_WORDS + 2*count] = i;
+            log_data[MOVED_KEY_LOG_HEADER_WORDS + 2*count + 1] = key;
+            log_data[0] = count + 1;
+        } else
+            log_data[0] = MOVED_KEY_LOG_OVERFLOW;
+    }
+    if (rehash)
+        NON_FAULTING_STORE(KV_PAIRS_REHASH(data) |= make_fixnum(1), &data[1]);
+}
+
 static void scan_nonweak_kv_vector(struct vector *kv_vector, void (*scav_entry)(lispobj*))
 {
     lispobj* data = kv_vector->data;
@@ -1381,10 +1418,12 @@ static void scan_nonweak_kv_vector(struct vector *kv_vector, void (*scav_entry)(
     sword_t kv_length = vector_len(kv_vector);
     lispobj kv_supplement = data[kv_length-1];
     boolean eql_hashing = 0; // whether this table is an EQL table
+    lispobj moved_key_log = NIL;
     if (instancep(kv_supplement)) {
         struct hash_table* ht = (struct hash_table*)native_pointer(kv_supplement);
         eql_hashing = hashtable_kind(ht) == 1;
         kv_supplement = ht->hash_vector;
+        moved_key_log = follow_maybe_fp(ht->moved_key_log);
     } else if (kv_supplement == T) { // EQL hashing on a non-weak table
         eql_hashing = 1;
         kv_supplement = NIL;
@@ -1394,7 +1433,12 @@ static void scan_nonweak_kv_vector(struct vector *kv_vector, void (*scav_entry)(
         hashvals = get_array_data(kv_supplement, SIMPLE_ARRAY_UNSIGNED_BYTE_32_WIDETAG);
         gc_assert(2 * vector_len(VECTOR(kv_supplement)) + 1 == kv_length);
     }
-    SCAV_ENTRIES(1, );
+    if (moved_key_log != NIL)
+        scan_logging_kv_vector(data, hashvals, eql_hashing,
+                               VECTOR(moved_key_log), scav_entry);
+    else {
+        SCAV_ENTRIES(1, );
+    }
 }
 
 boolean scan_weak_hashtable(struct hash_table *hash_table,
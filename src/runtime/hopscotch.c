@@ -276,27 +276,55 @@ static void hopscotch_realloc(tableptr ht, int size, char hop_range)
 /// Same as SB-KERNEL:%SXHASH-SIMPLE-STRING
 uword_t sxhash_simple_string(struct vector* string)
 {
+#ifdef LISP_FEATURE_64_BIT
+#define STRING_HASH_MULTIPLIER 0x9E3779B97F4A7C15
+#define MIX(word) {result = (result ^ (word)) * STRING_HASH_MULTIPLIER; result ^= result >> 29;}
+#else
+#define STRING_HASH_MULTIPLIER 0x9E3779B9
+#define MIX(word) {result = (result ^ (word)) * STRING_HASH_MULTIPLIER; result ^= result >> 15;}
+#endif
 #ifdef SIMPLE_CHARACTER_STRING_WIDETAG
     unsigned int* char_string = (unsigned int*)(string->data);
 #endif
     unsigned char* base_string = (unsigned char*)(string->data);
     sword_t len = vector_len(string);
-    uword_t result = 0;
-    sword_t i;
+    uword_t result = 238625159, word;
+    sword_t i, j;
+    // Each block of N_WORD_BYTES characters is packed into a word with the
+    // code of character J shifted left by 8*J, then mixed in.
+#define PACK(chars, count) \
+    for (word = 0, j = 0; j < count; ++j) word ^= (uword_t)chars[i+j] << (8*j)
     switch (widetag_of(&string->header)) {
-#define MIX(ch) {result += ch; result += result<<10; result ^= (result>>6);}
 #ifdef SIMPLE_CHARACTER_STRING_WIDETAG
     case SIMPLE_CHARACTER_STRING_WIDETAG:
-        for(i=0;i<len;++i) MIX(char_string[i])
+        for (i = 0; i + N_WORD_BYTES <= len; i += N_WORD_BYTES) {
+            PACK(char_string, N_WORD_BYTES);
+            MIX(word);
+        }
+        if (i < len) { PACK(char_string, len - i); MIX(word); }
         break;
 #endif
     case SIMPLE_BASE_STRING_WIDETAG:
-        for(i=0;i<len;++i) MIX(base_string[i])
+        for (i = 0; i + N_WORD_BYTES <= len; i += N_WORD_BYTES) {
+            PACK(base_string, N_WORD_BYTES);
+            MIX(word);
+        }
+        if (i < len) { PACK(base_string, len - i); MIX(word); }
         break;
     }
-    result += result << 3;
-    result ^= result >> 11;
-    result ^= result << 15;
+#undef PACK
+#undef MIX
+#undef STRING_HASH_MULTIPLIER
+    result ^= len;
+#ifdef LISP_FEATURE_64_BIT
+    result ^= result >> 33;
+    result *= 0xff51afd7ed558ccd;
+    result ^= result >> 33;
+#else
+    result ^= result >> 16;
+    result *= 0x85ebca6b;
+    result ^= result >> 13;
+#endif
     result &= (~(uword_t)0) >> (1+N_FIXNUM_TAG_BITS);
     return result;
 }
@@ -481,3 +481,45 @@ Testing array len 4000, 100 iterations:
   TEST-SAME-ARRAY-2        :  511998 vs  355998 (delta = -30.5%)
 
 |#
+
+;;; Fills and copies long enough to use the vectorized kernels, at
+;;; starting offsets within a word and within a 64-byte block.
+(with-test (:name (fill replace :long))
+  (dolist (bits '(1 2 4 8 16 32 #+64-bit 64))
+    (let ((type `(unsigned-byte ,bits))
+          (value (1- (ash 1 bits))))
+      (dolist (n '(0 1 127 128 129 500 1000 4095 4096 4097 20000))
+        (dolist (start '(0 1 3 8 17 64 65))
+          (let* ((size (+ n start 70))
+                 (vector (make-array size :element-type type :initial-element 0))
+                 (source (make-array size :element-type type)))
+            (dotimes (i size)
+              (setf (aref source i) (mod (* i 7) (1+ value))))
+            (fill vector value :start start :end (+ start n))
+            (dotimes (i size)
+              (assert (= (aref vector i)
+                         (if (and (<= start i) (< i (+ start n))) value 0))))
+            (replace vector source :start1 start :end2 n)
+            (dotimes (i size)
+              (assert (= (aref vector i)
+                         (if (and (<= start i) (< i (+ start n)))
+                             (aref source (- i start))
+                             0))))
+            ;; Within one vector, in both directions
+            (replace source source :start1 start :end2 n)
+            (replace source source :start2 start :end2 (+ start n))
+            (dotimes (i size)
+              (assert (= (aref source i)
+                         (mod (* (if (and (<= n i) (<= start i) (< i (+ start n)))
+                                     (- i start)
+                                     i)
+                                 7)
+                              (1+ value)))))))))))
+
+;;; Enough to use non-temporal stores
+(with-test (:name (fill :huge))
+  (dolist (type '((unsigned-byte 8) #+64-bit (unsigned-byte 64)))
+    (let ((vector (make-array 10000000 :element-type type :initial-element 0)))
+      (fill vector 1 :start 1 :end 9999999)
+      (assert (= (aref vector 0) (aref vector 9999999) 0))
+      (assert (= (count 1 vector) 9999998)))))
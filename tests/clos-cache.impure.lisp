@@ -114,3 +114,103 @@
 
   ;; Check that the test tests what it was supposed to test: the cache.
   (assert (sb-pcl::cache-p (sb-pcl::gf-dfun-cache #'cache-test))))
+
+;;; Calls compiled for speed remember the effective method for the
+;;; class of the first argument, which must be forgotten when methods,
+;;; classes or the function change.
+(defgeneric call-site-cache-test (x &optional y))
+(defmethod call-site-cache-test ((x integer) &optional y)
+  (list :integer y))
+(defclass call-site-cache-class () ())
+(defmethod call-site-cache-test ((x call-site-cache-class) &optional y)
+  (list (if (slot-exists-p x 'a) (slot-value x 'a) :none) y))
+
+(defun call-site-cache-caller (x)
+  (declare (optimize speed (space 0) (debug 0)))
+  (call-site-cache-test x 1))
+
+(defun call-site-caches (name)
+  (loop for weak-pointer in (gethash name sb-impl::*call-site-caches*)
+        for cache = (sb-ext:weak-pointer-value weak-pointer)
+        when cache collect cache))
+
+(defun call-site-cache-filled-p (name)
+  (some (lambda (cache)
+          (svref (sb-impl::call-site-cache-entry cache) 0))
+        (call-site-caches name)))
+
+(with-test (:name (:call-site-cache :invalidation))
+  ;; The first calls may update the discriminating function, which
+  ;; empties the cache again.
+  (loop repeat 3
+        do (assert (equal (call-site-cache-caller 1) '(:integer 1))))
+  (assert (call-site-cache-filled-p 'call-site-cache-test))
+  (assert (equal (call-site-cache-caller 2) '(:integer 1)))
+  (defmethod call-site-cache-test ((x fixnum) &optional y)
+    (list :fixnum y))
+  (assert (not (call-site-cache-filled-p 'call-site-cache-test)))
+  (assert (equal (call-site-cache-caller 1) '(:fixnum 1)))
+  (assert (equal (call-site-cache-caller (expt 2 100)) '(:integer 1)))
+  (assert-error (call-site-cache-caller 'symbol))
+  (let ((instance (make-instance 'call-site-cache-class)))
+    (assert (equal (call-site-cache-caller instance) '(:none 1)))
+    (assert (equal (call-site-cache-caller instance) '(:none 1)))
+    (defclass call-site-cache-class () ((a :initform :a)))
+    (assert (equal (call-site-cache-caller instance) '(:a 1))))
+  (setf (fdefinition 'call-site-cache-test)
+        (lambda (x &optional y) (list :function x y)))
+  (assert (equal (call-site-cache-caller 1) '(:function 1 1))))
+
+;;; A generic function called by another name is still flushed when
+;;; its methods change.
+(defgeneric call-site-cache-alias (x))
+(defgeneric call-site-cache-aliased (x))
+(defmethod call-site-cache-aliased ((x integer))
+  :integer)
+(setf (fdefinition 'call-site-cache-alias) #'call-site-cache-aliased)
+
+(defun call-site-cache-alias-caller (x)
+  (declare (optimize speed (space 0) (debug 0)))
+  (call-site-cache-alias x))
+
+(with-test (:name (:call-site-cache :other-name))
+  (loop repeat 3
+        do (assert (eq (call-site-cache-alias-caller 1) :integer)))
+  (assert (call-site-cache-filled-p 'call-site-cache-alias))
+  (defmethod call-site-cache-aliased ((x fixnum))
+    :fixnum)
+  (assert (eq (call-site-cache-alias-caller 1) :fixnum)))
+
+;;; A call site which sees many classes stops refilling its cache.
+(defgeneric call-site-cache-many (x))
+(defmethod call-site-cache-many (x)
+  (type-of x))
+(defmethod call-site-cache-many ((x number))
+  (type-of x))
+
+(defun call-site-cache-many-caller (x)
+  (declare (optimize speed (space 0) (debug 0)))
+  (call-site-cache-many x))
+
+(with-test (:name (:call-site-cache :megamorphic))
+  (let ((objects (list 1 (expt 2 100) 1/2 1.0 1d0 'a "a" '(a) #\a
+                       (vector 1) (make-hash-table))))
+    (loop repeat 5
+          do (dolist (object objects)
+               (assert (equal (call-site-cache-many-caller object)
+                              (type-of object)))))
+    (let ((cache (first (call-site-caches 'call-site-cache-many))))
+      (assert (= (sb-impl::call-site-cache-misses cache)
+                 sb-impl::+call-site-cache-max-misses+)))))
+
+;;; Neither a hit nor a miss keeps a generic function call from being a
+;;; tail call.
+(defgeneric call-site-cache-count-down (n))
+(defmethod call-site-cache-count-down ((n integer))
+  (declare (optimize speed (space 0) (debug 0)))
+  (if (plusp n)
+      (call-site-cache-count-down (1- n))
+      :done))
+
+(with-test (:name (:call-site-cache :tail-call))
+  (assert (eq (call-site-cache-count-down 1000000) :done)))
@@ -80,3 +80,58 @@
     (test '(lambda (x) (macrolet ((baz (arg) `(- ,arg))) (list (baz x)))))
     ;; Test 2: inline a function that captured a macrolet
     (test '(lambda (x) (make-mystruct :a x)))))
+
+(with-test (:name *compile-phase-profile*)
+  (let ((output
+          (with-output-to-string (*standard-output*)
+            (let ((*compile-phase-profile* 1))
+              (with-compilation-unit (:override t)
+                (compile nil '(lambda (x)
+                               (declare (fixnum x))
+                               (let ((y (* x 2)))
+                                 (if (> y 10) (list y) (1+ y))))))))))
+    (assert (search "compilation phase profile" output))
+    (dolist (phase '("ir1-optimize" "constraint" "pack" "generate-code"))
+      (assert (search phase output)))))
+
+(declaim (maybe-inline profile-feedback-callee))
+(defun profile-feedback-callee (x)
+  (list x x))
+
+(with-test (:name *profile-feedback*)
+  (flet ((callees (feedback)
+           (let ((*profile-feedback* feedback))
+             (ctu:find-named-callees
+              (checked-compile
+               '(sb-int:named-lambda profile-feedback-caller (x)
+                 (flet ((f (y) (profile-feedback-callee y)))
+                   (f x))))))))
+    (assert (callees nil))
+    (let ((feedback (make-hash-table :test 'equal)))
+      (assert (callees feedback))
+      (setf (gethash '(profile-feedback-caller . profile-feedback-callee) feedback) t)
+      (assert (not (callees feedback))))))
+
+;;; Blocks ending in a call to ERROR are emitted after the rest of
+;;; their function, and must still be attributed to it.
+(defun cold-blocks-test (list limit)
+  (let ((sum 0))
+    (dolist (x list sum)
+      (when (minusp x)
+        (error "negative: ~S" x))
+      (incf sum x)
+      (when (> sum limit)
+        (error "too big: ~S" sum)))))
+
+(with-test (:name :emit-cold-blocks-last)
+  (assert (= (cold-blocks-test '(1 2 3) 10) 6))
+  (dolist (args '(((1 -2 3) 10) ((1 2 3) 2)))
+    (let ((frames (block nil
+                    (handler-bind ((simple-error
+                                     (lambda (c)
+                                       (declare (ignore c))
+                                       (return (mapcar #'car
+                                                       (sb-debug:list-backtrace
+                                                        :count 10))))))
+                      (apply #'cold-blocks-test args)))))
+      (assert (member 'cold-blocks-test frames)))))
@@ -3562,3 +3562,82 @@
               (apply x 1 2 y)))))
     (assert (equal (funcall f #'list '(3)) '(1 2 3)))
     (assert (not (ctu:find-named-callees f)))))
+
+(with-test (:name :constraint-propagate-pass-limit)
+  (dolist (limit '(0 1 30))
+    (let ((sb-c::*constraint-propagate-pass-limit* limit))
+      (checked-compile-and-assert
+          ()
+          `(lambda (x n)
+             (let ((acc 0))
+               (dotimes (i n acc)
+                 (if (typep x 'fixnum)
+                     (incf acc x)
+                     (setq x (length x))))))
+        ((3 2) 6)
+        (("ab" 3) 4)
+        (('(1) 0) 0)
+        (('(1) 1) 0)
+        ((:foo 1) (condition 'type-error))))))
+
+(with-test (:name :pack-edge-limit)
+  (dolist (method '(:greedy :iterative))
+    (dolist (limit '(0 1000000))
+      (let ((sb-regalloc::*register-allocation-method* method)
+            (sb-regalloc::*pack-edge-limit* limit))
+        (checked-compile-and-assert (:optimize '(:speed 3 :safety 0))
+            `(lambda (v n)
+               (declare (simple-vector v) (fixnum n))
+               (let ((sum 0) (max 0))
+                 (declare (fixnum sum max))
+                 (dotimes (i n (list sum max))
+                   (let ((x (svref v i)))
+                     (declare (fixnum x))
+                     (incf sum x)
+                     (setf max (max max x))))))
+          ((#(1 5 2) 3) '(8 5) :test #'equal)
+          ((#(1 5 2) 0) '(0 0) :test #'equal))
+        ;; Enough values live across calls to need more stack locations
+        ;; than a large component searches.
+        (let ((vars (loop repeat 40 collect (gensym))))
+          (checked-compile-and-assert ()
+              `(lambda (f a)
+                 (declare (function f))
+                 (let* ,(loop for var in vars
+                              for i from 0
+                              collect `(,var (funcall f a ,i)))
+                   (list ,@vars)))
+            ((#'+ 1) (loop for i from 1 repeat 40 collect i))))))))
+
+(with-test (:name (:pack-edge-limit :frame-size))
+  ;; Values live throughout the function fill more of the start of the
+  ;; frame than a large component searches at once. Values live across
+  ;; only some of the calls should still share the rest of the frame,
+  ;; as they do without a limit, rather than each getting a new slot.
+  (let* ((long (loop repeat 20 collect (gensym)))
+         (form
+           `(lambda (f probe a)
+              (declare (function f probe))
+              (let* (,@(loop for var in long
+                             for i from 0
+                             collect `(,var (funcall f a ,i)))
+                     (acc 0))
+                ,@(loop repeat 20
+                        collect (let ((short (loop repeat 5 collect (gensym))))
+                                  `(let* ,(loop for var in short
+                                                for i from 0
+                                                collect `(,var (funcall f a ,i)))
+                                     (setq acc (funcall f acc (+ ,@short))))))
+                (list (funcall probe (sb-kernel:current-fp)) acc ,@long))))
+         (probe (lambda (fp)
+                  (abs (- (sb-sys:sap-int fp)
+                          (sb-sys:sap-int (sb-kernel:current-fp)))))))
+    (flet ((frame-size (limit)
+             (let ((sb-regalloc::*pack-edge-limit* limit))
+               (let ((result (funcall (checked-compile form) #'+ probe 1)))
+                 (assert (equal (cddr result)
+                                (loop for i from 1 repeat 20 collect i)))
+                 (first result)))))
+      (let ((unlimited (frame-size 1000000))
+            (limited (frame-size 0)))
+        (assert (<= limited (* 2 unlimited)))))))
@@ -105,6 +105,61 @@
                     :deadlock))))
     (assert (eq :ok (join-thread t1)))))
 
+(with-test (:name (:deadlock-detection :rwlock))
+  (flet ((test (la lb sa sb)
+           (lambda ()
+             (handler-case
+                 (sb-thread:with-write-lock (la)
+                   (signal-semaphore sa)
+                   (wait-on-semaphore sb)
+                   (sb-thread:with-write-lock (lb)
+                     :ok))
+               (thread-deadlock (e)
+                 (assert (plusp (length (princ-to-string e))))
+                 :deadlock)))))
+    (let* ((l1 (sb-thread:make-rwlock :name "L1"))
+           (l2 (sb-thread:make-rwlock :name "L2"))
+           (s1 (make-semaphore :name "S1"))
+           (s2 (make-semaphore :name "S2"))
+           (t1 (make-thread (test l1 l2 s1 s2) :name "T1"))
+           (t2 (make-thread (test l2 l1 s2 s1) :name "T2")))
+      (let ((res (list (join-thread t1)
+                       (join-thread t2))))
+        (assert (or (equal '(:deadlock :ok) res)
+                    (equal '(:ok :deadlock) res)))))))
+
+(with-test (:name (:deadlock-detection :rwlock :reader))
+  ;; T1 waits to read a lock which T2 holds for writing, while T2 waits
+  ;; for a mutex which T1 holds.
+  (let* ((l (sb-thread:make-rwlock :name "L"))
+         (m (sb-thread:make-mutex :name "M"))
+         (s1 (make-semaphore :name "S1"))
+         (s2 (make-semaphore :name "S2"))
+         (t1 (make-thread (lambda ()
+                            (handler-case
+                                (sb-thread:with-mutex (m)
+                                  (signal-semaphore s1)
+                                  (wait-on-semaphore s2)
+                                  (sb-thread:with-read-lock (l)
+                                    :ok))
+                              (thread-deadlock ()
+                                :deadlock)))
+                          :name "T1"))
+         (t2 (make-thread (lambda ()
+                            (handler-case
+                                (sb-thread:with-write-lock (l)
+                                  (signal-semaphore s2)
+                                  (wait-on-semaphore s1)
+                                  (sb-thread:with-mutex (m)
+                                    :ok))
+                              (thread-deadlock ()
+                                :deadlock)))
+                          :name "T2")))
+    (let ((res (list (join-thread t1)
+                     (join-thread t2))))
+      (assert (or (equal '(:deadlock :ok) res)
+                  (equal '(:ok :deadlock) res))))))
+
 (with-test (:name (:deadlock-detection :interrupts)
             :broken-on :win32)
   (let* ((m1 (sb-thread:make-mutex :name "M1"))
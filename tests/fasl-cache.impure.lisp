@@ -0,0 +1,154 @@
+;;;; tests of reusing fasls from SB-EXT:*FASL-CACHE-DIRECTORY*
+
+;;;; This software is part of the SBCL system. See the README file for
+;;;; more information.
+;;;;
+;;;; While most of SBCL is derived from the CMU CL system, the test
+;;;; files (like this one) were written from scratch after the fork
+;;;; from CMU CL.
+;;;;
+;;;; This software is in the public domain and is provided with
+;;;; absolutely no warranty. See the COPYING and CREDITS files for
+;;;; more information.
+
+(defvar *expansions* 0)
+
+(defun write-forms (file &rest forms)
+  (with-open-file (stream file :direction :output :if-exists :supersede)
+    (with-standard-io-syntax
+      (dolist (form forms)
+        (print form stream)))))
+
+(defun cache-entries (directory type)
+  (directory (make-pathname :name :wild :type type :defaults directory)))
+
+(defmacro with-fasl-cache ((directory) &body body)
+  `(let* ((,directory (concatenate 'string (scratch-file-name) "/"))
+          (*fasl-cache-directory* ,directory))
+     (unwind-protect (progn ,@body)
+       (dolist (file (directory (concatenate 'string ,directory "*.*")))
+         (delete-file file)))))
+
+(with-test (:name (*fasl-cache-directory* :macro-dependency))
+  (with-scratch-file (macros "lisp")
+    (with-scratch-file (source "lisp")
+      (with-scratch-file (fasl "fasl")
+        (flet ((define-macro (value)
+                 (write-forms macros
+                              `(defmacro fasl-cache-test-expand ()
+                                 (incf *expansions*)
+                                 ,value))
+                 (let ((*fasl-cache-directory* nil))
+                   (load (compile-file macros :output-file fasl))))
+               (compile-source ()
+                 (compile-file source :output-file fasl)
+                 (load fasl)
+                 (funcall 'fasl-cache-test-fun)))
+          (define-macro 42)
+          (write-forms source '(defun fasl-cache-test-fun ()
+                                (fasl-cache-test-expand)))
+          (with-fasl-cache (directory)
+            (setq *expansions* 0)
+            (assert (= (compile-source) 42))
+            (assert (plusp *expansions*))
+            (assert (= (length (cache-entries directory "deps")) 1))
+            ;; Unchanged: the stored fasl is used.
+            (let ((expansions *expansions*))
+              (assert (= (compile-source) 42))
+              (assert (= *expansions* expansions)))
+            ;; The macro it uses changed: compile again.
+            (sleep 1.1)
+            (define-macro 43)
+            (let ((expansions *expansions*))
+              (assert (= (compile-source) 43))
+              (assert (> *expansions* expansions)))
+            ;; The file changed: compile again.
+            (write-forms source '(defun fasl-cache-test-fun ()
+                                  (1+ (fasl-cache-test-expand))))
+            (let ((expansions *expansions*))
+              (assert (= (compile-source) 44))
+              (assert (> *expansions* expansions)))))))))
+
+(with-test (:name (*fasl-cache-directory* :compile-time-effects))
+  (with-scratch-file (source "lisp")
+    (with-scratch-file (fasl "fasl")
+      (write-forms source
+                   '(defmacro fasl-cache-test-own (x) `(list ,x))
+                   '(defun fasl-cache-test-own-fun () (fasl-cache-test-own 1)))
+      (with-fasl-cache (directory)
+        (compile-file source :output-file fasl)
+        (assert (= (length (cache-entries directory "deps")) 1))
+        (fmakunbound 'fasl-cache-test-own)
+        ;; Using the stored fasl defines the macro at compile time, as
+        ;; compiling the file would.
+        (compile-file source :output-file fasl)
+        (assert (macro-function 'fasl-cache-test-own))
+        (load fasl)
+        (assert (equal (funcall 'fasl-cache-test-own-fun) '(1)))))))
+
+(with-test (:name (*fasl-cache-directory* :warnings-not-stored))
+  (with-scratch-file (source "lisp")
+    (with-scratch-file (fasl "fasl")
+      (write-forms source '(defun fasl-cache-test-warn () fasl-cache-test-undefined))
+      (with-fasl-cache (directory)
+        (multiple-value-bind (output warnings-p)
+            (compile-file source :output-file fasl)
+          (assert output)
+          (assert warnings-p))
+        (assert (null (cache-entries directory "deps")))))))
+
+(defun fasl-cache-test-later (x) x)
+
+(with-test (:name (*fasl-cache-directory* :macro-defined-later))
+  (with-scratch-file (source "lisp")
+    (with-scratch-file (fasl "fasl")
+      (write-forms source '(defun fasl-cache-test-caller ()
+                            (fasl-cache-test-later 1)))
+      (with-fasl-cache (directory)
+        (compile-file source :output-file fasl)
+        (load fasl)
+        (assert (eql (funcall 'fasl-cache-test-caller) 1))
+        (assert (= (length (cache-entries directory "deps")) 1))
+        ;; The function it called is a macro now: compile again.
+        (fmakunbound 'fasl-cache-test-later)
+        (eval '(defmacro fasl-cache-test-later (x) `(list ,x)))
+        (compile-file source :output-file fasl)
+        (load fasl)
+        (assert (equal (funcall 'fasl-cache-test-caller) '(1)))))))
+
+(with-test (:name (*fasl-cache-directory* :cfasl-left-alone))
+  (with-scratch-file (source "lisp")
+    (with-scratch-file (fasl "fasl")
+      (let ((cfasl (make-pathname :type "cfasl" :defaults fasl)))
+        (write-forms source '(defun fasl-cache-test-cfasl () 1))
+        (write-forms cfasl :not-a-cfasl)
+        (unwind-protect
+             (with-fasl-cache (directory)
+               (compile-file source :output-file fasl)
+               (compile-file source :output-file fasl)
+               (with-open-file (stream cfasl)
+                 (assert (eq (read stream) :not-a-cfasl))))
+          (delete-file cfasl))))))
+
+(defun fasl-cache-test-cold (x) x)
+
+(with-test (:name (*fasl-cache-directory* *profile-feedback*))
+  (with-scratch-file (source "lisp")
+    (with-scratch-file (fasl "fasl")
+      (write-forms source '(defun fasl-cache-test-hot () (fasl-cache-test-cold 1)))
+      (with-fasl-cache (directory)
+        (flet ((compile-with-feedback (&rest calls)
+                 (let ((*profile-feedback* (make-hash-table :test 'equal)))
+                   (dolist (call calls)
+                     (setf (gethash call *profile-feedback*) t))
+                   (compile-file source :output-file fasl))
+                 (length (cache-entries directory "deps"))))
+          (assert (= (compile-with-feedback) 1))
+          ;; Different hot calls: a different entry.
+          (assert (= (compile-with-feedback
+                      '(fasl-cache-test-hot . fasl-cache-test-cold))
+                     2))
+          ;; The same ones again, in a new table: the same entry.
+          (assert (= (compile-with-feedback
+                      '(fasl-cache-test-hot . fasl-cache-test-cold))
+                     2)))))))
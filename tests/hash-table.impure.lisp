@@ -234,3 +234,204 @@
                    (assert (= (hash-table-count subclasses)
                               (funcall f subclasses))))))
              (sb-kernel:classoid-subclasses (sb-kernel:find-classoid 't)))))
+
+(with-test (:name (hash-table :incremental-resize))
+  (dolist (test '(eq eql equal))
+    (let* ((table (make-hash-table :test test :incremental-resize t))
+           (n 50000)
+           (keys (coerce (loop for i below n
+                               collect (if (eq test 'equal) (format nil "~D" i) i))
+                         'vector))
+           (max-moved 0))
+      (dotimes (i n)
+        (setf (gethash (aref keys i) table) i)
+        (let ((resize (sb-impl::hash-table-%resize table)))
+          (when (consp resize)
+            ;; Lookups see entries on both sides of the move.
+            (assert (eql (gethash (aref keys 0) table) 0))
+            (assert (eql (gethash (aref keys i) table) i))
+            (setq max-moved (max max-moved (sb-impl::hash-table-%count table))))))
+      (assert (plusp max-moved))
+      (assert (= (hash-table-count table) n))
+      (dotimes (i n)
+        (assert (eql (gethash (aref keys i) table) i)))
+      ;; Removing during a move, then iterating.
+      (loop for i from n below (* 2 n)
+            do (setf (gethash i table) i)
+            until (consp (sb-impl::hash-table-%resize table)))
+      (assert (consp (sb-impl::hash-table-%resize table)))
+      (assert (remhash (aref keys 1) table))
+      (assert (not (remhash (aref keys 1) table)))
+      (let ((count 0))
+        (maphash (lambda (k v) (declare (ignore k v)) (incf count)) table)
+        (assert (= count (hash-table-count table))))
+      ;; Iterating does not finish the move.
+      (assert (consp (sb-impl::hash-table-%resize table)))
+      (clrhash table)
+      (assert (= (hash-table-count table) 0)))))
+
+(with-test (:name (hash-table :incremental-resize :iterate-during-move))
+  (let ((table (make-hash-table :incremental-resize t)))
+    (loop for i from 0
+          do (setf (gethash i table) i)
+          until (consp (sb-impl::hash-table-%resize table)))
+    ;; Some entries have moved, and some have not.
+    (dotimes (i 20)
+      (setf (gethash (+ i (hash-table-count table)) table) 0))
+    (let ((n (hash-table-count table))
+          (resize (sb-impl::hash-table-%resize table)))
+      (assert (plusp (hash-table-count (car resize))))
+      (assert (< (hash-table-count (car resize)) n))
+      (flet ((seen ()
+               (let ((seen (make-hash-table)))
+                 (with-hash-table-iterator (next table)
+                   (loop (multiple-value-bind (more k v) (next)
+                           (unless more (return))
+                           (assert (eql v (gethash k table)))
+                           (assert (not (gethash k seen)))
+                           (setf (gethash k seen) t))))
+                 (hash-table-count seen))))
+        (assert (= (seen) n))
+        (assert (= (length (sb-impl::%hash-table-alist table)) n))
+        ;; Changing or removing the current key is allowed, and neither
+        ;; moves other entries nor makes any be visited twice.
+        (let ((visited (make-hash-table)))
+          (maphash (lambda (k v)
+                     (assert (not (gethash k visited)))
+                     (setf (gethash k visited) t)
+                     (if (evenp k)
+                         (remhash k table)
+                         (setf (gethash k table) (1+ v))))
+                   table)
+          (assert (= (hash-table-count visited) n)))
+        (assert (eq (sb-impl::hash-table-%resize table) resize))
+        (assert (= (hash-table-count table) (floor n 2)))
+        (assert (= (seen) (floor n 2)))
+        ;; Writes after the iteration move entries again.
+        (loop for i from (* 2 n)
+              while (consp (sb-impl::hash-table-%resize table))
+              do (setf (gethash i table) 0))))))
+
+(with-test (:name (hash-table :incremental-resize :clrhash-during-move))
+  (let ((table (make-hash-table :incremental-resize t :synchronized t)))
+    (loop for i from 0
+          do (setf (gethash i table) i)
+          until (consp (sb-impl::hash-table-%resize table)))
+    (clrhash table)
+    (assert (= (hash-table-count table) 0))
+    (assert (not (gethash 0 table)))
+    (setf (gethash 0 table) :new)
+    (assert (eq (gethash 0 table) :new))))
+
+(with-test (:name (hash-table :incremental-resize :weakness))
+  (assert-error (make-hash-table :incremental-resize t :weakness :key)))
+
+(with-test (:name (hash-table :moved-key-log))
+  (dolist (test '(eq eql equal))
+    ;; Bignums move but are hashed by value except under EQ, so they
+    ;; must stay in the buckets for their hashes.
+    (let* ((keys (loop for i below 10000
+                       collect (case (mod i 3)
+                                 (0 (list i))
+                                 (1 (make-symbol "K"))
+                                 (t (+ most-positive-fixnum i)))))
+           (table (make-hash-table :test test)))
+      (loop for key in keys for i from 0 do (setf (gethash key table) i))
+      (assert (sb-impl::hash-table-moved-key-log table))
+      (dotimes (iteration 3)
+        (gc)
+        (loop for key in keys for i from 0
+              do (assert (eql (gethash key table) i)))
+        (assert (not (gethash (list 0) table))))
+      (gc)
+      (loop for key in keys for i from 0
+            when (zerop (mod i 3)) do (remhash key table))
+      (gc)
+      (loop for key in keys for i from 0
+            do (assert (eql (gethash key table) (if (zerop (mod i 3)) nil i)))))))
+
+(with-test (:name (hash-table :layout :flat))
+  (dolist (test (list 'eq 'eql 'equal 'equalp
+                      (lambda (a b) (= a b))))
+    (let* ((table (if (functionp test)
+                      (make-hash-table :test test :hash-function #'sxhash
+                                       :layout :flat)
+                      (make-hash-table :test test :layout :flat :size 5)))
+           (n 20000)
+           (keys (coerce (loop for i below n
+                               collect (cond ((functionp test) i)
+                                             ((evenp i) (list i))
+                                             (t (format nil "~D" i))))
+                         'vector)))
+      (dotimes (i n)
+        (setf (gethash (aref keys i) table) i))
+      (assert (= (hash-table-count table) n))
+      (assert (>= (hash-table-size table) n))
+      (dotimes (iteration 2)
+        (gc)
+        (dotimes (i n)
+          (assert (eql (gethash (aref keys i) table) i))))
+      (assert (not (gethash -1 table)))
+      (dotimes (i n)
+        (when (zerop (mod i 3))
+          (assert (remhash (aref keys i) table))
+          (assert (not (remhash (aref keys i) table)))))
+      (gc)
+      (dotimes (i n)
+        (assert (eql (gethash (aref keys i) table) (if (zerop (mod i 3)) nil i))))
+      ;; Reinserting reuses the deleted slots.
+      (dotimes (i n)
+        (when (zerop (mod i 3))
+          (setf (gethash (aref keys i) table) (- i))))
+      (let ((sum 0))
+        (maphash (lambda (k v) (declare (ignore k)) (incf sum (abs v))) table)
+        (assert (= sum (/ (* n (1- n)) 2))))
+      (assert (eq (clrhash table) table))
+      (assert (= (hash-table-count table) 0))
+      (assert (not (gethash (aref keys 1) table)))
+      (setf (gethash (aref keys 1) table) :new)
+      (assert (eq (gethash (aref keys 1) table) :new)))))
+
+(with-test (:name (hash-table :layout :flat :synchronized))
+  (let ((table (make-hash-table :layout :flat :synchronized t)))
+    (dotimes (i 1000)
+      (setf (gethash i table) i))
+    (assert (= (hash-table-count table) 1000))
+    (assert (eql (gethash 999 table) 999))))
+
+(defmacro flat-hash-table-literal ()
+  (let ((table (make-hash-table :test 'equal :layout :flat)))
+    (setf (gethash "a" table) 1
+          (gethash "b" table) 2)
+    table))
+
+(with-test (:name (hash-table :layout :flat make-load-form))
+  (flet ((check (table)
+           (assert (sb-impl::hash-table-control table))
+           (assert (eq (hash-table-test table) 'equal))
+           (assert (= (hash-table-count table) 2))
+           (assert (eql (gethash "b" table) 2))))
+    (let ((table (flat-hash-table-literal)))
+      (check table)
+      (multiple-value-bind (create init) (make-load-form table)
+        (let ((copy (eval create)))
+          (eval (subst copy table init))
+          (check copy)))
+      (check (read-from-string
+              (with-standard-io-syntax
+                (let ((*print-readably* t))
+                  (prin1-to-string table))))))
+    ;; Dumped to a fasl and loaded back.
+    (with-scratch-file (source "lisp")
+      (with-scratch-file (fasl "fasl")
+        (with-open-file (stream source :direction :output :if-exists :supersede)
+          (print '(defparameter *flat-hash-table-literal* (flat-hash-table-literal))
+                 stream))
+        (compile-file source :output-file fasl)
+        (load fasl)
+        (check (symbol-value '*flat-hash-table-literal*))))))
+
+(with-test (:name (hash-table :layout :flat :errors))
+  (assert-error (make-hash-table :layout :flat :weakness :key))
+  (assert-error (make-hash-table :layout :flat :incremental-resize t))
+  (assert-error (make-hash-table :layout :bogus)))
@@ -411,3 +411,24 @@
           (y (make-array 2 :element-type 'double-float :initial-contents '(1.0d0 1.0d0))))
       (setf (gethash x table) t)
       (assert (gethash y table)))))
+
+(with-test (:name :sxhash-string-any-start)
+  (dotimes (length 40)
+    (let* ((chars (loop for i below length
+                        collect (code-char (+ 32 (mod (* i 37) 95)))))
+           (base (coerce chars 'simple-base-string))
+           (character (coerce chars '(simple-array character (*))))
+           (hash (sxhash base)))
+      (assert (= (sxhash character) hash))
+      (loop for offset from 1 to 7
+            do (let ((storage (make-string (+ offset length 3)
+                                           :element-type 'base-char
+                                           :initial-element #\z)))
+                 (replace storage base :start1 offset)
+                 (let ((displaced (make-array length :element-type 'base-char
+                                                     :displaced-to storage
+                                                     :displaced-index-offset offset)))
+                   (assert (= (sxhash displaced) hash))
+                   (assert (= (sb-impl::%sxhash-simple-substring
+                               storage offset (+ offset length))
+                              hash))))))))
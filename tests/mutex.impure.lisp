@@ -37,3 +37,59 @@
     (process-all-interrupts child)
     (terminate-thread child)
     (wait-for-threads (list child))))
+
+(with-test (:name (:rwlock :basic))
+  (let ((lock (make-rwlock :name "rw")))
+    (assert (grab-read-lock lock))
+    (assert (grab-read-lock lock))
+    (assert (not (grab-write-lock lock :waitp nil)))
+    (release-read-lock lock)
+    (release-read-lock lock)
+    (assert (grab-write-lock lock :waitp nil))
+    (assert (eq (rwlock-writer lock) *current-thread*))
+    (assert (not (join-thread (make-thread (lambda ()
+                                             (grab-read-lock lock :timeout 0.1))))))
+    (assert-error (grab-read-lock lock))
+    (release-write-lock lock)
+    (assert (not (rwlock-writer lock)))
+    (assert (eq :ok (with-read-lock (lock) (with-read-lock (lock) :ok))))))
+
+(with-test (:name (:rwlock :contention))
+  (let ((lock (make-rwlock :name "contended rw"))
+        (readers-inside (list 0))
+        (counter 0))
+    (declare (fixnum counter))
+    (flet ((write ()
+             (dotimes (i 2000)
+               (with-write-lock (lock)
+                 (assert (eql 0 (car readers-inside)))
+                 (incf counter))))
+           (read ()
+             (dotimes (i 2000)
+               (with-read-lock (lock)
+                 (atomic-incf (car readers-inside))
+                 (let ((before counter))
+                   (sb-thread:barrier (:read))
+                   (assert (eql before counter)))
+                 (atomic-decf (car readers-inside))))))
+      (let ((threads (append (loop repeat 2 collect (make-thread #'write))
+                             (loop repeat 4 collect (make-thread #'read)))))
+        (mapc #'join-thread threads)
+        (assert (= counter 4000))))))
+
+;;; Readers get in while a writer waits only if writers aren't preferred.
+(with-test (:name (:rwlock :prefer-writers))
+  (flet ((test (prefer-writers)
+           (let* ((lock (make-rwlock :prefer-writers prefer-writers))
+                  (writer nil))
+             (grab-read-lock lock)
+             (setf writer (make-thread (lambda ()
+                                         (with-write-lock (lock) :wrote))))
+             (wait-for (plusp (sb-thread::rwlock-writers-waiting lock)))
+             (prog1 (join-thread (make-thread
+                                  (lambda ()
+                                    (with-read-lock (lock :timeout 0.2) :read))))
+               (release-read-lock lock)
+               (assert (eq :wrote (join-thread writer)))))))
+    (assert (eq :read (test nil)))
+    (assert (null (test t)))))
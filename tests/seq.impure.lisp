@@ -1264,6 +1264,29 @@
 (with-test (:name :abstract-base-sequence-satisfies-sequencep)
   (assert (typep (sb-pcl::class-prototype (find-class 'sequence)) 'sequence)))
 
+(with-test (:name (sort stable-sort :parallel) :skipped-on (not :sb-thread))
+  (let* ((n 200000)
+         (list (loop for i below n collect (cons (random 1000) i)))
+         (expect (stable-sort (copy-list list) #'< :key #'car))
+         (sb-ext:*sort-threads* 4))
+    (assert (equal (coerce (stable-sort (coerce list 'vector) #'< :key #'car) 'list)
+                   expect))
+    (let ((sorted (sort (coerce list 'vector) #'< :key #'car)))
+      (assert (equal (map 'list #'car sorted) (mapcar #'car expect))))
+    ;; A non-simple vector, with elements outside the fill pointer.
+    (let ((vector (make-array (+ n 10) :fill-pointer n)))
+      (replace vector list)
+      (setf (aref vector (+ n 5)) :outside)
+      (assert (equal (coerce (stable-sort vector #'< :key #'car) 'list) expect))
+      (assert (eq (aref vector (+ n 5)) :outside)))
+    ;; An error in a worker thread is signaled in the caller.
+    (assert-error (sort (coerce list 'vector)
+                        (lambda (a b)
+                          (when (= (cdr a) 123456)
+                            (error "oops"))
+                          (< (car a) (car b))))
+                  simple-error)))
+
 (defvar *macro-invocations* 0)
 ;; in case someone adds more tests after this, don't mess up OPAQUE-IDENTITY
 (defun opaque-id-again (x) x)
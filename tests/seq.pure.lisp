@@ -384,6 +384,75 @@
                                   size type)
                          #'< :key #'car))))))))
 
+(with-test (:name (sort :patterns))
+  (dolist (n '(0 1 2 23 24 25 129 1000 20000))
+    (dolist (kind '(:random :sorted :reversed :few-unique :organ-pipe))
+      (let* ((vector (coerce (loop for i below n
+                                   collect (ecase kind
+                                             (:random (random 1000000))
+                                             (:sorted i)
+                                             (:reversed (- n i))
+                                             (:few-unique (random 4))
+                                             (:organ-pipe (min i (- n i)))))
+                             'simple-vector))
+             (expect (stable-sort (copy-seq vector) #'<))
+             (calls 0))
+        (assert (equalp (sort vector (lambda (a b) (incf calls) (< a b)))
+                        expect))
+        ;; Sorted and reversed input take about linear time.
+        (when (and (member kind '(:sorted :reversed)) (> n 1000))
+          (assert (< calls (* 4 n))))
+        ;; Likewise with a key, and a non-simple vector.
+        (let ((vector (make-array n :adjustable t
+                                    :initial-contents (map 'list #'list vector))))
+          (assert (equalp (map 'vector #'car (sort vector #'> :key #'car))
+                          (reverse expect))))))))
+
+(with-test (:name (sort :inconsistent-predicate))
+  ;; The result is unspecified, but must be a permutation of the input.
+  (dolist (n '(10 100 1000 10000))
+    (let ((vector (coerce (loop for i below n collect i) 'simple-vector)))
+      (sort vector (lambda (a b) (declare (ignore a b)) (zerop (random 2))))
+      (assert (equalp (sort vector #'<)
+                      (coerce (loop for i below n collect i) 'vector))))))
+
+(with-test (:name (sort stable-sort :radix))
+  (flet ((check (type random)
+           (dolist (n '(511 512 1000 5000))
+             (let* ((list (loop repeat n collect (funcall random)))
+                    (vector (coerce list `(simple-array ,type (*)))))
+               (dolist (pred (list #'< #'>))
+                 (let ((expect (stable-sort (copy-list list) pred)))
+                   (assert (equalp (sort (copy-seq vector) pred)
+                                   (coerce expect 'vector)))
+                   (assert (equalp (stable-sort (copy-seq vector) pred)
+                                   (coerce expect 'vector)))
+                   ;; A displaced vector sorts only its part of the data.
+                   (let* ((data (concatenate `(simple-array ,type (*))
+                                             (subseq vector 0 3) vector
+                                             (subseq vector 0 3)))
+                          (displaced (make-array n :element-type type
+                                                   :displaced-to data
+                                                   :displaced-index-offset 3)))
+                     (sort displaced pred)
+                     (assert (equalp displaced (coerce expect 'vector)))
+                     (assert (equalp (subseq data 0 3) (subseq vector 0 3)))
+                     (assert (equalp (subseq data (+ n 3))
+                                     (subseq vector 0 3))))))))))
+    (check 'fixnum (lambda () (- (random (* 2 most-positive-fixnum))
+                                 most-positive-fixnum)))
+    (check 'fixnum (lambda () (random 10)))
+    (check '(unsigned-byte 32) (lambda () (random (expt 2 32))))
+    (check 'double-float (lambda () (- (random 2d6) 1d6)))
+    (check 'double-float (lambda () (if (zerop (random 4)) 0d0 (- (random 1d300)))))))
+
+(with-test (:name (stable-sort :radix :signed-zero))
+  (let ((vector (make-array 1000 :element-type 'double-float)))
+    (dotimes (i 1000)
+      (setf (aref vector i) (if (evenp (floor i 7)) 0d0 -0d0)))
+    (let ((expect (copy-seq vector)))
+      (assert (every #'eql (stable-sort vector #'<) expect)))))
+
 (with-test (:name :&more-elt-index-too-large)
   (checked-compile-and-assert
       (:optimize `(:filter ,(lambda (&key safety &allow-other-keys)
@@ -611,3 +680,172 @@
       `(lambda (v s)
          (replace (the simple-vector v) #() :start1 s))
     ((#(1) 0) #(1) :test #'equalp)))
+
+(with-test (:name (position count mismatch search :octet-vectors))
+  (let ((state (sb-ext:seed-random-state 38))
+        (test (lambda (a b) (eql a b))))
+    (dolist (element-type '(base-char (unsigned-byte 8) (signed-byte 8)))
+      (let ((type `(simple-array ,element-type (*)))
+            (items (ecase element-type
+                     (base-char '(#\a #\b #\c #\d #\é 97 nil))
+                     ((unsigned-byte 8) '(0 1 2 255 -1 #\a nil))
+                     ((signed-byte 8) '(0 1 2 -1 255 #\a nil)))))
+        (flet ((random-vector (n)
+                 (let ((vector (make-array n :element-type element-type)))
+                   (dotimes (i n vector)
+                     (setf (aref vector i)
+                           (elt (remove-if-not (lambda (x) (typep x element-type))
+                                               items)
+                                (random 4 state))))))
+               (fun (lambda-expression)
+                 (checked-compile (subst type 'type lambda-expression))))
+          (let ((position (fun '(lambda (item v from-end start end)
+                                 (position item (the type v) :from-end from-end
+                                                             :start start :end end))))
+                (count (fun '(lambda (item v start end)
+                              (count item (the type v) :start start :end end))))
+                (mismatch (fun '(lambda (v1 v2 from-end start1 end1 start2 end2)
+                                 (mismatch (the type v1) (the type v2)
+                                           :from-end from-end
+                                           :start1 start1 :end1 end1
+                                           :start2 start2 :end2 end2))))
+                (search (fun '(lambda (v1 v2 from-end start1 end1 start2 end2)
+                               (search (the type v1) (the type v2)
+                                       :from-end from-end
+                                       :start1 start1 :end1 end1
+                                       :start2 start2 :end2 end2)))))
+            (loop repeat 2000
+                  do (let* ((n (random 150 state))
+                            (v (random-vector n))
+                            (w (copy-seq v))
+                            (start (random (1+ n) state))
+                            (end (+ start (random (- (1+ n) start) state)))
+                            (from-end (zerop (random 2 state)))
+                            (item (elt items (random (length items) state))))
+                       (when (plusp n)
+                         (loop repeat (random 3 state)
+                               do (setf (aref w (random n state))
+                                        (aref (random-vector 1) 0))))
+                       (let ((expected (position item v :from-end from-end
+                                                        :start start :end end
+                                                        :test test)))
+                         (assert (eql (funcall position item v from-end start end)
+                                      expected))
+                         (assert (eql (position item v :from-end from-end
+                                                       :start start :end end)
+                                      expected)))
+                       (let ((expected (count item v :start start :end end
+                                                     :test test)))
+                         (assert (eql (funcall count item v start end) expected))
+                         (assert (eql (count item v :start start :end end)
+                                      expected)))
+                       (let* ((start2 (random (1+ n) state))
+                              (end2 (+ start2 (random (- (1+ n) start2) state))))
+                         (assert (eql (funcall mismatch v w from-end
+                                               start end start2 end2)
+                                      (mismatch v w :from-end from-end
+                                                    :start1 start :end1 end
+                                                    :start2 start2 :end2 end2
+                                                    :test test)))
+                         (let* ((length (random 4 state))
+                                (start1 (random (1+ (- n (min n length))) state))
+                                (end1 (min n (+ start1 length))))
+                           (assert (eql (funcall search v v from-end
+                                                 start1 end1 start end)
+                                        (search v v :from-end from-end
+                                                    :start1 start1 :end1 end1
+                                                    :start2 start :end2 end
+                                                    :test test))))))))))))
+
+(with-test (:name (string< string= :base-strings))
+  (let ((state (sb-ext:seed-random-state 38)))
+    (flet ((random-string (n)
+             (let ((string (make-string n :element-type 'base-char)))
+               (dotimes (i n string)
+                 (setf (char string i) (code-char (+ 97 (random 3 state))))))))
+      (loop repeat 2000
+            do (let* ((a (random-string (random 80 state)))
+                      (b (if (zerop (random 2 state))
+                             (random-string (random 80 state))
+                             (subseq a 0 (random (1+ (length a)) state))))
+                      (a* (coerce a '(simple-array character (*))))
+                      (b* (coerce b '(simple-array character (*)))))
+                 (dolist (fun (list #'string< #'string<= #'string> #'string>=
+                                    #'string= #'string/=))
+                   (assert (eql (funcall fun a b) (funcall fun a* b*)))))))))
+
+(with-test (:name (map-into :element-wise))
+  (let ((state (sb-ext:seed-random-state 49)))
+    (dolist (spec '((double-float + - * /)
+                    (single-float + - * /)
+                    (fixnum logand logior logxor)
+                    ((unsigned-byte 8) logand logior logxor)
+                    ((signed-byte 16) logand logior logxor)
+                    ((unsigned-byte 32) logand logior logxor)
+                    ((signed-byte 64) logand logior logxor)))
+      (destructuring-bind (element-type &rest ops) spec
+        (flet ((random-vector (n)
+                 (let ((vector (make-array n :element-type element-type)))
+                   (dotimes (i n vector)
+                     (setf (aref vector i)
+                           (cond ((subtypep element-type 'float)
+                                  (coerce (1+ (random 100 state)) element-type))
+                                 ((subtypep element-type 'unsigned-byte)
+                                  (random 256 state))
+                                 (t
+                                  (- (random 256 state) 128))))))))
+          (dolist (op ops)
+            (let ((fun (checked-compile
+                        `(lambda (result v1 v2)
+                           (map-into (the (simple-array ,element-type (*)) result)
+                                     #',op
+                                     (the (simple-array ,element-type (*)) v1)
+                                     (the (simple-array ,element-type (*)) v2))))))
+              (dotimes (n 70)
+                (let ((v1 (random-vector n))
+                      (v2 (random-vector (+ n (random 3 state))))
+                      (result (random-vector (+ n (random 3 state)))))
+                  (let ((expect (map 'list op v1 v2)))
+                    (funcall fun result v1 v2)
+                    (assert (equal (coerce (subseq result 0 n) 'list) expect))))))))))))
+
+(with-test (:name (reduce + :unsigned-byte-vectors))
+  (let ((state (sb-ext:seed-random-state 49)))
+    (dolist (element-type '((unsigned-byte 8) (unsigned-byte 32)))
+      (let ((fun (checked-compile
+                  `(lambda (v start end)
+                     (reduce #'+ (the (simple-array ,element-type (*)) v)
+                             :start start :end end))))
+            (fun/initial-value (checked-compile
+                                `(lambda (v x)
+                                   (reduce #'+ (the (vector ,element-type) v)
+                                           :initial-value x)))))
+        (dotimes (n 100)
+          (let ((v (make-array n :element-type element-type)))
+            (dotimes (i n)
+              (setf (aref v i) (random (expt 2 (second element-type)) state)))
+            (let* ((start (random (1+ n) state))
+                   (end (+ start (random (1+ (- n start)) state))))
+              (assert (= (funcall fun v start end)
+                         (loop for i from start below end sum (aref v i)))))
+            (assert (= (funcall fun/initial-value v 5)
+                       (+ 5 (loop for x across v sum x))))))
+        (assert (eq (funcall fun/initial-value
+                             (make-array 0 :element-type element-type) :x)
+                    :x))))))
+
+(with-test (:name (reduce + :unsigned-byte-vectors :float-initial-value))
+  ;; Adding 1 to 16777216.0 twice leaves it unchanged, whereas adding 2
+  ;; does not: the elements must not be summed first.
+  (dolist (element-type '((unsigned-byte 8) (unsigned-byte 32)))
+    (let ((v (make-array 2 :element-type element-type :initial-element 1)))
+      (dolist (fun (list (checked-compile
+                          `(lambda (v x)
+                             (reduce #'+ (the (simple-array ,element-type (*)) v)
+                                     :initial-value x)))
+                         (checked-compile
+                          `(lambda (v x)
+                             (declare (single-float x))
+                             (reduce #'+ (the (simple-array ,element-type (*)) v)
+                                     :initial-value x)))))
+        (assert (eql (funcall fun v 16777216.0) 16777216.0))))))
@@ -186,3 +186,20 @@
                (sb-kernel:%simd-pack-256-2 x)
                (sb-kernel:%simd-pack-256-3 x) y))
     (((sb-ext:%make-simd-pack-256-ub64 1 2 3 4) 0) '(1 2 3 4 0) :test #'equal)))
+
+(with-test (:name (sb-vm::define-cpu-dispatched-function :avx2))
+  (flet ((variant ()
+           (sb-kernel:%fun-name (fdefinition 'sb-kernel:%octet-position))))
+    (assert (sb-vm::cpu-feature-p sb-vm::cpu-has-ymm-registers))
+    (assert (eq (variant) 'sb-kernel::%octet-position/avx2))
+    (let ((vector (make-array 100 :element-type '(unsigned-byte 8)
+                                  :initial-element 1)))
+      (setf (aref vector 70) 2)
+      (unwind-protect
+           (progn
+             (sb-vm::select-cpu-variants :baseline t)
+             (assert (eq (variant) 'sb-kernel:%octet-position))
+             (assert (eql (position 2 vector) 70)))
+        (sb-vm::select-cpu-variants))
+      (assert (eq (variant) 'sb-kernel::%octet-position/avx2))
+      (assert (eql (position 2 vector) 70)))))
@@ -871,3 +871,131 @@
         (read-char-no-hang cs)
         (assert (listen cs))))
     (delete-file file)))
+
+(with-test (:name (open :mmap) :skipped-on :win32)
+  (let ((file (scratch-file-name)))
+    (with-open-file (stream file :direction :output :if-exists :supersede
+                                 :element-type '(unsigned-byte 8))
+      (dotimes (i 10000)
+        (write-byte (mod i 251) stream)))
+    (with-open-file (stream file :element-type '(unsigned-byte 8) :mmap t)
+      (assert (typep stream 'sb-sys:mmap-fd-stream))
+      (assert (= (file-length stream) 10000))
+      (assert (= (read-byte stream) 0))
+      (assert (= (file-position stream) 1))
+      (assert (file-position stream 5000))
+      (assert (= (read-byte stream) (mod 5000 251)))
+      (let ((buffer (make-array 100 :element-type '(unsigned-byte 8))))
+        (assert (= (read-sequence buffer stream) 100))
+        (assert (= (aref buffer 0) (mod 5001 251))))
+      (assert (not (file-position stream 10001)))
+      (assert (file-position stream :end))
+      (assert (null (read-byte stream nil nil)))
+      (multiple-value-bind (sap length) (sb-sys:mmap-fd-stream-sap stream)
+        (assert (= length 10000))
+        (assert (= (sb-sys:sap-ref-8 sap 9999) (mod 9999 251)))))
+    (with-open-file (stream file :direction :output :if-exists :supersede))
+    (with-open-file (stream file :mmap t)
+      (assert (null (read-line stream nil nil))))
+    (assert-error (open file :direction :io :mmap t :if-exists :overwrite))
+    (delete-file file))
+  ;; Not a regular file: the descriptor is closed again.
+  (assert-error (open "/dev/null" :mmap t)))
+
+(with-test (:name (write-sequence :gathered fd-stream-read-vectors))
+  (let ((file (scratch-file-name))
+        (data (make-array 20000 :element-type '(unsigned-byte 8))))
+    (dotimes (i (length data))
+      (setf (aref data i) (mod i 253)))
+    (with-open-file (stream file :direction :output :if-exists :supersede
+                                 :element-type '(unsigned-byte 8))
+      ;; Leave something in the buffer so that the large write has to
+      ;; be gathered with it.
+      (write-byte 42 stream)
+      (write-sequence data stream)
+      (write-byte 43 stream))
+    (with-open-file (stream file :element-type '(unsigned-byte 8))
+      (let ((a (make-array 1 :element-type '(unsigned-byte 8)))
+            (b (make-array 15000 :element-type '(unsigned-byte 8)))
+            (c (make-array 5000 :element-type '(unsigned-byte 8)))
+            (d (make-array 10 :element-type '(unsigned-byte 8))))
+        (assert (= (read-byte stream) 42))
+        (assert (= (sb-sys:fd-stream-read-vectors stream (list a b c)) 20001))
+        (assert (= (aref a 0) 0))
+        (assert (equalp b (subseq data 1 15001)))
+        (assert (equalp (subseq c 0 4999) (subseq data 15001)))
+        (assert (= (aref c 4999) 43))
+        (assert (= (sb-sys:fd-stream-read-vectors stream (list d) nil) 0))
+        (assert-error (sb-sys:fd-stream-read-vectors stream (list d))
+                      end-of-file)))
+    (with-open-file (stream file :element-type '(unsigned-byte 16))
+      (assert-error (sb-sys:fd-stream-read-vectors
+                     stream (list (make-array 2 :element-type '(unsigned-byte 8))))))
+    ;; Input given to the INPUT-REPLACEMENT restart is read first.
+    (with-open-file (stream file :direction :output :if-exists :supersede
+                                 :element-type '(unsigned-byte 8))
+      (write-sequence '(255 65 66) stream))
+    (with-open-file (stream file :element-type :default :external-format :utf-8)
+      (handler-bind ((sb-int:character-decoding-error
+                       (lambda (c)
+                         (declare (ignore c))
+                         (invoke-restart 'sb-impl::input-replacement "xy"))))
+        (assert (char= (read-char stream) #\x)))
+      (let ((octets (make-array 3 :element-type '(unsigned-byte 8))))
+        (assert (= (sb-sys:fd-stream-read-vectors stream (list octets)) 3))
+        (assert (equalp octets #(121 65 66)))))
+    ;; Replacement octets which don't fit are kept for the next read,
+    ;; even when they split a character.
+    (with-open-file (stream file :element-type :default :external-format :utf-8)
+      (handler-bind ((sb-int:character-decoding-error
+                       (lambda (c)
+                         (declare (ignore c))
+                         (invoke-restart 'sb-impl::input-replacement
+                                         (coerce '(#\x #\y #\LATIN_SMALL_LETTER_E_WITH_ACUTE)
+                                                 'string)))))
+        (assert (char= (read-char stream) #\x)))
+      (let ((a (make-array 2 :element-type '(unsigned-byte 8)))
+            (b (make-array 3 :element-type '(unsigned-byte 8))))
+        (assert (= (sb-sys:fd-stream-read-vectors stream (list a)) 2))
+        (assert (equalp a #(121 195)))
+        (assert (= (sb-sys:fd-stream-read-vectors stream (list b)) 3))
+        (assert (equalp b #(169 65 66)))))
+    (delete-file file)))
+
+(with-test (:name (sb-impl::write-output-from-queue :writev) :skipped-on :win32)
+  (multiple-value-bind (in out) (sb-unix:unix-pipe)
+    (let ((stream (sb-sys:make-fd-stream out :output t :buffering :full
+                                             :element-type '(unsigned-byte 8)
+                                             :serve-events t))
+          (expected '()))
+      (unwind-protect
+           (progn
+             ;; More buffers than one writev(2) takes, each with some of
+             ;; its contents already written.
+             (setf (sb-impl::fd-stream-output-queue stream)
+                   (loop for i below 70
+                         collect (let ((buffer (sb-impl::get-buffer)))
+                                   (dotimes (j 10)
+                                     (setf (sb-sys:sap-ref-8 (sb-impl::buffer-sap buffer) j)
+                                           (mod (+ i j) 256)))
+                                   (setf (sb-impl::buffer-head buffer) (mod i 3)
+                                         (sb-impl::buffer-tail buffer) 10)
+                                   (loop for j from (mod i 3) below 10
+                                         do (push (mod (+ i j) 256) expected))
+                                   buffer)))
+             (setf expected (coerce (nreverse expected) '(vector (unsigned-byte 8)))
+                   (sb-impl::fd-stream-handler stream)
+                   (sb-sys:add-fd-handler out :output
+                                          (lambda (fd) (declare (ignore fd)))))
+             (sb-impl::write-output-from-queue stream)
+             (assert (null (sb-impl::fd-stream-output-queue stream)))
+             (assert (null (sb-impl::fd-stream-handler stream)))
+             (let ((octets (make-array (1+ (length expected))
+                                       :element-type '(unsigned-byte 8))))
+               (sb-sys:with-pinned-objects (octets)
+                 (assert (eql (sb-unix:unix-read in (sb-sys:vector-sap octets)
+                                                 (length octets))
+                              (length expected))))
+               (assert (equalp (subseq octets 0 (length expected)) expected))))
+        (close stream)
+        (sb-unix:unix-close in)))))
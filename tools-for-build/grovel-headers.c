@@ -40,6 +40,7 @@
   #include <sys/times.h>
   #include <sys/wait.h>
   #include <sys/ioctl.h>
+  #include <sys/mman.h>
 #if defined __HAIKU__ || defined __DragonFly__ || defined LISP_FEATURE_ANDROID
   #include <termios.h>
 #else
@@ -227,6 +228,13 @@ main(int argc, char __attribute__((unused)) *argv[])
 #ifdef LISP_FEATURE_LARGEFILE
     defconstant("o_largefile", O_LARGEFILE);
 #endif
+    printf("\n");
+
+#ifndef LISP_FEATURE_WIN32
+    printf(";;; sys/mman.h\n");
+    defconstant("prot_read", PROT_READ);
+    defconstant("map_private", MAP_PRIVATE);
+#endif
 
     printf(";;;\n");
     defconstant("s-ifmt",  S_IFMT);